@@ -0,0 +1,85 @@
+/**
+ * AirtimeMeter.cc
+ */
+
+#include "AirtimeMeter.h"
+#include <cstring>
+#include "inet/common/packet/Packet.h"
+#include "inet/physicallayer/wireless/common/contract/packetlevel/ITransmission.h"
+
+using namespace omnetpp;
+using namespace inet;
+using namespace inet::physicallayer;
+
+namespace droneauth {
+
+// Name INET's Ieee80211 MAC gives to the ACK frames it transmits
+static const char *const ACK_FRAME_NAME = "WlanAck";
+
+static simsignal_t transmissionStartedSignal = cComponent::registerSignal("transmissionStarted");
+
+AirtimeMeter::~AirtimeMeter() {
+    unsubscribe();
+}
+
+void AirtimeMeter::subscribeTo(cModule *host, const char *frameName) {
+    unsubscribe();
+    node = host;
+    dataFrameName = frameName;
+    node->subscribe(transmissionStartedSignal, this);
+}
+
+void AirtimeMeter::unsubscribe() {
+    if (node != nullptr) {
+        if (node->isSubscribed(transmissionStartedSignal, this)) {
+            node->unsubscribe(transmissionStartedSignal, this);
+        }
+        node = nullptr;
+    }
+}
+
+AirtimeUsage AirtimeMeter::takeCurrent() {
+    AirtimeUsage usage = current;
+    total.add(current);
+    current = AirtimeUsage();
+    return usage;
+}
+
+AirtimeUsage AirtimeMeter::getTotal() const {
+    AirtimeUsage usage = total;
+    usage.add(current);
+    return usage;
+}
+
+void AirtimeMeter::receiveSignal(cComponent *source, simsignal_t signalID, cObject *obj, cObject *details) {
+    if (signalID != transmissionStartedSignal) {
+        return;
+    }
+    auto transmission = check_and_cast<const ITransmission *>(obj);
+    const Packet *frame = transmission->getPacket();
+    if (frame == nullptr) {
+        return;
+    }
+
+    const char *name = frame->getName();
+    bool isData = std::strncmp(name, dataFrameName.c_str(), dataFrameName.length()) == 0;
+    bool isAck = !isData && std::strcmp(name, ACK_FRAME_NAME) == 0;
+    if (!isData && !isAck) {
+        return;
+    }
+
+    current.airtime += transmission->getDuration();
+    current.bytes += frame->getByteLength();
+    current.frames++;
+    if (isAck) {
+        current.acks++;
+    } else {
+        // Retransmissions are dups of the same frame and keep its tree id
+        if (frame->getTreeId() == lastDataTreeId) {
+            current.retries++;
+        }
+        lastDataTreeId = frame->getTreeId();
+    }
+}
+
+} // namespace droneauth
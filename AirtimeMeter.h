@@ -0,0 +1,66 @@
+/**
+ * AirtimeMeter.h
+ * Airtime and bytes-on-air accounting for authentication traffic
+ */
+
+#ifndef __DRONEAUTH_AIRTIMEMETER_H_
+#define __DRONEAUTH_AIRTIMEMETER_H_
+
+#include <omnetpp.h>
+#include <string>
+
+namespace droneauth {
+
+struct AirtimeUsage {
+    omnetpp::simtime_t airtime;
+    int64_t bytes = 0;
+    int frames = 0;
+    int retries = 0;
+    int acks = 0;
+
+    void add(const AirtimeUsage& other) {
+        airtime += other.airtime;
+        bytes += other.bytes;
+        frames += other.frames;
+        retries += other.retries;
+        acks += other.acks;
+    }
+};
+
+/**
+ * Listens to the "transmissionStarted" signal of every radio in a network
+ * node and accumulates the airtime and on-air size of authentication
+ * frames: frames carrying the app's own packets (named dataFrameName,
+ * including MAC retransmissions) and the MAC ACKs sent by the node.
+ *
+ * The owner calls takeCurrent() when a new handshake begins, so frames that
+ * arrive after the verdict (e.g. the ACK of the final response) are still
+ * attributed to the handshake that caused them.
+ */
+class AirtimeMeter : public omnetpp::cListener {
+public:
+    AirtimeMeter() : node(nullptr), lastDataTreeId(-1) {}
+    virtual ~AirtimeMeter();
+
+    void subscribeTo(omnetpp::cModule *node, const char *dataFrameName);
+    void unsubscribe();
+
+    // Usage since the previous call, which is then also added to the total
+    AirtimeUsage takeCurrent();
+    const AirtimeUsage& getCurrent() const { return current; }
+    AirtimeUsage getTotal() const;
+
+    virtual void receiveSignal(omnetpp::cComponent *source, omnetpp::simsignal_t signalID,
+                               omnetpp::cObject *obj, omnetpp::cObject *details) override;
+
+private:
+    omnetpp::cModule *node;
+    std::string dataFrameName;
+    long lastDataTreeId;
+    AirtimeUsage current;
+    AirtimeUsage total;
+};
+
+} // namespace droneauth
+
+#endif
@@ -0,0 +1,100 @@
+/**
+ * AllocTracker.cc
+ */
+
+#include "AllocTracker.h"
+#include <cstdlib>
+#include <new>
+
+namespace droneauth {
+
+static const char *const phaseNames[ALLOC_PHASE_COUNT] = {
+    "droneSendRequest",
+    "droneRecvChallenge",
+    "droneSendProof",
+    "droneRecvVerdict",
+    "droneTimeout",
+    "dronePrepare",
+    "gsRecvRequest",
+    "gsRecvProof",
+    "packetIo",
+};
+
+// Counters of the innermost active scope on this thread, if any
+static thread_local AllocCounters *currentCounters = nullptr;
+
+bool AllocTracker::enabled() {
+#ifdef DRONEAUTH_ALLOC_TRACKING
+    return true;
+#else
+    return false;
+#endif
+}
+
+const char *AllocTracker::phaseName(int phase) {
+    if (phase < 0 || phase >= ALLOC_PHASE_COUNT) {
+        return "unknown";
+    }
+    return phaseNames[phase];
+}
+
+void AllocTracker::onAllocation(size_t size) {
+    AllocCounters *counters = currentCounters;
+    if (counters != nullptr) {
+        counters->count++;
+        counters->bytes += size;
+    }
+}
+
+#ifdef DRONEAUTH_ALLOC_TRACKING
+
+AllocScope::AllocScope(AllocStats& stats, AllocPhase phase)
+    : counters(&stats.phases[phase]), previous(currentCounters), startCount(counters->count), steady(false) {
+    currentCounters = counters;
+    counters->scopes++;
+}
+
+AllocScope::~AllocScope() {
+    if (steady) {
+        counters->steadyScopes++;
+        counters->steadyCount += counters->count - startCount;
+    }
+    currentCounters = previous;
+}
+
+#endif
+
+} // namespace droneauth
+
+#ifdef DRONEAUTH_ALLOC_TRACKING
+
+// Replacement global allocation functions; the matching deletes release with free()
+
+static void *trackedAlloc(std::size_t size) {
+    droneauth::AllocTracker::onAllocation(size);
+    void *p = std::malloc(size == 0 ? 1 : size);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void *operator new(std::size_t size) { return trackedAlloc(size); }
+void *operator new[](std::size_t size) { return trackedAlloc(size); }
+
+void *operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    droneauth::AllocTracker::onAllocation(size);
+    return std::malloc(size == 0 ? 1 : size);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    droneauth::AllocTracker::onAllocation(size);
+    return std::malloc(size == 0 ? 1 : size);
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
+
+#endif
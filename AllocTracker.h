@@ -0,0 +1,79 @@
+/**
+ * AllocTracker.h
+ * Build-time allocation accounting per handshake phase
+ *
+ * Compiled in only with -DDRONEAUTH_ALLOC_TRACKING (make ALLOC_TRACKING=1).
+ * Otherwise AllocScope is an empty object and no operator new is replaced.
+ */
+
+#ifndef ALLOCTRACKER_H_
+#define ALLOCTRACKER_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace droneauth {
+
+// Named phases of a handshake, one per message handler
+enum AllocPhase {
+    ALLOC_DRONE_SEND_REQUEST = 0,
+    ALLOC_DRONE_RECV_CHALLENGE,
+    ALLOC_DRONE_SEND_PROOF,
+    ALLOC_DRONE_RECV_VERDICT,
+    ALLOC_DRONE_TIMEOUT,
+    ALLOC_DRONE_PREPARE,    // next credentials for rotation; allocates by design
+    ALLOC_GS_RECV_REQUEST,
+    ALLOC_GS_RECV_PROOF,
+    ALLOC_PACKET_IO,        // INET packets built or peeked for a phase (framework-owned)
+    ALLOC_PHASE_COUNT
+};
+
+struct AllocCounters {
+    uint64_t scopes = 0;    // times the phase was entered
+    uint64_t count = 0;     // operator new calls inside the phase
+    uint64_t bytes = 0;     // bytes requested inside the phase
+    uint64_t steadyScopes = 0;  // scopes marked as steady state (past warm-up)
+    uint64_t steadyCount = 0;   // allocations inside those; expected to stay 0
+};
+
+// Per-module table of counters, one entry per phase
+struct AllocStats {
+    AllocCounters phases[ALLOC_PHASE_COUNT];
+};
+
+class AllocTracker {
+public:
+    static bool enabled();
+    static const char *phaseName(int phase);
+
+    // Called from the replaced operator new
+    static void onAllocation(size_t size);
+};
+
+/**
+ * RAII scope attributing every allocation made on this thread to one phase.
+ * Scopes nest; an allocation is counted in the innermost scope only.
+ */
+class AllocScope {
+public:
+#ifdef DRONEAUTH_ALLOC_TRACKING
+    AllocScope(AllocStats& stats, AllocPhase phase);
+    ~AllocScope();
+    // The work of this scope is past warm-up: its allocations go to steadyCount
+    void markSteadyState() { steady = true; }
+private:
+    AllocCounters *counters;
+    AllocCounters *previous;
+    uint64_t startCount;
+    bool steady;
+#else
+    AllocScope(AllocStats&, AllocPhase) {}
+    void markSteadyState() {}
+#endif
+    AllocScope(const AllocScope&) = delete;
+    AllocScope& operator=(const AllocScope&) = delete;
+};
+
+} // namespace droneauth
+
+#endif /* ALLOCTRACKER_H_ */
@@ -0,0 +1,358 @@
+/**
+ * AuditLog.cc
+ */
+
+#include "AuditLog.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <openssl/evp.h>
+
+namespace droneauth {
+
+static const char AUDIT_MAGIC[8] = { 'D', 'A', 'A', 'U', 'D', 'I', 'T', '1' };
+static const uint32_t AUDIT_VERSION = 1;
+static const size_t CHAINED_BYTES = offsetof(AuditRecord, chainHash);
+
+static std::string segmentName(const std::string& path, uint64_t segment) {
+    return path + "." + std::to_string(segment);
+}
+
+static bool segmentExists(const std::string& path, uint64_t segment) {
+    struct stat st;
+    return ::stat(segmentName(path, segment).c_str(), &st) == 0;
+}
+
+static bool chainHash(EVP_MD_CTX *context, const EVP_MD *sha256, const uint8_t *prevHash,
+                      const AuditRecord& record, uint8_t *hash) {
+    return EVP_DigestInit_ex(context, sha256, nullptr) == 1
+            && EVP_DigestUpdate(context, prevHash, AUDIT_HASH_SIZE) == 1
+            && EVP_DigestUpdate(context, &record, CHAINED_BYTES) == 1
+            && EVP_DigestFinal_ex(context, hash, nullptr) == 1;
+}
+
+static bool validHeader(const AuditHeader& header, size_t fileSize) {
+    return std::memcmp(header.magic, AUDIT_MAGIC, sizeof(header.magic)) == 0
+            && header.version == AUDIT_VERSION && header.recordSize == sizeof(AuditRecord)
+            && header.capacity > 0 && header.firstSequence > 0
+            && fileSize == sizeof(AuditHeader) + header.capacity * sizeof(AuditRecord);
+}
+
+// Maps a segment file; a new one is sized and allocated on disk up front
+static uint8_t *mapFile(const std::string& fileName, size_t createSize, size_t& size, bool writable,
+                        std::string& error) {
+    int flags = writable ? O_RDWR : O_RDONLY;
+    if (createSize > 0) {
+        flags |= O_CREAT | O_EXCL;
+    }
+    int fd = ::open(fileName.c_str(), flags, 0600);
+    if (fd < 0) {
+        error = "cannot open " + fileName + ": " + std::strerror(errno);
+        return nullptr;
+    }
+    if (createSize > 0) {
+        int result = posix_fallocate(fd, 0, createSize);
+        if (result != 0) {
+            error = "cannot allocate " + fileName + ": " + std::strerror(result);
+            ::close(fd);
+            ::unlink(fileName.c_str());
+            return nullptr;
+        }
+        size = createSize;
+    } else {
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(AuditHeader)) {
+            error = fileName + " is not an audit segment";
+            ::close(fd);
+            return nullptr;
+        }
+        size = st.st_size;
+    }
+    void *mapping = mmap(nullptr, size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        error = "cannot map " + fileName + ": " + std::strerror(errno);
+        return nullptr;
+    }
+    return (uint8_t *)mapping;
+}
+
+AuditLog::~AuditLog() {
+    close();
+    EVP_MD_CTX_free(hashContext);
+    EVP_MD_free(sha256);
+}
+
+bool AuditLog::open(const char *path, uint64_t segmentRecords, std::string& error, PerfRegistry *perf) {
+    close();
+    if (hashContext == nullptr) {
+        sha256 = EVP_MD_fetch(nullptr, "SHA256", nullptr);
+        hashContext = EVP_MD_CTX_new();
+        if (sha256 == nullptr || hashContext == nullptr) {
+            error = "SHA-256 is not available";
+            return false;
+        }
+    }
+    this->path = path;
+    this->segmentRecords = segmentRecords;
+    this->perf = perf;
+    if (segmentRecords == 0) {
+        error = "audit segments need room for at least one record";
+        return false;
+    }
+    uint64_t last = 0;
+    while (segmentExists(this->path, last + 1)) {
+        last++;
+    }
+    if (!segmentExists(this->path, last)) {
+        nextSequence = 1;
+        std::memset(lastHash, 0, sizeof(lastHash));
+        return mapSegment(0, true, error);
+    }
+    if (!mapSegment(last, false, error)) {
+        return false;
+    }
+    // Continue after the last record that chains
+    const AuditHeader& header = *(const AuditHeader *)base;
+    std::memcpy(lastHash, header.prevHash, sizeof(lastHash));
+    used = 0;
+    uint8_t hash[AUDIT_HASH_SIZE];
+    while (used < header.capacity) {
+        const AuditRecord& record = ((const AuditRecord *)(base + sizeof(AuditHeader)))[used];
+        if (record.sequence != header.firstSequence + used) {
+            break;
+        }
+        if (!chainHash(hashContext, sha256, lastHash, record, hash)
+                || std::memcmp(hash, record.chainHash, sizeof(hash)) != 0) {
+            break;
+        }
+        std::memcpy(lastHash, hash, sizeof(lastHash));
+        used++;
+    }
+    // Past that point a crash may have left torn or stray records of its last
+    // commit, never a durable one. Clear them so that the log reads as ending
+    // there until it is overwritten.
+    AuditRecord *records = (AuditRecord *)(base + sizeof(AuditHeader));
+    uint64_t stray = used;
+    for (uint64_t i = used; i < header.capacity; i++) {
+        if (records[i].durable != 0) {
+            error = "chain breaks at record " + std::to_string(header.firstSequence + used) + " in "
+                    + segmentName(this->path, last) + ", which is committed through record "
+                    + std::to_string(records[i].sequence);
+            unmap();
+            return false;
+        }
+        if (records[i].sequence != 0) {
+            stray = i + 1;
+        }
+    }
+    if (stray > used) {
+        std::memset(&records[used], 0, (stray - used) * sizeof(AuditRecord));
+        msync(base, sizeof(AuditHeader) + stray * sizeof(AuditRecord), MS_SYNC);
+    }
+    committed = used;
+    nextSequence = header.firstSequence + used;
+    return true;
+}
+
+bool AuditLog::mapSegment(uint64_t segment, bool create, std::string& error) {
+    std::string fileName = segmentName(path, segment);
+    size_t createSize = create ? sizeof(AuditHeader) + segmentRecords * sizeof(AuditRecord) : 0;
+    base = mapFile(fileName, createSize, mappedSize, true, error);
+    if (base == nullptr) {
+        return false;
+    }
+    if (create) {
+        AuditHeader& header = *(AuditHeader *)base;
+        std::memcpy(header.magic, AUDIT_MAGIC, sizeof(header.magic));
+        header.version = AUDIT_VERSION;
+        header.recordSize = sizeof(AuditRecord);
+        header.capacity = segmentRecords;
+        header.firstSequence = nextSequence;
+        std::memcpy(header.prevHash, lastHash, sizeof(lastHash));
+    } else if (!validHeader(*(const AuditHeader *)base, mappedSize)) {
+        error = fileName + " is not an audit segment";
+        unmap();
+        return false;
+    }
+    this->segment = segment;
+    used = 0;
+    committed = 0;
+    return true;
+}
+
+bool AuditLog::startNextSegment() {
+    std::string error;
+    if (!commit()) {
+        return false;
+    }
+    markDurable();
+    unmap();
+    return mapSegment(segment + 1, true, error);
+}
+
+bool AuditLog::append(uint64_t timeNs, uint32_t peer, AuditVerdict verdict, const std::string& droneId,
+                      const uint8_t *commitment, size_t commitmentLength) {
+    ScopedTimer timer(perf, PERF_AUDIT_APPEND);
+    if (base == nullptr) {
+        return false;
+    }
+    if (used == ((const AuditHeader *)base)->capacity && !startNextSegment()) {
+        return false;
+    }
+    // Written in place; the chain hash goes last
+    AuditRecord& record = ((AuditRecord *)(base + sizeof(AuditHeader)))[used];
+    std::memset(&record, 0, sizeof(record));
+    record.sequence = nextSequence;
+    record.timeNs = timeNs;
+    record.peer = peer;
+    record.verdict = verdict;
+    record.idLength = std::min(droneId.size(), sizeof(record.droneId));
+    std::memcpy(record.droneId, droneId.data(), record.idLength);
+    if (commitment != nullptr) {
+        std::memcpy(record.commitment, commitment, std::min(commitmentLength, sizeof(record.commitment)));
+    }
+    if (!chainHash(hashContext, sha256, lastHash, record, record.chainHash)) {
+        return false;
+    }
+    std::memcpy(lastHash, record.chainHash, sizeof(lastHash));
+    used++;
+    nextSequence++;
+    return true;
+}
+
+bool AuditLog::commit() {
+    if (base == nullptr || committed == used) {
+        return true;
+    }
+    ScopedTimer timer(perf, PERF_AUDIT_COMMIT);
+    // One msync over the pages holding the group (and the header of a new
+    // segment) and the last record of the previous group, which the previous
+    // msync made durable
+    AuditRecord *records = (AuditRecord *)(base + sizeof(AuditHeader));
+    if (committed > 0) {
+        records[committed - 1].durable = 1;
+    }
+    size_t begin = committed == 0 ? 0 : sizeof(AuditHeader) + (committed - 1) * sizeof(AuditRecord);
+    size_t end = sizeof(AuditHeader) + used * sizeof(AuditRecord);
+    size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    begin -= begin % pageSize;
+    if (msync(base + begin, end - begin, MS_SYNC) != 0) {
+        return false;
+    }
+    committed = used;
+    numCommits++;
+    return true;
+}
+
+// Marks the last committed record in its own msync, where no commit follows
+void AuditLog::markDurable() {
+    if (base == nullptr || committed == 0) {
+        return;
+    }
+    AuditRecord& record = ((AuditRecord *)(base + sizeof(AuditHeader)))[committed - 1];
+    if (record.durable != 0) {
+        return;
+    }
+    record.durable = 1;
+    size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    size_t begin = sizeof(AuditHeader) + (committed - 1) * sizeof(AuditRecord);
+    size_t end = begin + sizeof(AuditRecord);
+    begin -= begin % pageSize;
+    msync(base + begin, end - begin, MS_SYNC);
+}
+
+void AuditLog::unmap() {
+    if (base != nullptr) {
+        munmap(base, mappedSize);
+        base = nullptr;
+        mappedSize = 0;
+    }
+}
+
+void AuditLog::close() {
+    if (commit()) {
+        markDurable();
+    }
+    unmap();
+}
+
+static bool verifySegments(const char *path, EVP_MD_CTX *context, const EVP_MD *sha256, uint64_t& records,
+                           uint8_t *endHash, std::string& error) {
+    uint8_t prevHash[AUDIT_HASH_SIZE] = {};
+    uint8_t hash[AUDIT_HASH_SIZE];
+    uint64_t expectedSequence = 1;
+    bool ended = false;  // a segment stopped short; nothing may follow it
+    for (uint64_t segment = 0; segmentExists(path, segment); segment++) {
+        std::string fileName = segmentName(path, segment);
+        if (ended) {
+            error = fileName + " follows a segment that is not full";
+            return false;
+        }
+        size_t size;
+        uint8_t *base = mapFile(fileName, 0, size, false, error);
+        if (base == nullptr) {
+            return false;
+        }
+        const AuditHeader& header = *(const AuditHeader *)base;
+        bool ok = validHeader(header, size);
+        if (!ok) {
+            error = fileName + " is not an audit segment";
+        } else if (header.firstSequence != expectedSequence
+                || std::memcmp(header.prevHash, prevHash, sizeof(prevHash)) != 0) {
+            error = fileName + " does not continue the previous segment";
+            ok = false;
+        }
+        const AuditRecord *segmentRecords = (const AuditRecord *)(base + sizeof(AuditHeader));
+        for (uint64_t i = 0; ok && i < header.capacity; i++) {
+            const AuditRecord& record = segmentRecords[i];
+            if (record.sequence != expectedSequence) {
+                // Never-written slots end the log; anything else was put there
+                if (record.sequence != 0) {
+                    error = "record " + std::to_string(expectedSequence) + " in " + fileName + " is out of sequence";
+                    ok = false;
+                }
+                ended = true;
+                break;
+            }
+            if (!chainHash(context, sha256, prevHash, record, hash)
+                    || std::memcmp(hash, record.chainHash, sizeof(hash)) != 0) {
+                error = "chain breaks at record " + std::to_string(expectedSequence) + " in " + fileName;
+                ok = false;
+                break;
+            }
+            std::memcpy(prevHash, hash, sizeof(prevHash));
+            expectedSequence++;
+            records++;
+        }
+        munmap(base, size);
+        if (!ok) {
+            return false;
+        }
+    }
+    std::memcpy(endHash, prevHash, AUDIT_HASH_SIZE);
+    return true;
+}
+
+bool verifyAuditLog(const char *path, uint64_t& records, std::string& error, const uint8_t *lastHash) {
+    records = 0;
+    EVP_MD *sha256 = EVP_MD_fetch(nullptr, "SHA256", nullptr);
+    EVP_MD_CTX *context = EVP_MD_CTX_new();
+    uint8_t endHash[AUDIT_HASH_SIZE];
+    bool valid = sha256 != nullptr && context != nullptr
+            && verifySegments(path, context, sha256, records, endHash, error);
+    if (valid && lastHash != nullptr && std::memcmp(endHash, lastHash, sizeof(endHash)) != 0) {
+        error = "log ends at record " + std::to_string(records) + ", not at the expected last record";
+        valid = false;
+    }
+    EVP_MD_CTX_free(context);
+    EVP_MD_free(sha256);
+    return valid;
+}
+
+} // namespace droneauth
@@ -0,0 +1,134 @@
+/**
+ * AuditLog.h
+ * Append-only, tamper-evident log of authentication decisions.
+ *
+ *   segment  [AuditHeader] [AuditRecord] [AuditRecord] ... (capacity records)
+ *
+ * Segments (PATH.0, PATH.1, ...) are preallocated and mapped. An append
+ * copies one fixed-size record into the mapping. commit() flushes every
+ * record appended since the previous commit with one msync, so a group of
+ * decisions shares the cost of reaching storage. Records appended after the
+ * last commit may be lost in a crash.
+ *
+ * Each record carries SHA-256(previous chain hash || record up to the chain
+ * field). The first record of a segment chains from the segment header's
+ * prevHash, which is the last hash of the segment before it (zero for
+ * PATH.0). Altering, removing or reordering a committed record breaks
+ * the chain from that record on, which verifyAuditLog() reports.
+ *
+ * A commit also marks the last record of the group before it as durable
+ * (close() marks the last one), so open() can tell committed records from
+ * a torn tail. It clears records past the end of the chain only if none of
+ * them is marked, and otherwise refuses to continue the log. The records of
+ * the last commit before a crash are not marked yet and are cleared if they
+ * do not chain.
+ *
+ * The log cannot detect that records were cut off its end, marks included.
+ * Keep getLastHash() elsewhere and pass it to verifyAuditLog() for that.
+ */
+
+#ifndef AUDITLOG_H_
+#define AUDITLOG_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "PerfTimer.h"
+
+struct evp_md_st;
+struct evp_md_ctx_st;
+
+namespace droneauth {
+
+static const size_t AUDIT_HASH_SIZE = 32;
+
+enum AuditVerdict : uint8_t {
+    AUDIT_ACCEPTED = 1,
+    AUDIT_UNAUTHORIZED = 2,
+    AUDIT_PROOF_INVALID = 3,
+    AUDIT_UNKNOWN_CHALLENGE = 4,
+    AUDIT_MALFORMED = 5,
+};
+
+struct AuditHeader {
+    char magic[8];                    // "DAAUDIT1"
+    uint32_t version;
+    uint32_t recordSize;
+    uint64_t capacity;                // records in this segment
+    uint64_t firstSequence;
+    uint8_t prevHash[AUDIT_HASH_SIZE];
+};
+
+struct AuditRecord {
+    uint64_t sequence;                // from 1, across segments
+    uint64_t timeNs;                  // decision time (simulation or wall clock, ns)
+    uint32_t peer;                    // IPv4 address of the sender
+    uint8_t verdict;                  // AuditVerdict
+    uint8_t idLength;                 // of droneId; longer IDs are cut
+    uint16_t reserved;
+    char droneId[32];
+    uint8_t commitment[32];           // from the request or proof; zero if none
+    uint8_t chainHash[AUDIT_HASH_SIZE];
+    uint64_t durable;                 // nonzero: reached storage before a later commit; not chained
+};
+
+static_assert(sizeof(AuditHeader) == 64, "AuditHeader layout");
+static_assert(sizeof(AuditRecord) == 128, "AuditRecord layout");
+
+class AuditLog {
+public:
+    AuditLog() {}
+    ~AuditLog();
+    AuditLog(const AuditLog&) = delete;
+    AuditLog& operator=(const AuditLog&) = delete;
+
+    // Continues the log at path after its last valid record, or starts it;
+    // new segments hold segmentRecords. false with a message in error, also
+    // if a durable record follows a break in the chain.
+    bool open(const char *path, uint64_t segmentRecords, std::string& error, PerfRegistry *perf = nullptr);
+    // Commits and unmaps
+    void close();
+    bool isOpen() const { return base != nullptr; }
+
+    // Appends one decision; durable after the next commit(). false only if a
+    // full segment cannot be followed by a new one.
+    bool append(uint64_t timeNs, uint32_t peer, AuditVerdict verdict, const std::string& droneId,
+                const uint8_t *commitment, size_t commitmentLength);
+    bool commit();
+
+    uint64_t getNumRecords() const { return nextSequence - 1; }
+    uint64_t getUncommitted() const { return used - committed; }
+    uint64_t getNumCommits() const { return numCommits; }
+    // Chain hash of the last record appended
+    const uint8_t *getLastHash() const { return lastHash; }
+
+private:
+    bool mapSegment(uint64_t segment, bool create, std::string& error);
+    bool startNextSegment();
+    void markDurable();
+    void unmap();
+
+    std::string path;
+    uint64_t segmentRecords = 0;
+    PerfRegistry *perf = nullptr;
+    uint8_t *base = nullptr;
+    size_t mappedSize = 0;
+    uint64_t segment = 0;
+    uint64_t used = 0;          // records in the current segment
+    uint64_t committed = 0;     // of those, flushed
+    uint64_t nextSequence = 1;
+    uint8_t lastHash[AUDIT_HASH_SIZE] = {};
+    uint64_t numCommits = 0;
+    // Fetched once: a one-shot SHA256() looks the digest up on every call
+    evp_md_st *sha256 = nullptr;
+    evp_md_ctx_st *hashContext = nullptr;
+};
+
+// Checks every segment's chain; records holds the number of valid records.
+// With lastHash, also that the log ends at the record with that chain hash.
+// false with the first break in error.
+bool verifyAuditLog(const char *path, uint64_t& records, std::string& error, const uint8_t *lastHash = nullptr);
+
+} // namespace droneauth
+
+#endif /* AUDITLOG_H_ */
@@ -0,0 +1,243 @@
+/**
+ * AuthCodec.cc
+ */
+
+#include "AuthCodec.h"
+#include <cstring>
+
+namespace droneauth {
+
+// Reads a length-prefixed field at offset, advancing it; false if it does not fit
+static bool readField(const uint8_t *data, size_t length, size_t& offset,
+                      const uint8_t *& field, uint32_t& fieldLength) {
+    if (length < offset + 4) {
+        return false;
+    }
+    std::memcpy(&fieldLength, data + offset, 4);
+    offset += 4;
+    if (length - offset < fieldLength) {
+        return false;
+    }
+    field = data + offset;
+    offset += fieldLength;
+    return true;
+}
+
+static void appendField(std::vector<uint8_t>& out, const uint8_t *field, uint32_t fieldLength) {
+    out.insert(out.end(), (const uint8_t *)&fieldLength, (const uint8_t *)&fieldLength + 4);
+    out.insert(out.end(), field, field + fieldLength);
+}
+
+bool AuthCodec::decodeAuthRequest(const uint8_t *data, size_t length,
+                                  std::string& droneId, std::vector<uint8_t>& commitment) {
+    if (length < 1 || data[0] != MSG_AUTH_REQUEST) {
+        return false;
+    }
+    size_t offset = 1;
+    const uint8_t *field;
+    uint32_t fieldLength;
+    if (!readField(data, length, offset, field, fieldLength)) {
+        return false;
+    }
+    droneId.assign((const char *)field, fieldLength);
+    if (!readField(data, length, offset, field, fieldLength)) {
+        return false;
+    }
+    commitment.assign(field, field + fieldLength);
+    return true;
+}
+
+bool AuthCodec::decodeChallenge(const uint8_t *data, size_t length, std::string& challenge) {
+    if (length < 1 || data[0] != MSG_CHALLENGE) {
+        return false;
+    }
+    size_t offset = 1;
+    const uint8_t *field;
+    uint32_t fieldLength;
+    if (!readField(data, length, offset, field, fieldLength)) {
+        return false;
+    }
+    challenge.assign((const char *)field, fieldLength);
+    return true;
+}
+
+bool AuthCodec::decodeProof(const uint8_t *data, size_t length, ZKProof& proof) {
+    if (length < 1 || data[0] != MSG_PROOF) {
+        return false;
+    }
+    size_t offset = 1;
+    const uint8_t *field;
+    uint32_t fieldLength;
+    if (!readField(data, length, offset, field, fieldLength)) {
+        return false;
+    }
+    proof.proofData.assign(field, field + fieldLength);
+    if (!readField(data, length, offset, field, fieldLength)) {
+        return false;
+    }
+    proof.commitment.assign(field, field + fieldLength);
+    if (!readField(data, length, offset, field, fieldLength)) {
+        return false;
+    }
+    proof.challenge.assign((const char *)field, fieldLength);
+    // Anything between the challenge and the closing timestamp is the next commitment
+    if (length > offset + 8) {
+        if (!readField(data, length, offset, field, fieldLength)) {
+            return false;
+        }
+        proof.nextCommitment.assign(field, field + fieldLength);
+    } else {
+        proof.nextCommitment.clear();
+    }
+    if (length != offset + 8) {
+        return false;
+    }
+    std::memcpy(&proof.timestamp, data + offset, 8);
+    return true;
+}
+
+bool AuthCodec::decodeRelay(const uint8_t *data, size_t length, uint32_t& relayId,
+                            const uint8_t *& datagram, size_t& datagramLength) {
+    if (length < 5 || data[0] != MSG_RELAY) {
+        return false;
+    }
+    std::memcpy(&relayId, data + 1, 4);
+    datagram = data + 5;
+    datagramLength = length - 5;
+    return true;
+}
+
+bool AuthCodec::decodeCredentials(const uint8_t *data, size_t length, std::string& droneId,
+                                  std::vector<uint8_t>& commitment, std::vector<uint8_t>& nextCommitment) {
+    if (length < 1 || data[0] != MSG_CREDENTIALS) {
+        return false;
+    }
+    size_t offset = 1;
+    const uint8_t *field;
+    uint32_t fieldLength;
+    if (!readField(data, length, offset, field, fieldLength)) {
+        return false;
+    }
+    droneId.assign((const char *)field, fieldLength);
+    if (!readField(data, length, offset, field, fieldLength)) {
+        return false;
+    }
+    commitment.assign(field, field + fieldLength);
+    if (!readField(data, length, offset, field, fieldLength)) {
+        return false;
+    }
+    nextCommitment.assign(field, field + fieldLength);
+    return offset == length;
+}
+
+bool AuthCodec::decodeWakeSchedule(const uint8_t *data, size_t length, WakeSchedule& schedule) {
+    if (length != 13 || data[0] != MSG_WAKE_SCHEDULE) {
+        return false;
+    }
+    std::memcpy(&schedule.offsetMs, data + 1, 4);
+    std::memcpy(&schedule.periodMs, data + 5, 4);
+    std::memcpy(&schedule.windowMs, data + 9, 4);
+    return schedule.periodMs > 0 && schedule.windowMs < schedule.periodMs && schedule.offsetMs < schedule.periodMs;
+}
+
+bool AuthCodec::peekCommitment(const uint8_t *data, size_t length,
+                               const uint8_t *& commitment, size_t& commitmentLength) {
+    // Second field of both: after the drone ID (request) or the proof data (proof)
+    if (length < 1 || (data[0] != MSG_AUTH_REQUEST && data[0] != MSG_PROOF)) {
+        return false;
+    }
+    size_t offset = 1;
+    const uint8_t *field;
+    uint32_t fieldLength;
+    if (!readField(data, length, offset, field, fieldLength)
+            || !readField(data, length, offset, field, fieldLength)) {
+        return false;
+    }
+    commitment = field;
+    commitmentLength = fieldLength;
+    return true;
+}
+
+bool AuthCodec::peekDroneId(const uint8_t *data, size_t length,
+                            const uint8_t *& droneId, size_t& droneIdLength) {
+    if (length < 1 || data[0] != MSG_AUTH_REQUEST) {
+        return false;
+    }
+    size_t offset = 1;
+    uint32_t fieldLength;
+    if (!readField(data, length, offset, droneId, fieldLength)) {
+        return false;
+    }
+    droneIdLength = fieldLength;
+    return true;
+}
+
+void AuthCodec::encodeAuthRequest(std::vector<uint8_t>& out, const std::string& droneId,
+                                  const std::vector<uint8_t>& commitment) {
+    out.clear();
+    out.push_back(MSG_AUTH_REQUEST);
+    appendField(out, (const uint8_t *)droneId.data(), droneId.length());
+    appendField(out, commitment.data(), commitment.size());
+}
+
+void AuthCodec::encodeChallenge(std::vector<uint8_t>& out, const std::string& challenge) {
+    out.clear();
+    out.push_back(MSG_CHALLENGE);
+    appendField(out, (const uint8_t *)challenge.data(), challenge.length());
+}
+
+void AuthCodec::encodeProof(std::vector<uint8_t>& out, const ZKProof& proof) {
+    out.clear();
+    out.push_back(MSG_PROOF);
+    appendField(out, proof.proofData.data(), proof.proofData.size());
+    appendField(out, proof.commitment.data(), proof.commitment.size());
+    appendField(out, (const uint8_t *)proof.challenge.data(), proof.challenge.length());
+    if (!proof.nextCommitment.empty()) {
+        appendField(out, proof.nextCommitment.data(), proof.nextCommitment.size());
+    }
+    out.insert(out.end(), (const uint8_t *)&proof.timestamp, (const uint8_t *)&proof.timestamp + 8);
+}
+
+void AuthCodec::encodeVerdict(std::vector<uint8_t>& out, bool success) {
+    out.clear();
+    out.push_back(success ? MSG_AUTH_SUCCESS : MSG_AUTH_FAILURE);
+}
+
+void AuthCodec::encodeWakeSchedule(std::vector<uint8_t>& out, const WakeSchedule& schedule) {
+    out.clear();
+    out.push_back(MSG_WAKE_SCHEDULE);
+    out.insert(out.end(), (const uint8_t *)&schedule.offsetMs, (const uint8_t *)&schedule.offsetMs + 4);
+    out.insert(out.end(), (const uint8_t *)&schedule.periodMs, (const uint8_t *)&schedule.periodMs + 4);
+    out.insert(out.end(), (const uint8_t *)&schedule.windowMs, (const uint8_t *)&schedule.windowMs + 4);
+}
+
+WakeSchedule AuthCodec::scheduleWake(const std::string& droneId, uint64_t nowMs, uint32_t periodMs, uint32_t windowMs) {
+    uint64_t hash = 14695981039346656037ULL;  // FNV-1a
+    for (unsigned char c : droneId) {
+        hash = (hash ^ c) * 1099511628211ULL;
+    }
+    WakeSchedule schedule;
+    schedule.periodMs = periodMs;
+    schedule.windowMs = windowMs;
+    uint64_t phase = hash % periodMs;
+    schedule.offsetMs = (phase + periodMs - nowMs % periodMs) % periodMs;
+    return schedule;
+}
+
+void AuthCodec::encodeRelay(std::vector<uint8_t>& out, uint32_t relayId, const uint8_t *datagram, size_t length) {
+    out.clear();
+    out.push_back(MSG_RELAY);
+    out.insert(out.end(), (const uint8_t *)&relayId, (const uint8_t *)&relayId + 4);
+    out.insert(out.end(), datagram, datagram + length);
+}
+
+void AuthCodec::encodeCredentials(std::vector<uint8_t>& out, const std::string& droneId,
+                                  const std::vector<uint8_t>& commitment, const std::vector<uint8_t>& nextCommitment) {
+    out.clear();
+    out.push_back(MSG_CREDENTIALS);
+    appendField(out, (const uint8_t *)droneId.data(), droneId.length());
+    appendField(out, commitment.data(), commitment.size());
+    appendField(out, nextCommitment.data(), nextCommitment.size());
+}
+
+} // namespace droneauth
@@ -0,0 +1,97 @@
+/**
+ * AuthCodec.h
+ * Wire format of the drone authentication protocol
+ *
+ *   AUTH_REQUEST  [0x01] [droneId_len(4)] [droneId] [commitment_len(4)] [commitment]
+ *   CHALLENGE     [0x02] [challenge_len(4)] [challenge]
+ *   PROOF         [0x03] [ZKProof::serialize()]
+ *                 [proof_len(4)] [proof] [commitment_len(4)] [commitment]
+ *                 [challenge_len(4)] [challenge] ([next_len(4)] [next_commitment])
+ *                 [timestamp(8)]
+ *   AUTH_SUCCESS  [0x04]
+ *   AUTH_FAILURE  [0x05]
+ *   WAKE_SCHEDULE [0x06] [offset_ms(4)] [period_ms(4)] [window_ms(4)]
+ *
+ * WAKE_SCHEDULE (power save) goes out just before an AUTH_SUCCESS. The
+ * drone's wake windows open offset_ms after it arrives and every period_ms
+ * after that, each for window_ms; the radio may be off in between.
+ *
+ * Backhaul between edge ground stations and the central verifier:
+ *
+ *   RELAY         [0x20] [relayId(4)] [datagram]
+ *   CREDENTIALS   [0x21] [droneId_len(4)] [droneId] [commitment_len(4)] [commitment]
+ *                 [next_len(4)] [next_commitment]
+ *
+ * Lengths are host-endian uint32, as written by the original apps.
+ */
+
+#ifndef AUTHCODEC_H_
+#define AUTHCODEC_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "ZKPModule.h"
+
+namespace droneauth {
+
+enum AuthMessageType : uint8_t {
+    MSG_AUTH_REQUEST = 0x01,
+    MSG_CHALLENGE = 0x02,
+    MSG_PROOF = 0x03,
+    MSG_AUTH_SUCCESS = 0x04,
+    MSG_AUTH_FAILURE = 0x05,
+    MSG_WAKE_SCHEDULE = 0x06,
+    MSG_RELAY = 0x20,
+    MSG_CREDENTIALS = 0x21,
+};
+
+struct WakeSchedule {
+    uint32_t offsetMs = 0;
+    uint32_t periodMs = 0;
+    uint32_t windowMs = 0;
+};
+
+class AuthCodec {
+public:
+    // Decoders return false on truncated or inconsistent input
+    static bool decodeAuthRequest(const uint8_t *data, size_t length,
+                                  std::string& droneId, std::vector<uint8_t>& commitment);
+    static bool decodeChallenge(const uint8_t *data, size_t length, std::string& challenge);
+    static bool decodeProof(const uint8_t *data, size_t length, ZKProof& proof);
+
+    // Relayed datagram, in place (no copy)
+    static bool decodeRelay(const uint8_t *data, size_t length, uint32_t& relayId,
+                            const uint8_t *& datagram, size_t& datagramLength);
+    static bool decodeCredentials(const uint8_t *data, size_t length, std::string& droneId,
+                                  std::vector<uint8_t>& commitment, std::vector<uint8_t>& nextCommitment);
+    // Also false for a zero period, or a window or offset that does not fit in it
+    static bool decodeWakeSchedule(const uint8_t *data, size_t length, WakeSchedule& schedule);
+
+    // Commitment inside an AUTH_REQUEST or PROOF, in place (no copy)
+    static bool peekCommitment(const uint8_t *data, size_t length,
+                               const uint8_t *& commitment, size_t& commitmentLength);
+    // Drone ID inside an AUTH_REQUEST, in place (no copy)
+    static bool peekDroneId(const uint8_t *data, size_t length,
+                            const uint8_t *& droneId, size_t& droneIdLength);
+
+    // Schedule sent to a drone at nowMs; windows sit at a phase derived from its
+    // ID, so it keeps its place in the period across handshakes and ground stations
+    static WakeSchedule scheduleWake(const std::string& droneId, uint64_t nowMs, uint32_t periodMs, uint32_t windowMs);
+
+    // Encoders replace the contents of out (its capacity is reused)
+    static void encodeAuthRequest(std::vector<uint8_t>& out, const std::string& droneId,
+                                  const std::vector<uint8_t>& commitment);
+    static void encodeChallenge(std::vector<uint8_t>& out, const std::string& challenge);
+    static void encodeProof(std::vector<uint8_t>& out, const ZKProof& proof);
+    static void encodeVerdict(std::vector<uint8_t>& out, bool success);
+    static void encodeWakeSchedule(std::vector<uint8_t>& out, const WakeSchedule& schedule);
+    static void encodeRelay(std::vector<uint8_t>& out, uint32_t relayId, const uint8_t *datagram, size_t length);
+    static void encodeCredentials(std::vector<uint8_t>& out, const std::string& droneId,
+                                  const std::vector<uint8_t>& commitment, const std::vector<uint8_t>& nextCommitment);
+};
+
+} // namespace droneauth
+
+#endif /* AUTHCODEC_H_ */
@@ -0,0 +1,449 @@
+/**
+ * AuthEngine.cc
+ */
+
+#include "AuthEngine.h"
+
+namespace droneauth {
+
+// ---------------------------------------------------------------------------
+// DroneEngine
+// ---------------------------------------------------------------------------
+
+DroneEngine::DroneEngine(const DroneConfig& config, PerfRegistry *perf)
+    : config(config) {
+    for (ZKPModule& prover : provers) {
+        prover.setPerfRegistry(perf);
+        prover.setup();
+    }
+    if (config.provisionedNonce.empty()) {
+        initializeCredentials(provers[active]);
+    } else {
+        // The commitment the ground station was provisioned with; rotation draws fresh nonces
+        provers[active].initializeProver(config.droneId, config.password, config.provisionedNonce);
+        provers[active].createCommitment();
+    }
+    commitment = provers[active].getCommitment();
+}
+
+void DroneEngine::initializeCredentials(ZKPModule& prover) {
+    if (config.passwordKey.empty()) {
+        prover.initializeProver(config.droneId, config.password);
+    } else {
+        prover.initializeProverFromKey(config.droneId, config.passwordKey);
+    }
+    prover.createCommitment();
+}
+
+void DroneEngine::prepareNextCredentials() {
+    preparePending = false;
+    ZKPModule& standby = provers[active ^ 1];
+    initializeCredentials(standby);
+    proof.nextCommitment = standby.getCommitment();
+    // The announcing PROOF is longer; grow the buffer now rather than on send
+    encodeBuffer.reserve(encodeBuffer.capacity() + 4 + proof.nextCommitment.size());
+}
+
+void DroneEngine::start(double startDelay, DroneOutput& out) {
+    out = DroneOutput();
+    out.timers[DRONE_TIMER_REQUEST].arm(startDelay);
+}
+
+void DroneEngine::onTimer(DroneTimer timer, DroneOutput& out) {
+    out = DroneOutput();
+    switch (timer) {
+        case DRONE_TIMER_REQUEST:
+            // A host that never ran the PREPARE timer still announces; this is
+            // not on the verdict path either
+            if (preparePending) {
+                prepareNextCredentials();
+                out.timers[DRONE_TIMER_PREPARE].cancel();
+            }
+            AuthCodec::encodeAuthRequest(encodeBuffer, config.droneId, commitment);
+            out.event = DRONE_EVENT_REQUEST_SENT;
+            out.datagram = ByteSpan(encodeBuffer);
+            out.timers[DRONE_TIMER_TIMEOUT].arm(config.authTimeout);
+            phase = REQUESTED;
+            announced = false;
+            break;
+
+        case DRONE_TIMER_PROOF: {
+            if (phase == IDLE) {
+                break;  // the handshake timed out while the proof was computed
+            }
+            provers[active].generateProof(currentChallenge, proof);
+            AuthCodec::encodeProof(encodeBuffer, proof);
+            out.event = DRONE_EVENT_PROOF_SENT;
+            out.datagram = ByteSpan(encodeBuffer);
+            phase = PROVED;
+            announced = !proof.nextCommitment.empty();
+            break;
+        }
+
+        case DRONE_TIMER_TIMEOUT:
+            out.event = DRONE_EVENT_TIMEOUT;
+            out.timers[DRONE_TIMER_PROOF].cancel();
+            out.timers[DRONE_TIMER_REQUEST].arm(config.retryInterval);
+            phase = IDLE;
+            break;
+
+        case DRONE_TIMER_PREPARE:
+            if (preparePending) {
+                prepareNextCredentials();
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+void DroneEngine::onDatagram(ByteSpan datagram, DroneOutput& out) {
+    out = DroneOutput();
+    if (datagram.empty()) {
+        return;
+    }
+    switch (datagram.data[0]) {
+        case MSG_CHALLENGE:
+            if (phase != REQUESTED) {
+                out.event = DRONE_EVENT_UNEXPECTED;
+                return;
+            }
+            if (!AuthCodec::decodeChallenge(datagram.data, datagram.size, currentChallenge)) {
+                out.event = DRONE_EVENT_MALFORMED;
+                return;
+            }
+            out.event = DRONE_EVENT_CHALLENGE;
+            out.timers[DRONE_TIMER_PROOF].arm(config.proofDelay);
+            break;
+
+        case MSG_AUTH_SUCCESS:
+            // Only a proof of this handshake can be accepted
+            if (phase != PROVED) {
+                out.event = DRONE_EVENT_UNEXPECTED;
+                return;
+            }
+            phase = IDLE;
+            out.event = DRONE_EVENT_SUCCESS;
+            out.timers[DRONE_TIMER_REQUEST].cancel();
+            out.timers[DRONE_TIMER_TIMEOUT].cancel();
+            if (config.rotationInterval <= 0) {
+                break;
+            }
+            // The accepted proof announced the standby credentials: switch to
+            // them, keeping the old ones until the new ones have succeeded once
+            if (announced) {
+                active ^= 1;
+                previousCommitment.swap(commitment);
+                commitment.swap(proof.nextCommitment);
+                proof.nextCommitment.clear();
+                announced = false;
+                confirming = true;
+                out.rotated = true;
+            } else if (confirming) {
+                confirming = false;
+            }
+            // Derive the next standby in its own host event, not before the
+            // success is reported
+            if (!confirming && proof.nextCommitment.empty()) {
+                preparePending = true;
+                out.timers[DRONE_TIMER_PREPARE].arm(0);
+            }
+            out.timers[DRONE_TIMER_REQUEST].arm(config.rotationInterval);
+            break;
+
+        case MSG_AUTH_FAILURE:
+            if (phase == IDLE) {
+                out.event = DRONE_EVENT_UNEXPECTED;
+                return;
+            }
+            phase = IDLE;
+            out.event = DRONE_EVENT_FAILURE;
+            out.timers[DRONE_TIMER_PROOF].cancel();
+            out.timers[DRONE_TIMER_TIMEOUT].cancel();
+            if (confirming) {
+                // The ground station does not hold the new commitment (the
+                // announcement was lost or altered): back to the old
+                // credentials, announcing the new ones again
+                active ^= 1;
+                commitment.swap(previousCommitment);
+                proof.nextCommitment = previousCommitment;
+                confirming = false;
+                out.rolledBack = true;
+                out.timers[DRONE_TIMER_REQUEST].arm(config.retryInterval);
+            }
+            break;
+
+        default:
+            out.event = DRONE_EVENT_UNKNOWN_TYPE;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// GroundStationEngine
+// ---------------------------------------------------------------------------
+
+GroundStationEngine::GroundStationEngine(const GroundStationConfig& config, PerfRegistry *perf)
+    : config(config), perf(perf) {
+}
+
+GroundStationEngine::~GroundStationEngine() {
+    for (auto& pair : droneVerifiers) {
+        delete pair.second;
+    }
+}
+
+void GroundStationEngine::onDatagram(ByteSpan datagram, GroundStationOutput& out) {
+    out.event = GS_EVENT_NONE;
+    out.msgType = 0;
+    out.newDrone = false;
+    out.rotated = false;
+    out.droneId.clear();
+    out.datagram = ByteSpan();
+    if (datagram.empty()) {
+        return;
+    }
+    out.msgType = datagram.data[0];
+    switch (out.msgType) {
+        case MSG_AUTH_REQUEST:
+            handleAuthRequest(datagram, out);
+            break;
+        case MSG_PROOF:
+            handleProof(datagram, out);
+            break;
+        default:
+            out.event = GS_EVENT_UNKNOWN_TYPE;
+    }
+}
+
+void GroundStationEngine::handleAuthRequest(ByteSpan datagram, GroundStationOutput& out) {
+    ScopedTimer timer(perf, PERF_GS_AUTH_REQUEST);
+    if (!AuthCodec::decodeAuthRequest(datagram.data, datagram.size, out.droneId, commitment)) {
+        out.event = GS_EVENT_MALFORMED;
+        replyVerdict(false, out);
+        return;
+    }
+    if (config.authorizedDrones.count(out.droneId) == 0) {
+        out.event = GS_EVENT_UNAUTHORIZED;
+        replyVerdict(false, out);
+        return;
+    }
+
+    // Create or get verifier for this drone
+    ZKPModule *verifier = nullptr;
+    auto it = droneVerifiers.find(out.droneId);
+    if (it == droneVerifiers.end()) {
+        verifier = createVerifier(out.droneId, commitment);
+        out.newDrone = true;
+    } else {
+        verifier = it->second;
+    }
+
+    // A new request supersedes the drone's outstanding challenge
+    std::string& pending = pendingChallenges[out.droneId];
+    if (pending.empty()) {
+        numPendingChallenges++;
+    }
+    if (!config.challengeSource || !config.challengeSource(out.droneId, pending)) {
+        verifier->generateChallenge(pending);
+    }
+
+    AuthCodec::encodeChallenge(encodeBuffer, pending);
+    out.event = GS_EVENT_CHALLENGE_SENT;
+    out.datagram = ByteSpan(encodeBuffer);
+}
+
+void GroundStationEngine::handleProof(ByteSpan datagram, GroundStationOutput& out) {
+    ScopedTimer timer(perf, PERF_GS_PROOF);
+    if (!AuthCodec::decodeProof(datagram.data, datagram.size, proof)) {
+        out.event = GS_EVENT_MALFORMED;
+        replyVerdict(false, out);
+        return;
+    }
+    // The proof must answer the challenge outstanding for the drone that owns its commitment
+    auto owner = commitmentToDrone.find(proof.commitment);
+    if (owner == commitmentToDrone.end()) {
+        out.event = GS_EVENT_UNKNOWN_CHALLENGE;
+        replyVerdict(false, out);
+        return;
+    }
+    std::string& pending = pendingChallenges[owner->second];
+    if (pending.empty() || pending != proof.challenge) {
+        out.event = GS_EVENT_UNKNOWN_CHALLENGE;
+        replyVerdict(false, out);
+        return;
+    }
+    out.droneId = owner->second;
+    ZKPModule *verifier = droneVerifiers[out.droneId];
+    // A proof with the announced commitment is the first handshake of the new
+    // credentials. The announcement itself is unverifiable, so the current
+    // commitment is retired only once this proof passes.
+    auto next = nextCommitments.find(out.droneId);
+    bool promoting = next != nextCommitments.end() && !next->second.empty() && next->second == proof.commitment;
+    if (promoting) {
+        retiredCommitment = verifier->getCommitment();
+        verifier->initializeVerifier(proof.commitment, out.droneId);
+    }
+    if (verifier->verifyProof(proof)) {
+        out.event = GS_EVENT_PROOF_VALID;
+        pending.clear();
+        numPendingChallenges--;
+        if (promoting) {
+            commitmentToDrone.erase(retiredCommitment);
+            next->second.clear();
+            out.rotated = true;
+        }
+        // Kept beside the current commitment until a handshake with it succeeds
+        if (!proof.nextCommitment.empty() && setNextCommitment(out.droneId, proof.nextCommitment)) {
+            out.rotated = true;
+        }
+        replyVerdict(true, out);
+    } else {
+        if (promoting) {
+            verifier->initializeVerifier(retiredCommitment, out.droneId);
+        }
+        out.event = GS_EVENT_PROOF_INVALID;
+        replyVerdict(false, out);
+    }
+}
+
+bool GroundStationEngine::setNextCommitment(const std::string& droneId, const std::vector<uint8_t>& nextCommitment) {
+    auto owner = commitmentToDrone.find(nextCommitment);
+    if (owner != commitmentToDrone.end() && owner->second != droneId) {
+        return false;  // would take over another drone's proofs
+    }
+    std::vector<uint8_t>& next = nextCommitments[droneId];
+    if (next == nextCommitment) {
+        return false;
+    }
+    if (!next.empty() && next != droneVerifiers[droneId]->getCommitment()) {
+        commitmentToDrone.erase(next);
+    }
+    next = nextCommitment;
+    if (!next.empty()) {
+        commitmentToDrone[next] = droneId;
+    }
+    return true;
+}
+
+ZKPModule *GroundStationEngine::createVerifier(const std::string& droneId, const std::vector<uint8_t>& commitment) {
+    ZKPModule *verifier = new ZKPModule();
+    verifier->setPerfRegistry(perf);
+    verifier->setup();
+    verifier->initializeVerifier(commitment, droneId);
+    droneVerifiers[droneId] = verifier;
+    commitmentToDrone[commitment] = droneId;
+    return verifier;
+}
+
+void GroundStationEngine::setAuthorized(const std::string& droneId, bool authorized) {
+    if (authorized) {
+        config.authorizedDrones.insert(droneId);
+    } else {
+        config.authorizedDrones.erase(droneId);
+    }
+}
+
+bool GroundStationEngine::getEnrollment(const std::string& droneId, std::vector<uint8_t>& commitment,
+                                        std::vector<uint8_t> *nextCommitment) const {
+    auto it = droneVerifiers.find(droneId);
+    if (it == droneVerifiers.end()) {
+        return false;
+    }
+    commitment = it->second->getCommitment();
+    if (nextCommitment != nullptr) {
+        auto next = nextCommitments.find(droneId);
+        if (next != nextCommitments.end()) {
+            *nextCommitment = next->second;
+        } else {
+            nextCommitment->clear();
+        }
+    }
+    return true;
+}
+
+void GroundStationEngine::setEnrollment(const std::string& droneId, const std::vector<uint8_t>& commitment,
+                                        const std::vector<uint8_t> *nextCommitment) {
+    auto it = droneVerifiers.find(droneId);
+    if (it == droneVerifiers.end()) {
+        createVerifier(droneId, commitment);
+    } else {
+        ZKPModule *verifier = it->second;
+        std::vector<uint8_t> current = verifier->getCommitment();
+        if (current != commitment) {
+            // An outstanding challenge stays valid; its proof must now carry the new commitment
+            commitmentToDrone.erase(current);
+            verifier->initializeVerifier(commitment, droneId);
+            commitmentToDrone[commitment] = droneId;
+            auto next = nextCommitments.find(droneId);
+            if (next != nextCommitments.end() && next->second == commitment) {
+                next->second.clear();
+            }
+        }
+    }
+    if (nextCommitment != nullptr && *nextCommitment != commitment) {
+        setNextCommitment(droneId, *nextCommitment);
+    }
+}
+
+bool GroundStationEngine::hasCredentials(const std::string& droneId, const std::vector<uint8_t>& commitment) const {
+    auto it = droneVerifiers.find(droneId);
+    if (it == droneVerifiers.end() || config.authorizedDrones.count(droneId) == 0) {
+        return false;
+    }
+    if (it->second->getCommitment() == commitment) {
+        return true;
+    }
+    auto next = nextCommitments.find(droneId);
+    return next != nextCommitments.end() && !next->second.empty() && next->second == commitment;
+}
+
+void GroundStationEngine::forgetDrone(const std::string& droneId) {
+    config.authorizedDrones.erase(droneId);
+    auto next = nextCommitments.find(droneId);
+    if (next != nextCommitments.end()) {
+        if (!next->second.empty()) {
+            commitmentToDrone.erase(next->second);
+        }
+        nextCommitments.erase(next);
+    }
+    auto pending = pendingChallenges.find(droneId);
+    if (pending != pendingChallenges.end()) {
+        if (!pending->second.empty()) {
+            numPendingChallenges--;
+        }
+        pendingChallenges.erase(pending);
+    }
+    auto it = droneVerifiers.find(droneId);
+    if (it != droneVerifiers.end()) {
+        commitmentToDrone.erase(it->second->getCommitment());
+        delete it->second;
+        droneVerifiers.erase(it);
+    }
+}
+
+bool GroundStationEngine::getPendingChallenge(const std::string& droneId, std::string& challenge) const {
+    auto it = pendingChallenges.find(droneId);
+    if (it == pendingChallenges.end() || it->second.empty()) {
+        return false;
+    }
+    challenge = it->second;
+    return true;
+}
+
+void GroundStationEngine::setPendingChallenge(const std::string& droneId, const std::string& challenge) {
+    std::string& pending = pendingChallenges[droneId];
+    if (pending.empty() && !challenge.empty()) {
+        numPendingChallenges++;
+    } else if (!pending.empty() && challenge.empty()) {
+        numPendingChallenges--;
+    }
+    pending = challenge;
+}
+
+void GroundStationEngine::replyVerdict(bool success, GroundStationOutput& out) {
+    AuthCodec::encodeVerdict(encodeBuffer, success);
+    out.datagram = ByteSpan(encodeBuffer);
+}
+
+} // namespace droneauth
@@ -0,0 +1,228 @@
+/**
+ * AuthEngine.h
+ * Drone and ground-station protocol state machines, independent of
+ * OMNeT++/INET: datagrams in, datagrams and timer requests out.
+ *
+ * A host (the simulation apps, tools/engine_bench, a real UDP daemon) owns
+ * the sockets and timers. It feeds every received datagram and every expired
+ * timer into the engine and carries out the returned output. Output buffers
+ * belong to the engine and stay valid until its next call.
+ */
+
+#ifndef AUTHENGINE_H_
+#define AUTHENGINE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include "AuthCodec.h"
+#include "PerfTimer.h"
+#include "ZKPModule.h"
+
+namespace droneauth {
+
+struct ByteSpan {
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+
+    ByteSpan() {}
+    ByteSpan(const uint8_t *data, size_t size) : data(data), size(size) {}
+    explicit ByteSpan(const std::vector<uint8_t>& bytes) : data(bytes.data()), size(bytes.size()) {}
+    bool empty() const { return size == 0; }
+};
+
+// Change to one host timer; delays are in seconds from now
+struct TimerRequest {
+    enum Op : uint8_t { KEEP, ARM, CANCEL };
+    Op op = KEEP;
+    double delay = 0;
+
+    void arm(double d) { op = ARM; delay = d; }
+    void cancel() { op = CANCEL; }
+};
+
+// ---------------------------------------------------------------------------
+// Drone
+// ---------------------------------------------------------------------------
+
+enum DroneTimer {
+    DRONE_TIMER_REQUEST,    // send the (next) authentication request
+    DRONE_TIMER_PROOF,      // proof computation done, send it
+    DRONE_TIMER_TIMEOUT,    // no verdict within authTimeout
+    DRONE_TIMER_PREPARE,    // derive the next credentials, after the verdict went out
+    DRONE_TIMER_COUNT
+};
+
+enum DroneEvent {
+    DRONE_EVENT_NONE,
+    DRONE_EVENT_REQUEST_SENT,
+    DRONE_EVENT_CHALLENGE,      // PROOF timer armed with proofDelay; the host may change the delay
+    DRONE_EVENT_PROOF_SENT,
+    DRONE_EVENT_SUCCESS,
+    DRONE_EVENT_FAILURE,
+    DRONE_EVENT_TIMEOUT,
+    DRONE_EVENT_MALFORMED,
+    DRONE_EVENT_UNKNOWN_TYPE,
+    DRONE_EVENT_UNEXPECTED      // challenge or verdict for no handshake in flight; ignored
+};
+
+struct DroneConfig {
+    std::string droneId;
+    std::string password;
+    double authTimeout = 5;
+    double retryInterval = 10;
+    double proofDelay = 0.001;
+    double rotationInterval = 0;    // re-authenticate this long after a success with fresh credentials; 0 = never
+    std::vector<uint8_t> passwordKey;  // memory-hard password key (KeyCache.h); empty = hash the password itself
+    std::vector<uint8_t> provisionedNonce;  // fleet table (FleetTable.h): first credentials from this nonce; empty = a fresh one
+};
+
+struct DroneOutput {
+    DroneEvent event = DRONE_EVENT_NONE;
+    ByteSpan datagram;                          // to the ground station; empty = nothing to send
+    TimerRequest timers[DRONE_TIMER_COUNT];
+    bool rotated = false;                       // switched to the credentials announced in the last proof
+    bool rolledBack = false;                    // those were refused; back on the previous ones
+};
+
+// Credentials are double-buffered: the active prover authenticates while the
+// standby one holds the next secret. Its commitment rides in every PROOF
+// until a success confirms the ground station has it, and the drone then
+// switches buffers. Only a success answering a proof of the current
+// handshake switches, and only if that proof carried the announcement.
+//
+// The verifier cannot check the announcement, so a relay may have altered
+// it. The ground station keeps the old commitment valid until a handshake
+// with the new one succeeds, and the drone keeps the old secret until then:
+// a refused handshake with the new credentials switches it back, and it
+// announces them again.
+class DroneEngine {
+public:
+    // Creates the prover and its commitment
+    DroneEngine(const DroneConfig& config, PerfRegistry *perf = nullptr);
+
+    // Arms the first request after startDelay
+    void start(double startDelay, DroneOutput& out);
+    void onTimer(DroneTimer timer, DroneOutput& out);
+    void onDatagram(ByteSpan datagram, DroneOutput& out);
+
+    const DroneConfig& getConfig() const { return config; }
+    const ZKPModule& getProver() const { return provers[active]; }
+    // Announced in the next PROOF; empty = none
+    const std::vector<uint8_t>& getNextCommitment() const { return proof.nextCommitment; }
+    const std::string& getCurrentChallenge() const { return currentChallenge; }
+
+private:
+    enum Phase { IDLE, REQUESTED, PROVED };
+
+    void initializeCredentials(ZKPModule& prover);
+    void prepareNextCredentials();
+
+    DroneConfig config;
+    ZKPModule provers[2];
+    int active = 0;                   // provers[active ^ 1] is the standby
+    Phase phase = IDLE;               // of the handshake in flight
+    bool announced = false;           // the PROOF of this handshake carried nextCommitment
+    bool preparePending = false;      // the PREPARE timer has not run yet
+    bool confirming = false;          // switched, but no handshake with the new credentials succeeded yet
+    std::vector<uint8_t> previousCommitment;  // of provers[active ^ 1] while confirming
+    std::vector<uint8_t> commitment;
+    std::string currentChallenge;
+    ZKProof proof;                    // generateProof scratch
+    std::vector<uint8_t> encodeBuffer;
+};
+
+// ---------------------------------------------------------------------------
+// Ground station
+// ---------------------------------------------------------------------------
+
+enum GroundStationEvent {
+    GS_EVENT_NONE,                  // empty datagram
+    GS_EVENT_CHALLENGE_SENT,
+    GS_EVENT_UNAUTHORIZED,
+    GS_EVENT_MALFORMED,
+    GS_EVENT_UNKNOWN_CHALLENGE,
+    GS_EVENT_PROOF_VALID,
+    GS_EVENT_PROOF_INVALID,
+    GS_EVENT_UNKNOWN_TYPE
+};
+
+struct GroundStationConfig {
+    std::set<std::string> authorizedDrones = {
+        "DRONE_001", "DRONE_002", "DRONE_003", "DRONE_004", "DRONE_005"
+    };
+    // Trace replay: supplies the challenge for a drone's AUTH_REQUEST so that
+    // recorded proofs verify; false (or unset) issues a fresh random challenge
+    std::function<bool(const std::string& droneId, std::string& challenge)> challengeSource;
+};
+
+struct GroundStationOutput {
+    GroundStationEvent event = GS_EVENT_NONE;
+    uint8_t msgType = 0;            // type byte of the handled datagram
+    bool newDrone = false;          // a verifier was created for droneId
+    bool rotated = false;           // the drone announced or switched to new credentials
+    std::string droneId;            // when known
+    ByteSpan datagram;              // reply to the sender; empty = nothing to send
+};
+
+class GroundStationEngine {
+public:
+    explicit GroundStationEngine(const GroundStationConfig& config = GroundStationConfig(),
+                                 PerfRegistry *perf = nullptr);
+    ~GroundStationEngine();
+
+    void onDatagram(ByteSpan datagram, GroundStationOutput& out);
+
+    size_t getNumDrones() const { return droneVerifiers.size(); }
+    size_t getNumPendingChallenges() const { return numPendingChallenges; }
+
+    // Authorization data, read and written by replication (AuthSync.h)
+    bool isAuthorized(const std::string& droneId) const { return config.authorizedDrones.count(droneId) != 0; }
+    void setAuthorized(const std::string& droneId, bool authorized);
+    // Commitment the drone is verified against and the announced next one (empty
+    // if none); false if it never enrolled here
+    bool getEnrollment(const std::string& droneId, std::vector<uint8_t>& commitment,
+                       std::vector<uint8_t> *nextCommitment = nullptr) const;
+    // Pins the drone to a commitment enrolled at another ground station, and
+    // with nextCommitment also to its announced next one
+    void setEnrollment(const std::string& droneId, const std::vector<uint8_t>& commitment,
+                       const std::vector<uint8_t> *nextCommitment = nullptr);
+    // An AUTH_REQUEST with this commitment would be challenged against known credentials
+    bool hasCredentials(const std::string& droneId, const std::vector<uint8_t>& commitment) const;
+    // Drops the drone's authorization, verifier and any outstanding challenge
+    void forgetDrone(const std::string& droneId);
+    // Challenge outstanding for the drone, for a hot standby (SessionLog.h);
+    // false if none. An empty challenge clears it.
+    bool getPendingChallenge(const std::string& droneId, std::string& challenge) const;
+    void setPendingChallenge(const std::string& droneId, const std::string& challenge);
+
+private:
+    void handleAuthRequest(ByteSpan datagram, GroundStationOutput& out);
+    void handleProof(ByteSpan datagram, GroundStationOutput& out);
+    void replyVerdict(bool success, GroundStationOutput& out);
+    // Records the announced commitment; false if unchanged or owned by another drone
+    bool setNextCommitment(const std::string& droneId, const std::vector<uint8_t>& nextCommitment);
+    ZKPModule *createVerifier(const std::string& droneId, const std::vector<uint8_t>& commitment);
+
+    GroundStationConfig config;
+    PerfRegistry *perf;
+    // Entries live as long as the drone's verifier, so a steady-state handshake
+    // inserts nothing; an empty challenge means none is outstanding
+    std::map<std::string, ZKPModule *> droneVerifiers;
+    std::map<std::string, std::string> pendingChallenges;           // droneId -> challenge
+    std::map<std::vector<uint8_t>, std::string> commitmentToDrone;  // current and announced; proofs carry the commitment
+    std::map<std::string, std::vector<uint8_t>> nextCommitments;    // announced, no handshake with it succeeded yet
+    size_t numPendingChallenges = 0;
+    std::vector<uint8_t> commitment;  // decode scratch
+    std::vector<uint8_t> retiredCommitment;  // scratch
+    ZKProof proof;                    // decode scratch
+    std::vector<uint8_t> encodeBuffer;
+};
+
+} // namespace droneauth
+
+#endif /* AUTHENGINE_H_ */
@@ -0,0 +1,316 @@
+/**
+ * AuthSync.cc
+ */
+
+#include "AuthSync.h"
+#include <algorithm>
+#include <cstring>
+#include <openssl/sha.h>
+
+namespace droneauth {
+
+static const size_t NODES_HEADER = 4;   // type, level, count
+static const size_t NODE_ENTRY = 4 + SYNC_HASH_SIZE;
+
+template <typename T>
+static void appendValue(std::vector<uint8_t>& out, T value) {
+    out.insert(out.end(), (const uint8_t *)&value, (const uint8_t *)&value + sizeof(T));
+}
+
+template <typename T>
+static bool readValue(const uint8_t *data, size_t length, size_t& offset, T& value) {
+    if (length - offset < sizeof(T)) {
+        return false;
+    }
+    std::memcpy(&value, data + offset, sizeof(T));
+    offset += sizeof(T);
+    return true;
+}
+
+static void computeDigest(const std::string& droneId, ReplicaRecord& record) {
+    std::vector<uint8_t> input;
+    input.push_back((uint8_t)droneId.size());
+    input.insert(input.end(), droneId.begin(), droneId.end());
+    input.push_back(record.authorized ? 1 : 0);
+    appendValue(input, record.version);
+    appendValue(input, record.changedAt);
+    input.insert(input.end(), record.commitment.begin(), record.commitment.end());
+    SHA256(input.data(), input.size(), record.digest);
+}
+
+// Same total order on every replica
+static bool supersedes(const ReplicaRecord& a, const ReplicaRecord& b) {
+    if (a.version != b.version) {
+        return a.version > b.version;
+    }
+    if (a.commitment != b.commitment) {
+        return a.commitment > b.commitment;
+    }
+    return a.authorized && !b.authorized;
+}
+
+AuthReplica::AuthReplica(int depth) : depth(depth) {
+    int numNodes = 0;
+    int levelSize = 1;
+    for (int level = 0; level <= depth; level++) {
+        levelOffsets.push_back(numNodes);
+        numNodes += levelSize;
+        levelSize *= SYNC_FANOUT;
+    }
+    numBuckets = levelSize / SYNC_FANOUT;
+    hashes.assign(numNodes * SYNC_HASH_SIZE, 0);
+    dirty.assign(numNodes, true);
+    buckets.resize(numBuckets);
+}
+
+int AuthReplica::bucketOf(const std::string& droneId) const {
+    uint64_t hash = 14695981039346656037ULL;
+    for (unsigned char c : droneId) {
+        hash = (hash ^ c) * 1099511628211ULL;
+    }
+    return hash % numBuckets;
+}
+
+const uint8_t *AuthReplica::nodeHash(int level, int index) {
+    int node = levelOffset(level) + index;
+    uint8_t *hash = &hashes[node * SYNC_HASH_SIZE];
+    if (level < depth && dirty[node]) {
+        uint8_t children[SYNC_FANOUT * SYNC_HASH_SIZE];
+        for (int child = 0; child < SYNC_FANOUT; child++) {
+            std::memcpy(children + child * SYNC_HASH_SIZE, nodeHash(level + 1, index * SYNC_FANOUT + child),
+                        SYNC_HASH_SIZE);
+        }
+        SHA256(children, sizeof(children), hash);
+        dirty[node] = false;
+    }
+    return hash;
+}
+
+const uint8_t *AuthReplica::getRootHash() {
+    return nodeHash(0, 0);
+}
+
+void AuthReplica::markDirty(int bucket) {
+    int index = bucket;
+    for (int level = depth - 1; level >= 0; level--) {
+        index /= SYNC_FANOUT;
+        dirty[levelOffset(level) + index] = true;
+    }
+}
+
+void AuthReplica::store(const std::string& droneId, const ReplicaRecord& record) {
+    int bucket = bucketOf(droneId);
+    uint8_t *leaf = &hashes[(levelOffset(depth) + bucket) * SYNC_HASH_SIZE];
+    auto result = buckets[bucket].emplace(droneId, record);
+    ReplicaRecord& stored = result.first->second;
+    if (result.second) {
+        numRecords++;
+    } else {
+        for (size_t i = 0; i < SYNC_HASH_SIZE; i++) {
+            leaf[i] ^= stored.digest[i];
+        }
+        stored = record;
+    }
+    computeDigest(droneId, stored);
+    for (size_t i = 0; i < SYNC_HASH_SIZE; i++) {
+        leaf[i] ^= stored.digest[i];
+    }
+    markDirty(bucket);
+}
+
+bool AuthReplica::update(const std::string& droneId, bool authorized,
+                         const std::vector<uint8_t>& commitment, double now) {
+    ReplicaRecord record;
+    const ReplicaRecord *existing = find(droneId);
+    if (existing != nullptr) {
+        if (existing->authorized == authorized && existing->commitment == commitment) {
+            return false;
+        }
+        record.version = existing->version;
+    }
+    record.authorized = authorized;
+    record.commitment = commitment;
+    record.version++;
+    record.changedAt = now;
+    store(droneId, record);
+    return true;
+}
+
+const ReplicaRecord *AuthReplica::find(const std::string& droneId) const {
+    const Bucket& bucket = buckets[bucketOf(droneId)];
+    auto it = bucket.find(droneId);
+    return it != bucket.end() ? &it->second : nullptr;
+}
+
+void AuthReplica::beginSync(std::vector<std::vector<uint8_t>>& out) {
+    sendNodes(0, std::vector<int>(1, 0), out);
+}
+
+void AuthReplica::sendNodes(int level, const std::vector<int>& indexes, std::vector<std::vector<uint8_t>>& out) {
+    const size_t perMessage = (SYNC_MAX_DATAGRAM - NODES_HEADER) / NODE_ENTRY;
+    for (size_t first = 0; first < indexes.size(); first += perMessage) {
+        uint16_t count = std::min(perMessage, indexes.size() - first);
+        out.emplace_back();
+        std::vector<uint8_t>& message = out.back();
+        message.push_back(MSG_SYNC_NODES);
+        message.push_back((uint8_t)level);
+        appendValue(message, count);
+        for (size_t i = first; i < first + count; i++) {
+            appendValue(message, (uint32_t)indexes[i]);
+            const uint8_t *hash = nodeHash(level, indexes[i]);
+            message.insert(message.end(), hash, hash + SYNC_HASH_SIZE);
+        }
+    }
+}
+
+void AuthReplica::sendRecords(const std::vector<int>& bucketIndexes, bool wantReply,
+                              std::vector<std::vector<uint8_t>>& out) {
+    // Buckets are never split, so each message lists the buckets it carries completely
+    std::vector<uint32_t> messageBuckets;
+    std::vector<uint8_t> messageRecords;
+    uint16_t numMessageRecords = 0;
+    auto flush = [&]() {
+        if (messageBuckets.empty()) {
+            return;
+        }
+        out.emplace_back();
+        std::vector<uint8_t>& message = out.back();
+        message.push_back(MSG_SYNC_RECORDS);
+        message.push_back(wantReply ? 1 : 0);
+        appendValue(message, (uint16_t)messageBuckets.size());
+        for (uint32_t bucket : messageBuckets) {
+            appendValue(message, bucket);
+        }
+        appendValue(message, numMessageRecords);
+        message.insert(message.end(), messageRecords.begin(), messageRecords.end());
+        messageBuckets.clear();
+        messageRecords.clear();
+        numMessageRecords = 0;
+    };
+    std::vector<uint8_t> encoded;
+    for (int bucket : bucketIndexes) {
+        encoded.clear();
+        for (const auto& entry : buckets[bucket]) {
+            const std::string& droneId = entry.first;
+            const ReplicaRecord& record = entry.second;
+            encoded.push_back((uint8_t)droneId.size());
+            encoded.insert(encoded.end(), droneId.begin(), droneId.end());
+            encoded.push_back(record.authorized ? 1 : 0);
+            appendValue(encoded, record.version);
+            appendValue(encoded, record.changedAt);
+            encoded.push_back((uint8_t)record.commitment.size());
+            encoded.insert(encoded.end(), record.commitment.begin(), record.commitment.end());
+        }
+        size_t size = 6 + 4 * (messageBuckets.size() + 1) + messageRecords.size() + encoded.size();
+        if (size > SYNC_MAX_DATAGRAM) {
+            flush();
+        }
+        messageBuckets.push_back(bucket);
+        messageRecords.insert(messageRecords.end(), encoded.begin(), encoded.end());
+        numMessageRecords += buckets[bucket].size();
+    }
+    flush();
+}
+
+bool AuthReplica::onSyncMessage(const uint8_t *data, size_t length, std::vector<std::vector<uint8_t>>& replies,
+                                std::vector<std::string>& applied) {
+    if (!isSyncMessage(data, length)) {
+        return false;
+    }
+    if (data[0] == MSG_SYNC_NODES) {
+        return receiveNodes(data, length, replies);
+    }
+    return receiveRecords(data, length, replies, applied);
+}
+
+bool AuthReplica::receiveNodes(const uint8_t *data, size_t length, std::vector<std::vector<uint8_t>>& replies) {
+    size_t offset = 1;
+    uint8_t level;
+    uint16_t count;
+    if (!readValue(data, length, offset, level) || !readValue(data, length, offset, count)
+            || level > depth || length - offset < (size_t)count * NODE_ENTRY) {
+        return false;
+    }
+    int levelSize = (level == depth ? numBuckets : levelOffset(level + 1) - levelOffset(level));
+    std::vector<int> differing;
+    for (uint16_t i = 0; i < count; i++) {
+        uint32_t index = 0;
+        readValue(data, length, offset, index);  // length checked above
+        const uint8_t *theirs = data + offset;
+        offset += SYNC_HASH_SIZE;
+        if (index >= (uint32_t)levelSize) {
+            return false;
+        }
+        if (std::memcmp(theirs, nodeHash(level, index), SYNC_HASH_SIZE) != 0) {
+            differing.push_back(index);
+        }
+    }
+    if (differing.empty()) {
+        return true;  // this part of the tree has converged
+    }
+    if (level == depth) {
+        sendRecords(differing, true, replies);
+        return true;
+    }
+    std::vector<int> children;
+    for (int index : differing) {
+        for (int child = 0; child < SYNC_FANOUT; child++) {
+            children.push_back(index * SYNC_FANOUT + child);
+        }
+    }
+    sendNodes(level + 1, children, replies);
+    return true;
+}
+
+bool AuthReplica::receiveRecords(const uint8_t *data, size_t length, std::vector<std::vector<uint8_t>>& replies,
+                                 std::vector<std::string>& applied) {
+    size_t offset = 1;
+    uint8_t wantReply;
+    uint16_t numListed;
+    if (!readValue(data, length, offset, wantReply) || !readValue(data, length, offset, numListed)) {
+        return false;
+    }
+    std::vector<int> listed;
+    for (uint16_t i = 0; i < numListed; i++) {
+        uint32_t bucket;
+        if (!readValue(data, length, offset, bucket) || bucket >= (uint32_t)numBuckets) {
+            return false;
+        }
+        listed.push_back(bucket);
+    }
+    uint16_t numIncoming;
+    if (!readValue(data, length, offset, numIncoming)) {
+        return false;
+    }
+    std::string droneId;
+    ReplicaRecord incoming;
+    for (uint16_t i = 0; i < numIncoming; i++) {
+        uint8_t idLength;
+        uint8_t authorized;
+        uint8_t commitmentLength;
+        if (!readValue(data, length, offset, idLength) || length - offset < idLength) {
+            return false;
+        }
+        droneId.assign((const char *)data + offset, idLength);
+        offset += idLength;
+        if (!readValue(data, length, offset, authorized) || !readValue(data, length, offset, incoming.version)
+                || !readValue(data, length, offset, incoming.changedAt)
+                || !readValue(data, length, offset, commitmentLength) || length - offset < commitmentLength) {
+            return false;
+        }
+        incoming.authorized = authorized != 0;
+        incoming.commitment.assign(data + offset, data + offset + commitmentLength);
+        offset += commitmentLength;
+        const ReplicaRecord *existing = find(droneId);
+        if (existing == nullptr || supersedes(incoming, *existing)) {
+            store(droneId, incoming);
+            applied.push_back(droneId);
+        }
+    }
+    if (wantReply) {
+        sendRecords(listed, false, replies);
+    }
+    return true;
+}
+
+} // namespace droneauth
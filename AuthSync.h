@@ -0,0 +1,101 @@
+/**
+ * AuthSync.h
+ * Anti-entropy replication of ground-station authorization data.
+ *
+ * Each ground station keeps its authorization records (authorized flag and
+ * enrolled commitment per drone) in buckets under a Merkle tree of fanout
+ * SYNC_FANOUT. A leaf is the XOR of its records' digests, so one update
+ * touches one leaf and the path above it. A sync round walks down from the
+ * root and only descends into nodes whose hashes differ. Only the records
+ * of differing buckets cross, so k changes cost O(k log n) bytes rather
+ * than a copy of the whole set.
+ *
+ *   SYNC_NODES    [0x10] [level(1)] [count(2)] ([index(4)] [hash(32)]) x count
+ *   SYNC_RECORDS  [0x11] [wantReply(1)] [buckets(2)] [bucket(4)] x buckets
+ *                 [records(2)] ([id_len(1)] [id] [authorized(1)] [version(8)]
+ *                  [changedAt(8)] [commitment_len(1)] [commitment]) x records
+ *
+ * The exchange is stateless: every message is answered from the receiver's
+ * current tree. The peer that sees differing leaves sends its records for
+ * them with wantReply set, and the other side merges them and answers with
+ * its own. A record replaces another with a higher version, or with an
+ * equal version and a greater commitment, so all replicas pick the same
+ * winner.
+ */
+
+#ifndef AUTHSYNC_H_
+#define AUTHSYNC_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace droneauth {
+
+enum SyncMessageType : uint8_t {
+    MSG_SYNC_NODES = 0x10,
+    MSG_SYNC_RECORDS = 0x11,
+};
+
+static const int SYNC_FANOUT = 16;
+static const size_t SYNC_HASH_SIZE = 32;
+static const size_t SYNC_MAX_DATAGRAM = 1400;  // messages are split to fit one frame
+
+struct ReplicaRecord {
+    bool authorized = false;
+    std::vector<uint8_t> commitment;   // empty until the drone enrolled at some ground station
+    uint64_t version = 0;
+    double changedAt = 0;              // when the originating ground station made the change (s)
+    uint8_t digest[SYNC_HASH_SIZE];    // of droneId and the fields above
+};
+
+class AuthReplica {
+public:
+    // SYNC_FANOUT^depth leaf buckets
+    explicit AuthReplica(int depth = 3);
+
+    // Local change: the record gets the next version; false if nothing changed
+    bool update(const std::string& droneId, bool authorized, const std::vector<uint8_t>& commitment, double now);
+    const ReplicaRecord *find(const std::string& droneId) const;
+    size_t size() const { return numRecords; }
+    const uint8_t *getRootHash();
+
+    // Opens a round: the root hash for the peer to compare
+    void beginSync(std::vector<std::vector<uint8_t>>& out);
+    // Answers a peer's message; applied lists the drones whose records changed
+    // here (false if the message is malformed)
+    bool onSyncMessage(const uint8_t *data, size_t length, std::vector<std::vector<uint8_t>>& replies,
+                       std::vector<std::string>& applied);
+
+    static bool isSyncMessage(const uint8_t *data, size_t length) {
+        return length > 0 && (data[0] == MSG_SYNC_NODES || data[0] == MSG_SYNC_RECORDS);
+    }
+
+private:
+    typedef std::map<std::string, ReplicaRecord> Bucket;
+
+    int bucketOf(const std::string& droneId) const;
+    int levelOffset(int level) const { return levelOffsets[level]; }
+    const uint8_t *nodeHash(int level, int index);
+    void markDirty(int bucket);
+    void store(const std::string& droneId, const ReplicaRecord& record);
+    void sendNodes(int level, const std::vector<int>& indexes, std::vector<std::vector<uint8_t>>& out);
+    void sendRecords(const std::vector<int>& buckets, bool wantReply, std::vector<std::vector<uint8_t>>& out);
+    bool receiveNodes(const uint8_t *data, size_t length, std::vector<std::vector<uint8_t>>& replies);
+    bool receiveRecords(const uint8_t *data, size_t length, std::vector<std::vector<uint8_t>>& replies,
+                        std::vector<std::string>& applied);
+
+    int depth;
+    int numBuckets;
+    std::vector<int> levelOffsets;   // first node of each level in hashes/dirty
+    std::vector<uint8_t> hashes;     // SYNC_HASH_SIZE per node, root first
+    std::vector<bool> dirty;         // interior hash needs recomputing
+    std::vector<Bucket> buckets;
+    size_t numRecords = 0;
+};
+
+} // namespace droneauth
+
+#endif /* AUTHSYNC_H_ */
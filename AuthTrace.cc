@@ -0,0 +1,128 @@
+/**
+ * AuthTrace.cc
+ */
+
+#include "AuthTrace.h"
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace droneauth {
+
+static const char TRACE_MAGIC[8] = { 'D', 'A', 'T', 'R', 'A', 'C', 'E', '1' };
+static const uint32_t TRACE_VERSION = 1;
+
+static size_t paddedLength(size_t length) {
+    return (length + 7) & ~(size_t)7;
+}
+
+bool TraceWriter::open(const char *fileName) {
+    close();
+    file = std::fopen(fileName, "wb");
+    if (file == nullptr) {
+        return false;
+    }
+    // Records are small; a large stdio buffer turns them into few write() calls
+    std::setvbuf(file, nullptr, _IOFBF, 1 << 20);
+    TraceHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+    header.version = TRACE_VERSION;
+    header.headerSize = sizeof(TraceHeader);
+    header.wallClockNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    std::fwrite(&header, sizeof(header), 1, file);
+    records = 0;
+    return true;
+}
+
+void TraceWriter::close() {
+    if (file != nullptr) {
+        std::fclose(file);
+        file = nullptr;
+    }
+}
+
+void TraceWriter::append(uint64_t timeNs, uint32_t peer, TraceDirection direction, ByteSpan datagram) {
+    static const uint8_t padding[8] = {};
+    if (file == nullptr || datagram.size > UINT16_MAX) {
+        return;
+    }
+    TraceRecord record;
+    record.timeNs = timeNs;
+    record.peer = peer;
+    record.length = (uint16_t)datagram.size;
+    record.direction = direction;
+    record.reserved = 0;
+    std::fwrite(&record, sizeof(record), 1, file);
+    std::fwrite(datagram.data, 1, datagram.size, file);
+    std::fwrite(padding, 1, paddedLength(datagram.size) - datagram.size, file);
+    records++;
+}
+
+bool TraceReader::open(const char *fileName, std::string& error) {
+    close();
+    int fd = ::open(fileName, O_RDONLY);
+    if (fd < 0) {
+        error = std::string("cannot open ") + fileName + ": " + std::strerror(errno);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(TraceHeader)) {
+        error = std::string(fileName) + " is not a trace (too short)";
+        ::close(fd);
+        return false;
+    }
+    void *mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        error = std::string("cannot map ") + fileName + ": " + std::strerror(errno);
+        return false;
+    }
+    base = (const uint8_t *)mapping;
+    size = st.st_size;
+    const TraceHeader& header = getHeader();
+    if (std::memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) != 0
+            || header.version != TRACE_VERSION || header.headerSize < sizeof(TraceHeader)
+            || header.headerSize > size) {
+        error = std::string(fileName) + " is not a version 1 trace";
+        close();
+        return false;
+    }
+    madvise(mapping, size, MADV_SEQUENTIAL);
+    rewind();
+    return true;
+}
+
+void TraceReader::close() {
+    if (base != nullptr) {
+        munmap((void *)base, size);
+        base = nullptr;
+        size = 0;
+    }
+}
+
+void TraceReader::rewind() {
+    offset = base != nullptr ? getHeader().headerSize : 0;
+}
+
+bool TraceReader::next(const TraceRecord *& record, ByteSpan& datagram) {
+    if (base == nullptr || size - offset < sizeof(TraceRecord)) {
+        return false;
+    }
+    const TraceRecord *candidate = (const TraceRecord *)(base + offset);
+    size_t end = offset + sizeof(TraceRecord) + paddedLength(candidate->length);
+    if (end > size) {
+        return false;  // torn final record
+    }
+    record = candidate;
+    datagram = ByteSpan(base + offset + sizeof(TraceRecord), candidate->length);
+    offset = end;
+    return true;
+}
+
+} // namespace droneauth
@@ -0,0 +1,87 @@
+/**
+ * AuthTrace.h
+ * Append-only capture of ground-station datagrams, readable in place via mmap.
+ *
+ *   file    [TraceHeader] [record] [record] ...
+ *   record  [TraceRecord] [datagram] [zero padding to 8 bytes]
+ *
+ * Records are only ever appended, so a trace cut short by a crash is valid
+ * up to its last complete record. A reply is written directly after the
+ * datagram that caused it, which lets replay pair AUTH_REQUEST with the
+ * CHALLENGE the ground station issued.
+ */
+
+#ifndef AUTHTRACE_H_
+#define AUTHTRACE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include "AuthEngine.h"
+
+namespace droneauth {
+
+struct TraceHeader {
+    char magic[8];        // "DATRACE1"
+    uint32_t version;
+    uint32_t headerSize;  // offset of the first record
+    uint64_t wallClockNs; // system_clock at open, to relate proof timestamps
+    uint64_t reserved;
+};
+
+enum TraceDirection : uint8_t {
+    TRACE_IN = 0,   // drone -> ground station
+    TRACE_OUT = 1,  // ground station -> drone
+};
+
+struct TraceRecord {
+    uint64_t timeNs;    // capture time (simulation or wall clock, ns)
+    uint32_t peer;      // sender/receiver, numbered in order of first appearance
+    uint16_t length;    // datagram bytes following the record
+    uint8_t direction;  // TraceDirection
+    uint8_t reserved;
+};
+
+class TraceWriter {
+public:
+    TraceWriter() : file(nullptr), records(0) {}
+    ~TraceWriter() { close(); }
+
+    // Truncates fileName; false if it cannot be created
+    bool open(const char *fileName);
+    void close();
+    bool isOpen() const { return file != nullptr; }
+
+    void append(uint64_t timeNs, uint32_t peer, TraceDirection direction, ByteSpan datagram);
+    uint64_t getNumRecords() const { return records; }
+
+private:
+    FILE *file;
+    uint64_t records;
+};
+
+class TraceReader {
+public:
+    TraceReader() : base(nullptr), size(0), offset(0) {}
+    ~TraceReader() { close(); }
+
+    // Maps fileName read-only; false with a message in error on failure
+    bool open(const char *fileName, std::string& error);
+    void close();
+
+    const TraceHeader& getHeader() const { return *(const TraceHeader *)base; }
+
+    // Next complete record and its datagram (pointing into the mapping)
+    bool next(const TraceRecord *& record, ByteSpan& datagram);
+    void rewind();
+
+private:
+    const uint8_t *base;
+    size_t size;
+    size_t offset;
+};
+
+} // namespace droneauth
+
+#endif /* AUTHTRACE_H_ */
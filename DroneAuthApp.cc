@@ -5,11 +5,22 @@
  */
 
 #include "DroneAuthApp.h"
-#include "ZKPModule.h"
+#include "StatsRecording.h"
+#include "DroneAuthLog.h"
+#include "FleetTable.h"
+#include "KeyCache.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <tuple>
 #include <omnetpp.h>
 #include "inet/common/ModuleAccess.h"
+#include "inet/common/Simsignals.h"
 #include "inet/common/packet/Packet.h"
+#include "inet/mobility/contract/IMobility.h"
 #include "inet/networklayer/common/L3AddressResolver.h"
+#include "inet/networklayer/common/L3AddressTag_m.h"
 #include "inet/transportlayer/contract/udp/UdpSocket.h"
 
 using namespace inet;
@@ -18,22 +29,27 @@ using namespace droneauth;
 
 Define_Module(DroneAuthApp);
 
-// Custom message kinds
-#define MSG_SEND_AUTH_REQUEST    1
-#define MSG_SEND_PROOF          2
-#define MSG_AUTH_TIMEOUT        3
+static const char *timerNames[DRONE_TIMER_COUNT] = { "sendAuthRequest", "sendProof", "authTimeout", "prepareCredentials" };
 
 DroneAuthApp::DroneAuthApp() {
-    selfMsg = nullptr;
-    timeoutMsg = nullptr;
-    zkpModule = nullptr;
+    session = nullptr;
+    radio = nullptr;
+    wakeTimer = nullptr;
+    sleepTimer = nullptr;
+    currentCandidate = 0;
+    candidatesStale = true;
+    topologySubscribed = false;
 }
 
 DroneAuthApp::~DroneAuthApp() {
-    cancelAndDelete(selfMsg);
-    cancelAndDelete(timeoutMsg);
-    if (zkpModule) {
-        delete zkpModule;
+    subscribeTopology(false);
+    cancelAndDelete(wakeTimer);
+    cancelAndDelete(sleepTimer);
+    for (AuthSession& s : sessions) {
+        for (int i = 0; i < DRONE_TIMER_COUNT; i++) {
+            cancelAndDelete(s.timers[i]);
+        }
+        delete s.engine;
     }
 }
 
@@ -44,36 +60,184 @@ void DroneAuthApp::initialize(int stage) {
         // Read parameters
         localPort = par("localPort");
         destPort = par("destPort");
+        failoverTimeouts = par("failoverTimeouts");
+        resolveEveryPacket = par("resolveEveryPacket");
+        raceWidth = par("raceWidth");
+        if (raceWidth < 1) {
+            throw cRuntimeError("raceWidth must be at least 1, got %d", raceWidth);
+        }
+        // No more sessions than listed ground stations
+        int numNames = cStringTokenizer(par("destAddress").stringValue()).asVector().size();
+        raceWidth = std::max(1, std::min(raceWidth, numNames));
+        numFailovers = 0;
+        numRotations = 0;
         droneId = par("droneId").stdstringValue();
         password = par("password").stdstringValue();
+        const char *fleetTable = par("fleetTable").stringValue();
+        if (*fleetTable != '\0') {
+            loadFleetCredentials(fleetTable, par("fleetIndex").intValue());
+        }
+        printVerdicts = par("printVerdicts");
+        cpuTimeScale = par("cpuTimeScale");
+        proofDelay = par("proofDelay").doubleValue();
+        pendingProofCpuTime = 0;
+
+        const char *model = par("computeModel").stringValue();
+        if (strcmp(model, "fixed") == 0) {
+            computeModel = COMPUTE_FIXED;
+        } else if (strcmp(model, "profile") == 0) {
+            computeModel = COMPUTE_PROFILE;
+        } else if (strcmp(model, "measured") == 0) {
+            computeModel = COMPUTE_MEASURED;
+        } else {
+            throw cRuntimeError("Unknown computeModel '%s'", model);
+        }
+        cpuProfile = CpuProfiles::find(par("cpuProfile").stdstringValue());
+        if (cpuProfile == nullptr) {
+            throw cRuntimeError("Unknown cpuProfile '%s'", par("cpuProfile").stringValue());
+        }
+        cpuActivePower = par("cpuActivePower");
+        if (cpuActivePower < 0) {
+            cpuActivePower = cpuProfile->activePowerW;
+        }
+        logRing.init(par("logRingSize").intValue());
+        assertAllocFree = par("assertAllocFree");
+        displayedVerdict = DISPLAY_NONE;
 
         // Statistics
         numAuthRequests = 0;
         numAuthSuccess = 0;
         numAuthFailures = 0;
+        handshakeStartRadioEnergy = 0;
+        handshakeEndRadioEnergy = -1;
+        handshakeCpuEnergy = 0;
+        handshakeSucceeded = false;
+        successfulHandshakeEnergy = 0;
+        retryHandshakeEnergy = 0;
+        totalCpuEnergy = 0;
+        numRetryHandshakes = 0;
 
         // Register signals
         authRequestSignal = registerSignal("authRequest");
         authSuccessSignal = registerSignal("authSuccess");
         authFailureSignal = registerSignal("authFailure");
+        handshakeAirtimeSignal = registerSignal("handshakeAirtime");
+        handshakeBytesOnAirSignal = registerSignal("handshakeBytesOnAir");
+        handshakeEnergySignal = registerSignal("handshakeEnergy");
+        proofComputeTimeSignal = registerSignal("proofComputeTime");
+        failoverSignal = registerSignal("groundStationFailover");
+        authLatencySignal = registerSignal("authLatency");
+        wakeDelaySignal = registerSignal("wakeDelay");
+
+        powerSave = par("powerSave");
+        sleepGuard = par("sleepGuard").doubleValue();
+        minWakeWindow = par("minWakeWindow").doubleValue();
+        maxWakePeriod = par("rotationInterval").doubleValue();
+        if (maxWakePeriod == SIMTIME_ZERO) {
+            maxWakePeriod = par("retryInterval").doubleValue();
+        }
+        hasWakeSchedule = false;
+        radioAsleep = false;
+        windowOpen = false;
+        totalSleepTime = SIMTIME_ZERO;
+        requestDueAt = -1;
+        numWakeWindows = 0;
+        if (powerSave) {
+            radio = getModuleFromPar<physicallayer::IRadio>(par("radioModule"), this);
+            wakeTimer = new cMessage("wakeWindow");
+            sleepTimer = new cMessage("radioSleep");
+        }
 
-        // Initialize ZKP module
-        zkpModule = new ZKPModule(droneId);
-        zkpModule->setup();
-        zkpModule->initializeProver(droneId, password);
-        zkpModule->createCommitment();
+        // Account radio frames and radio energy of this host caused by authentication
+        airtimeMeter.subscribeTo(getContainingNode(this), "DroneAuthData");
+        energyMeter.subscribeTo(getContainingNode(this));
+
+        // Initialize one protocol engine (prover and commitment) per raced ground station
+        DroneConfig config;
+        config.droneId = droneId;
+        config.password = password;
+        config.authTimeout = par("authTimeout").doubleValue();
+        config.retryInterval = par("retryInterval").doubleValue();
+        config.rotationInterval = par("rotationInterval").doubleValue();
+        config.provisionedNonce = provisionedNonce;
+        bootKeyTime = -1;
+        bootKeyFromCache = false;
+        const char *kdf = par("passwordKdf").stringValue();
+        if (strcmp(kdf, "scrypt") == 0) {
+            if (!provisionedNonce.empty()) {
+                throw cRuntimeError("A fleetTable holds credentials from the password itself; use passwordKdf \"sha256\"");
+            }
+            loadPasswordKey(config.passwordKey);
+        } else if (strcmp(kdf, "sha256") != 0) {
+            throw cRuntimeError("Unknown passwordKdf '%s'", kdf);
+        }
+        config.proofDelay = proofDelay.dbl();
+        sessions.resize(raceWidth);
+        for (int k = 0; k < raceWidth; k++) {
+            sessions[k].engine = new DroneEngine(config, &perf);
+            for (int i = 0; i < DRONE_TIMER_COUNT; i++) {
+                sessions[k].timers[i] = new cMessage(timerNames[i], k * DRONE_TIMER_COUNT + i);
+            }
+        }
+        session = &sessions[0];
+        raceActive = false;
+        authPending = false;
 
-        EV << "Drone " << droneId << " initialized with ZKP" << endl;
-        EV << "Commitment: " << ZKPModule::bytesToHex(zkpModule->getCommitment()).substr(0, 16) << "..." << endl;
+        DA_INFO << "Drone " << droneId << " initialized with ZKP" << endl;
+        DA_INFO << "Commitment: " << HexPrefix(session->engine->getProver().getCommitment()) << "..." << endl;
+    }
+}
 
-        // Schedule first authentication
-        selfMsg = new cMessage("sendAuthRequest");
-        selfMsg->setKind(MSG_SEND_AUTH_REQUEST);
+void DroneAuthApp::loadFleetCredentials(const char *fileName, int index) {
+    FleetDroneTable table;
+    std::string error;
+    if (!table.open(fileName, error)) {
+        throw cRuntimeError("Cannot load fleet table: %s", error.c_str());
+    }
+    if (index < 0 || (uint64_t)index >= table.getNumDrones()) {
+        throw cRuntimeError("fleetIndex %d is outside %s (%llu drones)", index, fileName,
+                            (unsigned long long)table.getNumDrones());
     }
+    const DroneSecret& record = table.getRecord(index);
+    droneId.assign(record.droneId, fleetIdLength(record.droneId));
+    password.assign(record.password, sizeof(record.password));
+    provisionedNonce.assign(record.nonce, record.nonce + sizeof(record.nonce));
+}
+
+void DroneAuthApp::loadPasswordKey(std::vector<uint8_t>& key) {
+    KdfParams params;
+    params.logN = par("scryptLogN").intValue();
+    params.r = par("scryptR").intValue();
+    params.p = par("scryptP").intValue();
+    const char *cacheFile = par("keyCacheFile").stringValue();
+    std::vector<uint8_t> sealingKey;
+    deviceSealingKey(getContainingNode(this)->getFullPath(), sealingKey);
+
+    // Wall-clock boot cost; the KDF itself is not modelled in simulation time
+    auto start = std::chrono::steady_clock::now();
+    if (*cacheFile) {
+        ScopedTimer timer(&perf, PERF_KEY_UNSEAL);
+        bootKeyFromCache = loadSealedKey(cacheFile, sealingKey, droneId, password, params, key);
+    }
+    if (!bootKeyFromCache) {
+        {
+            ScopedTimer timer(&perf, PERF_KEY_DERIVE);
+            if (!deriveDroneKey(droneId, password, params, key)) {
+                throw cRuntimeError("scrypt rejected logN=%u r=%u p=%u", params.logN, params.r, params.p);
+            }
+        }
+        if (*cacheFile && !storeSealedKey(cacheFile, sealingKey, droneId, password, params, key)) {
+            DA_WARN << "Cannot write key cache " << cacheFile << endl;
+        }
+    }
+    bootKeyTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    DA_INFO << "Password key " << (bootKeyFromCache ? "unsealed from cache" : "derived with scrypt")
+            << " in " << bootKeyTime * 1e3 << " ms" << endl;
 }
 
 void DroneAuthApp::finish() {
     ApplicationBase::finish();
+    closeHandshakeAccounting();
 
     recordScalar("authRequests", numAuthRequests);
     recordScalar("authSuccess", numAuthSuccess);
@@ -83,6 +247,39 @@ void DroneAuthApp::finish() {
         double successRate = (double)numAuthSuccess / numAuthRequests * 100.0;
         recordScalar("successRate", successRate);
     }
+
+    recordAirtimeUsage(this, airtimeMeter.getTotal(), numAuthSuccess);
+    recordScalar("groundStationFailovers", numFailovers);
+    recordScalar("credentialRotations", numRotations);
+    if (bootKeyTime >= 0) {
+        recordScalar("bootKeyTime", bootKeyTime, "s");
+        recordScalar("bootKeyFromCache", bootKeyFromCache);
+    }
+
+    // Energy in mJ, radio (INET consumers) plus modelled CPU time
+    recordScalar("authCpuEnergy", totalCpuEnergy * 1e3, "mJ");
+    recordScalar("authEnergy", (successfulHandshakeEnergy + retryHandshakeEnergy) * 1e3, "mJ");
+    if (numAuthSuccess > 0) {
+        recordScalar("energyPerSuccessfulHandshake", successfulHandshakeEnergy / numAuthSuccess * 1e3, "mJ");
+    }
+    if (numRetryHandshakes > 0) {
+        recordScalar("energyPerRetry", retryHandshakeEnergy / numRetryHandshakes * 1e3, "mJ");
+    }
+    recordScalar("radioEnergy", energyMeter.getEnergy() * 1e3, "mJ");
+    if (powerSave) {
+        simtime_t sleepTime = totalSleepTime + (radioAsleep ? simTime() - sleepStart : SIMTIME_ZERO);
+        recordScalar("wakeWindows", numWakeWindows);
+        recordScalar("radioSleepTime", sleepTime, "s");
+        if (simTime() > SIMTIME_ZERO) {
+            recordScalar("radioAwakeFraction", 1 - sleepTime.dbl() / simTime().dbl());
+        }
+    }
+    recordAllocStats(this, allocStats);
+    if (assertAllocFree) {
+        checkAllocFree(this, allocStats);
+    }
+    recordPerfRegistry(this, perf, par("perfSummaryFile").stringValue());
+    logRing.dump(par("logRingFile").stringValue(), getFullPath());
 }
 
 void DroneAuthApp::handleMessageWhenUp(cMessage *msg) {
@@ -91,27 +288,52 @@ void DroneAuthApp::handleMessageWhenUp(cMessage *msg) {
     } else if (dynamic_cast<Packet *>(msg)) {
         handleIncomingMessage(msg);
     } else {
-        EV_WARN << "Received indication message: " << msg->getName() << endl;
+        DA_WARN << "Received indication message: " << msg->getName() << endl;
         delete msg;
     }
 }
 
 void DroneAuthApp::handleSelfMessage(cMessage *msg) {
-    switch (msg->getKind()) {
-        case MSG_SEND_AUTH_REQUEST:
-            sendAuthenticationRequest();
-            break;
-
-        case MSG_SEND_PROOF:
-            sendZKProof();
-            break;
-
-        case MSG_AUTH_TIMEOUT:
-            handleAuthTimeout();
-            break;
+    if (msg == wakeTimer) {
+        openWakeWindow();
+        return;
+    }
+    if (msg == sleepTimer) {
+        closeWakeWindow();
+        return;
+    }
+    int kind = msg->getKind();
+    if (kind < 0 || kind >= (int)sessions.size() * DRONE_TIMER_COUNT) {
+        throw cRuntimeError("Unknown self message kind: %d", kind);
+    }
+    AuthSession& s = sessions[kind / DRONE_TIMER_COUNT];
+    DroneTimer timer = (DroneTimer)(kind % DRONE_TIMER_COUNT);
+    if (timer == DRONE_TIMER_REQUEST && hasWakeSchedule) {
+        if (radioAsleep) {
+            // Sent when the next window opens; the radio stays off until then
+            s.deferred = true;
+            if (requestDueAt < SIMTIME_ZERO) {
+                requestDueAt = simTime();
+            }
+            return;
+        }
+        if (!raceActive) {
+            emit(wakeDelaySignal, SIMTIME_ZERO);  // once per handshake, not per raced session
+        }
+    }
+    runEngineTimer(s, timer);
+}
 
-        default:
-            throw cRuntimeError("Unknown self message kind: %d", msg->getKind());
+void DroneAuthApp::runEngineTimer(AuthSession& s, DroneTimer timer) {
+    static const AllocPhase allocPhases[DRONE_TIMER_COUNT] = {
+        ALLOC_DRONE_SEND_REQUEST, ALLOC_DRONE_SEND_PROOF, ALLOC_DRONE_TIMEOUT, ALLOC_DRONE_PREPARE
+    };
+    AllocScope allocScope(allocStats, allocPhases[timer]);
+    session = &s;
+    session->engine->onTimer(timer, engineOutput);
+    handleEngineOutput(engineOutput);
+    if (isPastWarmup() && !engineOutput.rotated && timer != DRONE_TIMER_PREPARE) {
+        allocScope.markSteadyState();
     }
 }
 
@@ -119,224 +341,462 @@ void DroneAuthApp::handleIncomingMessage(cMessage *msg) {
     Packet *packet = check_and_cast<Packet *>(msg);
 
     auto chunk = packet->peekDataAsBytes();
-    std::vector<uint8_t> data(chunk->getBytes().begin(), chunk->getBytes().end());
+    const auto& bytes = chunk->getBytes();
 
     // Parse message type (first byte)
-    if (data.size() < 1) {
+    if (bytes.size() < 1) {
+        delete packet;
+        return;
+    }
+
+    AuthSession *target = findSession(packet->getTag<L3AddressInd>()->getSrcAddress());
+    if (target == nullptr) {
+        delete packet;  // a ground station that lost the race answers late
+        return;
+    }
+    if (bytes[0] == MSG_WAKE_SCHEDULE) {
+        // For the host, not the engine; only from a ground station about to send its verdict
+        if (target->inFlight && !target->done) {
+            handleWakeSchedule(bytes);
+        }
         delete packet;
         return;
     }
 
-    uint8_t msgType = data[0];
+    AllocScope allocScope(allocStats, bytes[0] == MSG_CHALLENGE ? ALLOC_DRONE_RECV_CHALLENGE : ALLOC_DRONE_RECV_VERDICT);
+    session = target;
+    if (!candidates.empty()) {
+        int index = session->candidate >= 0 ? session->candidate : currentCandidate;
+        candidates[index].consecutiveTimeouts = 0;  // the ground station answers
+    }
+    session->engine->onDatagram(ByteSpan(bytes), engineOutput);
+    handleEngineOutput(engineOutput);
+    if (isPastWarmup() && !engineOutput.rotated) {
+        allocScope.markSteadyState();
+    }
 
-    switch (msgType) {
-        case 0x02: // CHALLENGE message
-            handleChallengeMessage(data);
-            break;
+    delete packet;
+}
 
-        case 0x04: // AUTH_SUCCESS message
-            handleAuthSuccessMessage(data);
+void DroneAuthApp::handleEngineOutput(DroneOutput& out) {
+    switch (out.event) {
+        case DRONE_EVENT_REQUEST_SENT:
+            handleRequestSent();
             break;
 
-        case 0x05: // AUTH_FAILURE message
-            handleAuthFailureMessage(data);
+        case DRONE_EVENT_CHALLENGE:
+            handleChallenge(out);
             break;
 
-        default:
-            EV_WARN << "Unknown message type: " << (int)msgType << endl;
-    }
-
-    delete packet;
-}
+        case DRONE_EVENT_PROOF_SENT:
+            handleProofSent(out);
+            break;
 
-void DroneAuthApp::sendAuthenticationRequest() {
-    EV << "=======================================" << endl;
-    EV << "DRONE " << droneId << " sending auth request" << endl;
-    EV << "=======================================" << endl;
-    numAuthRequests++;
-    emit(authRequestSignal, numAuthRequests);
+        case DRONE_EVENT_SUCCESS:
+            if (out.rotated) {
+                numRotations++;
+                DA_INFO << "Drone " << droneId << " switched to rotated credentials" << endl;
+            }
+            handleAuthSuccess();
+            break;
 
-    EV << "Sending authentication request to ground station" << endl;
+        case DRONE_EVENT_FAILURE:
+            if (out.rolledBack) {
+                DA_WARN << "Drone " << droneId << " rotated credentials refused, back on the previous ones" << endl;
+            }
+            handleAuthFailure();
+            break;
 
-    // Create message: [type(1)] [droneId_len(4)] [droneId] [commitment_len(4)] [commitment]
-    std::vector<uint8_t> msgData;
+        case DRONE_EVENT_TIMEOUT:
+            handleAuthTimeout();
+            break;
 
-    // Message type: AUTH_REQUEST
-    msgData.push_back(0x01);
+        case DRONE_EVENT_MALFORMED:
+            DA_ERROR << "Invalid challenge message" << endl;
+            break;
 
-    // Drone ID
-    uint32_t idLen = droneId.length();
-    msgData.insert(msgData.end(), (uint8_t*)&idLen, (uint8_t*)&idLen + 4);
-    msgData.insert(msgData.end(), droneId.begin(), droneId.end());
+        case DRONE_EVENT_UNKNOWN_TYPE:
+            DA_WARN << "Unknown message type received" << endl;
+            break;
 
-    // Commitment
-    auto commitment = zkpModule->getCommitment();
-    uint32_t commitLen = commitment.size();
-    msgData.insert(msgData.end(), (uint8_t*)&commitLen, (uint8_t*)&commitLen + 4);
-    msgData.insert(msgData.end(), commitment.begin(), commitment.end());
+        case DRONE_EVENT_UNEXPECTED:
+            DA_WARN << "Drone " << droneId << " ignores a reply outside its handshake" << endl;
+            break;
 
-    // Send packet
-    sendPacket(msgData);
+        default:
+            break;
+    }
+    applyEngineOutput(out);
+    // Radio off a little after the handshake, once MAC acknowledgements are out
+    if (hasWakeSchedule && !radioAsleep && !windowOpen && !hasSessionInFlight() && !sleepTimer->isScheduled()) {
+        scheduleAfter(sleepGuard, sleepTimer);
+    }
+}
 
-    // Cancel any existing timeout before creating new one
-    if (timeoutMsg != nullptr) {
-        if (timeoutMsg->isScheduled()) {
-            cancelEvent(timeoutMsg);
+void DroneAuthApp::applyEngineOutput(const DroneOutput& out) {
+    if (!out.datagram.empty()) {
+        sendPacket(out.datagram);
+    }
+    for (int i = 0; i < DRONE_TIMER_COUNT; i++) {
+        const TimerRequest& request = out.timers[i];
+        if (request.op == TimerRequest::KEEP) {
+            continue;
+        }
+        cMessage *timer = session->timers[i];
+        if (timer->isScheduled()) {
+            cancelEvent(timer);
+        }
+        if (request.op == TimerRequest::ARM) {
+            scheduleAt(simTime() + request.delay, timer);
         }
-        delete timeoutMsg;
-        timeoutMsg = nullptr;
     }
-
-    // Set new timeout
-    timeoutMsg = new cMessage("authTimeout");
-    timeoutMsg->setKind(MSG_AUTH_TIMEOUT);
-    scheduleAt(simTime() + par("authTimeout").doubleValue(), timeoutMsg);
 }
 
-void DroneAuthApp::handleChallengeMessage(const std::vector<uint8_t>& data) {
-    EV << "Received challenge from ground station" << endl;
+void DroneAuthApp::cancelEngineTimers(AuthSession& s) {
+    for (int i = 0; i < DRONE_TIMER_COUNT; i++) {
+        if (s.timers[i] != nullptr && s.timers[i]->isScheduled()) {
+            cancelEvent(s.timers[i]);
+        }
+    }
+}
 
-    // Parse: [type(1)] [challenge_len(4)] [challenge]
-    if (data.size() < 5) {
-        EV_ERROR << "Invalid challenge message" << endl;
-        return;
+void DroneAuthApp::startSessions() {
+    double startDelay = par("startTime").doubleValue();
+    raceActive = false;
+    authPending = false;
+    for (AuthSession& s : sessions) {
+        s.inFlight = false;
+        s.done = false;
+        session = &s;
+        s.engine->start(startDelay, engineOutput);
+        applyEngineOutput(engineOutput);
     }
+    session = &sessions[0];
+}
 
-    size_t offset = 1;
-    uint32_t chalLen;
-    std::memcpy(&chalLen, &data[offset], 4);
-    offset += 4;
+DroneAuthApp::AuthSession *DroneAuthApp::findSession(const L3Address& source) {
+    // Without a race every reply belongs to the single session
+    if (sessions.size() == 1) {
+        return &sessions[0];
+    }
+    for (AuthSession& s : sessions) {
+        if (!s.done && s.candidate >= 0 && candidates[s.candidate].address == source) {
+            return &s;
+        }
+    }
+    return nullptr;
+}
 
-    if (data.size() < offset + chalLen) {
-        EV_ERROR << "Challenge message too short" << endl;
-        return;
+bool DroneAuthApp::hasSessionInFlight() const {
+    for (const AuthSession& s : sessions) {
+        if (s.inFlight) {
+            return true;
+        }
     }
+    return false;
+}
 
-    std::string challenge(data.begin() + offset, data.begin() + offset + chalLen);
-    currentChallenge = challenge;
+void DroneAuthApp::handleRequestSent() {
+    session->inFlight = true;
+    if (raceActive) {
+        return;  // joins the handshake another session started
+    }
+    // A new handshake: close the previous one and bind the sessions to the
+    // nearest ground stations before any of them sends
+    closeHandshakeAccounting();
+    raceActive = true;
+    if (!authPending) {
+        authPending = true;
+        authStart = simTime();
+    }
+    if (sessions.size() > 1) {
+        rankCandidates();
+        // Sessions that lost the last race, or wait for a retry, join this one at once
+        for (AuthSession& other : sessions) {
+            if (&other != session && !other.inFlight) {
+                other.done = false;
+                other.deferred = false;
+                cMessage *request = other.timers[DRONE_TIMER_REQUEST];
+                if (request->isScheduled()) {
+                    cancelEvent(request);
+                }
+                scheduleAt(simTime(), request);
+            }
+        }
+    }
 
-    EV << "Challenge received: " << challenge << endl;
+    DA_INFO << "=======================================" << endl;
+    DA_INFO << "DRONE " << droneId << " sending auth request" << endl;
+    DA_INFO << "=======================================" << endl;
+    numAuthRequests++;
+    emit(authRequestSignal, numAuthRequests);
+    logRing.push(LOGEV_AUTH_REQUEST_SENT, numAuthRequests);
 
-    // Schedule proof generation
-    cMessage *proofMsg = new cMessage("sendProof");
-    proofMsg->setKind(MSG_SEND_PROOF);
-    scheduleAt(simTime() + 0.001, proofMsg); // 1ms delay
+    DA_INFO << "Sending authentication request to ground station" << endl;
 }
 
-void DroneAuthApp::sendZKProof() {
-    EV << "Generating and sending ZK proof" << endl;
+void DroneAuthApp::handleChallenge(DroneOutput& out) {
+    const std::string& challenge = session->engine->getCurrentChallenge();
+    logRing.push(LOGEV_CHALLENGE_RECEIVED, challenge.length());
 
-    // Generate proof
-    ZKProof proof = zkpModule->generateProof(currentChallenge);
-    auto stats = zkpModule->getLastProofStats();
+    DA_INFO << "Challenge received: " << challenge << endl;
 
-    EV << "Proof generated in " << stats.generationTime << " ms" << endl;
+    // Send the proof after the modelled compute time of this drone
+    if (computeModel != COMPUTE_FIXED) {
+        out.timers[DRONE_TIMER_PROOF].delay = computeProofTime(challenge);
+    }
+}
 
-    // Serialize proof
-    auto serializedProof = proof.serialize();
+double DroneAuthApp::computeProofTime(const std::string& challenge) {
+    size_t inputSize = session->engine->getProver().getProofInputSize(challenge, session->engine->getNextCommitment().size());
+    double profileTime = CpuProfiles::proofGenerationTime(*cpuProfile, inputSize);
+    pendingProofCpuTime = profileTime;
+    if (computeModel == COMPUTE_MEASURED) {
+        // Host cost of earlier proofs scaled to the drone CPU; the table until one was measured
+        const LatencyHistogram& measured = perf.phase(PERF_ZKP_GENERATE_PROOF);
+        if (measured.getCount() > 0) {
+            pendingProofCpuTime = measured.getMeanNs() * 1e-9 * cpuTimeScale;
+        }
+    }
+    emit(proofComputeTimeSignal, pendingProofCpuTime);
+    return pendingProofCpuTime;
+}
 
-    // Create message: [type(1)] [proof_data]
-    std::vector<uint8_t> msgData;
-    msgData.push_back(0x03); // PROOF message type
-    msgData.insert(msgData.end(), serializedProof.begin(), serializedProof.end());
+void DroneAuthApp::handleProofSent(const DroneOutput& out) {
+    double cpuTime = computeModel == COMPUTE_FIXED
+            ? perf.phase(PERF_ZKP_GENERATE_PROOF).getLastNs() * 1e-9 * cpuTimeScale
+            : pendingProofCpuTime;
+    double cpuEnergy = cpuActivePower * cpuTime;
+    handshakeCpuEnergy += cpuEnergy;
+    totalCpuEnergy += cpuEnergy;
 
-    // Send packet
-    sendPacket(msgData);
+    DA_INFO << "Proof generated in " << perf.phase(PERF_ZKP_GENERATE_PROOF).getLastNs() / 1e6 << " ms" << endl;
+    logRing.push(LOGEV_PROOF_SENT, out.datagram.size);
 }
 
-void DroneAuthApp::handleAuthSuccessMessage(const std::vector<uint8_t>& data) {
-    EV << "=======================================" << endl;
-    EV << "DRONE " << droneId << " RECEIVED SUCCESS!" << endl;
-    EV << "=======================================" << endl;
-    // Cancel pending authentication request timer
-    if (selfMsg != nullptr && selfMsg->isScheduled()) {
-        cancelEvent(selfMsg);
-    }
-    
-    // Cancel authentication timeout - CRITICAL FIX
-    if (timeoutMsg != nullptr) {
-        if (timeoutMsg->isScheduled()) {
-            cancelEvent(timeoutMsg);
+void DroneAuthApp::handleAuthSuccess() {
+    // The first verdict wins; the other handshakes are abandoned
+    session->inFlight = false;
+    for (AuthSession& other : sessions) {
+        if (&other != session) {
+            cancelEngineTimers(other);
+            other.inFlight = false;
+            other.done = true;
         }
-        delete timeoutMsg;
-        timeoutMsg = nullptr;
     }
-    
+    raceActive = false;
+    if (authPending) {
+        emit(authLatencySignal, simTime() - authStart);
+        authPending = false;
+    }
+
+    DA_INFO << "=======================================" << endl;
+    DA_INFO << "DRONE " << droneId << " RECEIVED SUCCESS!" << endl;
+    DA_INFO << "=======================================" << endl;
     numAuthSuccess++;
+    handshakeSucceeded = true;
+    endHandshakeEnergy();
     emit(authSuccessSignal, numAuthSuccess);
+    logRing.push(LOGEV_AUTH_SUCCESS, numAuthSuccess);
 
-    EV << "✓✓✓ AUTHENTICATION SUCCESSFUL! Drone " << droneId << " authenticated" << endl;
+    DA_INFO << "✓✓✓ AUTHENTICATION SUCCESSFUL! Drone " << droneId << " authenticated" << endl;
 
     // VISUAL FEEDBACK: Change drone to GREEN and make it BIGGER
-    getParentModule()->getDisplayString().setTagArg("i", 1, "green");
-    getParentModule()->getDisplayString().setTagArg("is", 0, "80");
-    getParentModule()->getDisplayString().setTagArg("i", 0, "misc/drone");
+    showVerdict(DISPLAY_SUCCESS);
     bubble("✓ AUTHENTICATED!");
-    printf("\n\n=== DRONE %s TURNED GREEN ===\n\n", droneId.c_str());
-
-    // Update app display
-    getDisplayString().setTagArg("i", 1, "green");
-    getDisplayString().setTagArg("t", 0, "Authenticated");
+    DA_CONSOLE(printVerdicts, "\n\n=== DRONE %s TURNED GREEN ===\n\n", droneId.c_str());
 }
 
-void DroneAuthApp::handleAuthFailureMessage(const std::vector<uint8_t>& data) {
-    EV << "=======================================" << endl;
-    EV << "DRONE " << droneId << " RECEIVED FAILURE!" << endl;
-    EV << "=======================================" << endl;
-    // Cancel authentication timeout since we got a response
-    if (timeoutMsg != nullptr) {
-        if (timeoutMsg->isScheduled()) {
-            cancelEvent(timeoutMsg);
-        }
-        delete timeoutMsg;
-        timeoutMsg = nullptr;
+void DroneAuthApp::handleAuthFailure() {
+    session->inFlight = false;
+    if (hasSessionInFlight()) {
+        DA_WARN << "Drone " << droneId << " rejected by one raced ground station, waiting for the others" << endl;
+        return;
     }
-    
+    raceActive = false;
+    authPending = false;
+    endHandshakeEnergy();
+
+    DA_INFO << "=======================================" << endl;
+    DA_INFO << "DRONE " << droneId << " RECEIVED FAILURE!" << endl;
+    DA_INFO << "=======================================" << endl;
     numAuthFailures++;
     emit(authFailureSignal, numAuthFailures);
+    logRing.push(LOGEV_AUTH_FAILURE, numAuthFailures);
 
-    EV_ERROR << "✗✗✗ AUTHENTICATION FAILED for drone " << droneId << endl;
+    DA_ERROR << "✗✗✗ AUTHENTICATION FAILED for drone " << droneId << endl;
 
     // VISUAL FEEDBACK: Change drone to RED and make it BIGGER
-    getParentModule()->getDisplayString().setTagArg("i", 1, "red");
-    getParentModule()->getDisplayString().setTagArg("is", 0, "80");
-    getParentModule()->getDisplayString().setTagArg("i", 0, "misc/drone");
+    showVerdict(DISPLAY_FAILURE);
     bubble("✗ AUTH FAILED!");
-    printf("\n\n=== DRONE %s TURNED RED ===\n\n", droneId.c_str());
-
-    // Update app display
-    getDisplayString().setTagArg("i", 1, "red");
-    getDisplayString().setTagArg("t", 0, "Auth Failed");
+    DA_CONSOLE(printVerdicts, "\n\n=== DRONE %s TURNED RED ===\n\n", droneId.c_str());
 }
 
 void DroneAuthApp::handleAuthTimeout() {
-    EV_WARN << "Authentication timeout for drone " << droneId << endl;
-
-    // Clean up the timeout message that just fired
-    if (timeoutMsg != nullptr) {
-        delete timeoutMsg;
-        timeoutMsg = nullptr;
+    session->inFlight = false;
+    // A raced ground station that stays silent is replaced at the next handshake
+    if (session->candidate >= 0 && ++candidates[session->candidate].consecutiveTimeouts >= failoverTimeouts) {
+        candidates[session->candidate].healthy = false;
     }
+    if (hasSessionInFlight()) {
+        DA_INFO << "Drone " << droneId << " timed out on one raced ground station, waiting for the others" << endl;
+        return;
+    }
+    raceActive = false;
+    endHandshakeEnergy();
+    DA_WARN << "Authentication timeout for drone " << droneId << endl;
 
     numAuthFailures++;
     emit(authFailureSignal, numAuthFailures);
+    logRing.push(LOGEV_AUTH_TIMEOUT, numAuthFailures);
+
+    // The retry armed by the engine goes to the next ground station after repeated silence
+    if (session->candidate < 0 && !candidates.empty()
+            && ++candidates[currentCandidate].consecutiveTimeouts >= failoverTimeouts) {
+        failOver();
+    }
 
     // VISUAL FEEDBACK: Timeout also shows as RED
-    getParentModule()->getDisplayString().setTagArg("i", 1, "red");
-    getParentModule()->getDisplayString().setTagArg("is", 0, "80");
-    getParentModule()->getDisplayString().setTagArg("i", 0, "misc/drone");
+    showVerdict(DISPLAY_FAILURE);
     bubble("⏱ TIMEOUT!");
-    // DISABLED: 
-    // Retry after delay (only if retry is desired)
-    scheduleAt(simTime() + par("retryInterval").doubleValue(), selfMsg);
 }
 
-void DroneAuthApp::sendPacket(const std::vector<uint8_t>& data) {
-    // Get destination address
-    L3Address destAddr = L3AddressResolver().resolve(par("destAddress").stringValue());
+void DroneAuthApp::showVerdict(DisplayedVerdict verdict) {
+    // Display strings reallocate on every edit; repeated verdicts leave them alone
+    if (verdict == displayedVerdict) {
+        return;
+    }
+    displayedVerdict = verdict;
+    const char *color = verdict == DISPLAY_SUCCESS ? "green" : "red";
+    cDisplayString& nodeDisplay = getParentModule()->getDisplayString();
+    nodeDisplay.setTagArg("i", 1, color);
+    nodeDisplay.setTagArg("is", 0, "80");
+    nodeDisplay.setTagArg("i", 0, "misc/drone");
+    getDisplayString().setTagArg("i", 1, color);
+    getDisplayString().setTagArg("t", 0, verdict == DISPLAY_SUCCESS ? "Authenticated" : "Auth Failed");
+}
+
+void DroneAuthApp::endHandshakeEnergy() {
+    // The idle radio between this verdict and the next request is not handshake cost
+    if (handshakeEndRadioEnergy < 0) {
+        handshakeEndRadioEnergy = energyMeter.getEnergy();
+    }
+}
+
+void DroneAuthApp::closeHandshakeAccounting() {
+    // Frames since the previous request (including late MAC ACKs) belong to that
+    // handshake; its radio energy stops at the verdict
+    double radioEnergy = energyMeter.getEnergy();
+    if (numAuthRequests > 0) {
+        AirtimeUsage usage = airtimeMeter.takeCurrent();
+        emit(handshakeAirtimeSignal, usage.airtime);
+        emit(handshakeBytesOnAirSignal, (long)usage.bytes);
+
+        double endRadioEnergy = handshakeEndRadioEnergy >= 0 ? handshakeEndRadioEnergy : radioEnergy;
+        double energy = endRadioEnergy - handshakeStartRadioEnergy + handshakeCpuEnergy;
+        emit(handshakeEnergySignal, energy);
+        if (handshakeSucceeded) {
+            successfulHandshakeEnergy += energy;
+        } else {
+            retryHandshakeEnergy += energy;
+            numRetryHandshakes++;
+        }
+    }
+    handshakeStartRadioEnergy = radioEnergy;
+    handshakeEndRadioEnergy = -1;
+    handshakeCpuEnergy = 0;
+    handshakeSucceeded = false;
+}
+
+void DroneAuthApp::handleWakeSchedule(const std::vector<uint8_t>& bytes) {
+    WakeSchedule schedule;
+    if (!powerSave) {
+        return;
+    }
+    if (!AuthCodec::decodeWakeSchedule(bytes.data(), bytes.size(), schedule)) {
+        DA_WARN << "Invalid wake schedule" << endl;
+        return;
+    }
+    // The drone must still wake for its own re-authentication, and a window must
+    // be long enough for a handshake
+    if (SimTime(schedule.periodMs, SIMTIME_MS) > maxWakePeriod || SimTime(schedule.windowMs, SIMTIME_MS) < minWakeWindow) {
+        DA_WARN << "Drone " << droneId << " ignores a wake schedule of " << schedule.windowMs << "ms every "
+                << schedule.periodMs << "ms" << endl;
+        return;
+    }
+    // Takes effect after the verdict that follows it
+    wakeAnchor = simTime() + SimTime(schedule.offsetMs, SIMTIME_MS);
+    wakePeriod = SimTime(schedule.periodMs, SIMTIME_MS);
+    wakeWindow = SimTime(schedule.windowMs, SIMTIME_MS);
+    hasWakeSchedule = true;
+    DA_INFO << "Drone " << droneId << " wakes every " << wakePeriod << " for " << wakeWindow
+            << ", next at " << wakeAnchor << endl;
+}
+
+void DroneAuthApp::openWakeWindow() {
+    setRadioAwake(true);
+    windowOpen = true;
+    numWakeWindows++;
+    scheduleAfter(wakeWindow, sleepTimer);
+    if (requestDueAt >= SIMTIME_ZERO) {
+        emit(wakeDelaySignal, simTime() - requestDueAt);
+        requestDueAt = -1;
+    }
+    for (AuthSession& s : sessions) {
+        if (s.deferred) {
+            s.deferred = false;
+            runEngineTimer(s, DRONE_TIMER_REQUEST);
+        }
+    }
+}
+
+void DroneAuthApp::closeWakeWindow() {
+    windowOpen = false;
+    if (hasSessionInFlight()) {
+        return;  // the end of the handshake schedules the sleep again
+    }
+    setRadioAwake(false);
+    scheduleAt(getNextWindowStart(), wakeTimer);
+}
+
+void DroneAuthApp::setRadioAwake(bool awake) {
+    if (awake != radioAsleep) {
+        return;
+    }
+    if (awake) {
+        radio->setRadioMode(awakeRadioMode);
+        totalSleepTime += simTime() - sleepStart;
+    } else {
+        awakeRadioMode = radio->getRadioMode();
+        radio->setRadioMode(physicallayer::IRadio::RADIO_MODE_OFF);
+        sleepStart = simTime();
+    }
+    radioAsleep = !awake;
+}
+
+simtime_t DroneAuthApp::getNextWindowStart() const {
+    simtime_t now = simTime();
+    if (now < wakeAnchor) {
+        return wakeAnchor;
+    }
+    int64_t periods = (int64_t)std::floor((now - wakeAnchor).dbl() / wakePeriod.dbl()) + 1;
+    return wakeAnchor + wakePeriod * periods;
+}
 
-    // Create packet
-    const auto& payload = makeShared<BytesChunk>(data);
+void DroneAuthApp::sendPacket(ByteSpan data) {
+    ScopedTimer timer(&perf, PERF_DRONE_SEND_PACKET);
+    if (resolveEveryPacket) {
+        candidatesStale = true;
+    }
+    const L3Address& destAddr = getDestination();
+    if (destAddr.isUnspecified()) {
+        DA_WARN << "No ground station in '" << par("destAddress").stringValue() << "' resolves, not sending" << endl;
+        return;
+    }
+
+    // The packet changes owner on send, so it cannot come back to a pool
+    AllocScope allocScope(allocStats, ALLOC_PACKET_IO);
+    const auto& payload = makeShared<BytesChunk>(data.data, data.size);
     Packet *packet = new Packet("DroneAuthData");
     packet->insertAtBack(payload);
 
@@ -344,30 +804,187 @@ void DroneAuthApp::sendPacket(const std::vector<uint8_t>& data) {
     socket.sendTo(packet, destAddr, destPort);
 }
 
+void DroneAuthApp::resolveCandidates() {
+    // Names and health survive a re-resolve; only the addresses are refreshed
+    if (candidates.empty()) {
+        cStringTokenizer tokenizer(par("destAddress").stringValue());
+        while (tokenizer.hasMoreTokens()) {
+            GroundStationCandidate candidate;
+            candidate.name = tokenizer.nextToken();
+            candidates.push_back(candidate);
+        }
+    }
+    for (GroundStationCandidate& candidate : candidates) {
+        L3Address address;
+        if (!L3AddressResolver().tryResolve(candidate.name.c_str(), address)) {
+            address = L3Address();
+        }
+        candidate.address = address;
+    }
+    candidatesStale = false;
+}
+
+const L3Address& DroneAuthApp::getDestination() {
+    static const L3Address unspecified;
+    if (candidatesStale) {
+        resolveCandidates();
+    }
+    if (candidates.empty()) {
+        return unspecified;
+    }
+    if (session->candidate >= 0) {
+        return candidates[session->candidate].address;
+    }
+    if (candidates[currentCandidate].address.isUnspecified()) {
+        failOver();
+    }
+    return candidates[currentCandidate].address;
+}
+
+void DroneAuthApp::failOver() {
+    int numCandidates = candidates.size();
+    candidates[currentCandidate].healthy = false;
+    // Next healthy, resolved candidate; once all have failed, give every one another chance
+    for (int pass = 0; pass < 2; pass++) {
+        for (int step = 1; step <= numCandidates; step++) {
+            int next = (currentCandidate + step) % numCandidates;
+            GroundStationCandidate& candidate = candidates[next];
+            if (candidate.address.isUnspecified() || (!candidate.healthy && pass == 0)) {
+                continue;
+            }
+            if (next != currentCandidate) {
+                numFailovers++;
+                emit(failoverSignal, (long)next);
+                DA_WARN << "Drone " << droneId << " fails over to ground station " << candidate.name << endl;
+            }
+            currentCandidate = next;
+            candidate.healthy = true;
+            candidate.consecutiveTimeouts = 0;
+            return;
+        }
+        for (GroundStationCandidate& candidate : candidates) {
+            candidate.healthy = true;
+        }
+    }
+}
+
+void DroneAuthApp::rankCandidates() {
+    if (candidatesStale) {
+        resolveCandidates();
+    }
+    // Nearest first; ground stations without a position follow in destAddress
+    // order, failed ones after them and unresolved ones last
+    IMobility *ownMobility = dynamic_cast<IMobility *>(getContainingNode(this)->getSubmodule("mobility"));
+    std::vector<std::tuple<bool, bool, double, int>> ranking;
+    for (int i = 0; i < (int)candidates.size(); i++) {
+        const L3Address& address = candidates[i].address;
+        double distance = std::numeric_limits<double>::infinity();
+        cModule *host = address.isUnspecified() ? nullptr : L3AddressResolver().findHostWithAddress(address);
+        IMobility *mobility = host != nullptr ? dynamic_cast<IMobility *>(host->getSubmodule("mobility")) : nullptr;
+        if (ownMobility != nullptr && mobility != nullptr) {
+            distance = ownMobility->getCurrentPosition().distance(mobility->getCurrentPosition());
+        }
+        ranking.emplace_back(address.isUnspecified(), !candidates[i].healthy, distance, i);
+    }
+    std::sort(ranking.begin(), ranking.end());
+    // A session keeps a healthy ground station, which holds its commitment; the
+    // others fail over to the nearest one no session uses
+    std::vector<bool> taken(candidates.size(), false);
+    for (AuthSession& s : sessions) {
+        if (s.candidate >= 0 && candidates[s.candidate].healthy && !candidates[s.candidate].address.isUnspecified()) {
+            taken[s.candidate] = true;
+        }
+    }
+    size_t next = 0;
+    for (AuthSession& s : sessions) {
+        if (s.candidate >= 0 && taken[s.candidate]) {
+            continue;
+        }
+        while (taken[std::get<3>(ranking[next])]) {
+            next++;
+        }
+        int chosen = std::get<3>(ranking[next]);
+        if (s.candidate >= 0) {
+            numFailovers++;
+            emit(failoverSignal, (long)chosen);
+            DA_WARN << "Drone " << droneId << " fails over to ground station " << candidates[chosen].name << endl;
+        }
+        s.candidate = chosen;
+        taken[chosen] = true;
+        candidates[chosen].healthy = true;
+        candidates[chosen].consecutiveTimeouts = 0;
+    }
+}
+
+void DroneAuthApp::subscribeTopology(bool subscribe) {
+    if (subscribe == topologySubscribed) {
+        return;
+    }
+    cModule *network = getSimulation()->getSystemModule();
+    if (subscribe) {
+        network->subscribe(interfaceIpv4ConfigChangedSignal, this);
+        network->subscribe(interfaceStateChangedSignal, this);
+        network->subscribe(POST_MODEL_CHANGE, this);
+    } else {
+        network->unsubscribe(interfaceIpv4ConfigChangedSignal, this);
+        network->unsubscribe(interfaceStateChangedSignal, this);
+        network->unsubscribe(POST_MODEL_CHANGE, this);
+    }
+    topologySubscribed = subscribe;
+}
+
+void DroneAuthApp::receiveSignal(cComponent *source, simsignal_t signalID, cObject *obj, cObject *details) {
+    // Resolved lazily at the next send; the model may be mid-change here
+    if (signalID == POST_MODEL_CHANGE) {
+        if (dynamic_cast<cPostModuleAddNotification *>(obj) || dynamic_cast<cPostModuleDeleteNotification *>(obj)) {
+            candidatesStale = true;
+        }
+    } else {
+        candidatesStale = true;
+    }
+}
+
 void DroneAuthApp::handleStartOperation(LifecycleOperation *operation) {
     socket.setOutputGate(gate("socketOut"));
     socket.bind(localPort);
+    candidatesStale = true;
+    subscribeTopology(true);
+    // The schedule was for the previous run; the radio was reset with the node
+    hasWakeSchedule = false;
+    windowOpen = false;
+    if (radioAsleep) {
+        totalSleepTime += simTime() - sleepStart;
+        radioAsleep = false;
+    }
+    for (AuthSession& s : sessions) {
+        s.deferred = false;
+    }
+    requestDueAt = -1;
 
     // Start authentication after a small delay
-    scheduleAt(simTime() + par("startTime").doubleValue(), selfMsg);
+    startSessions();
 }
 
 void DroneAuthApp::handleStopOperation(LifecycleOperation *operation) {
-    if (selfMsg != nullptr && selfMsg->isScheduled()) {
-        cancelEvent(selfMsg);
+    for (AuthSession& s : sessions) {
+        cancelEngineTimers(s);
     }
-    if (timeoutMsg != nullptr && timeoutMsg->isScheduled()) {
-        cancelEvent(timeoutMsg);
+    if (powerSave) {
+        cancelEvent(wakeTimer);
+        cancelEvent(sleepTimer);
     }
+    subscribeTopology(false);
     socket.close();
 }
 
 void DroneAuthApp::handleCrashOperation(LifecycleOperation *operation) {
-    if (selfMsg != nullptr && selfMsg->isScheduled()) {
-        cancelEvent(selfMsg);
+    for (AuthSession& s : sessions) {
+        cancelEngineTimers(s);
     }
-    if (timeoutMsg != nullptr && timeoutMsg->isScheduled()) {
-        cancelEvent(timeoutMsg);
+    if (powerSave) {
+        cancelEvent(wakeTimer);
+        cancelEvent(sleepTimer);
     }
+    subscribeTopology(false);
     socket.destroy();
 }
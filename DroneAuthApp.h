@@ -13,62 +13,195 @@ using namespace omnetpp;
 #include "inet/common/INETDefs.h"
 #include "inet/applications/base/ApplicationBase.h"
 #include "inet/transportlayer/contract/udp/UdpSocket.h"
+#include "inet/networklayer/common/L3Address.h"
+#include "inet/physicallayer/wireless/common/contract/packetlevel/IRadio.h"
+#include "AllocTracker.h"
+#include "PerfTimer.h"
+#include "DroneAuthLog.h"
+#include "AirtimeMeter.h"
+#include "EnergyMeter.h"
+#include "DroneCpuProfile.h"
+#include "AuthEngine.h"
 
-// Forward declaration
-namespace droneauth {
-    class ZKPModule;
-}
-
-class DroneAuthApp : public inet::ApplicationBase
+class DroneAuthApp : public inet::ApplicationBase, public omnetpp::cListener
 {
 protected:
+    // One entry of destAddress with its health, kept between sends
+    struct GroundStationCandidate {
+        std::string name;
+        inet::L3Address address;       // unspecified if the name did not resolve
+        int consecutiveTimeouts = 0;
+        bool healthy = true;           // cleared after failoverTimeouts silent handshakes
+    };
+
+    // One handshake state machine with its own prover, commitment and timers
+    // (kind = session * DRONE_TIMER_COUNT + DroneTimer). With raceWidth > 1
+    // each session is bound to one of the nearest candidates and the first
+    // success cancels the others; every new handshake starts all of them again.
+    // A session moves to another candidate only after failoverTimeouts.
+    struct AuthSession {
+        droneauth::DroneEngine *engine = nullptr;
+        omnetpp::cMessage *timers[droneauth::DRONE_TIMER_COUNT] = {};
+        int candidate = -1;     // fixed target while racing; -1 = follows currentCandidate
+        bool inFlight = false;  // request sent, no verdict or timeout yet
+        bool done = false;      // lost the race; replies ignored until the next handshake
+        bool deferred = false;  // its request fell due while the radio was off
+    };
+
     // Parameters
     int localPort;
     int destPort;
+    int failoverTimeouts;
+    bool resolveEveryPacket;
+    int raceWidth;
+
+    // Ground stations in failover order, resolved on lifecycle start and after
+    // topology changes (candidatesStale) rather than on every send
+    std::vector<GroundStationCandidate> candidates;
+    int currentCandidate;
+    bool candidatesStale;
+    bool topologySubscribed;
+    int numFailovers;
+    int numRotations;
+    double bootKeyTime;        // wall-clock seconds to obtain the password key; -1 = no KDF
+    bool bootKeyFromCache;
     std::string droneId;
     std::string password;
+    std::vector<uint8_t> provisionedNonce;  // from fleetTable; empty = a fresh nonce at boot
+    bool printVerdicts;
+    bool assertAllocFree;
+    double cpuActivePower;
+    double cpuTimeScale;
+
+    // Compute-delay model for proof generation
+    enum ComputeModel { COMPUTE_FIXED, COMPUTE_PROFILE, COMPUTE_MEASURED };
+    ComputeModel computeModel;
+    const droneauth::CpuProfile *cpuProfile;
+    omnetpp::simtime_t proofDelay;
+    double pendingProofCpuTime;
     
-    // ZKP module
-    droneauth::ZKPModule *zkpModule;
-    
-    // State
-    std::string currentChallenge;
+    // Protocol state machines; session is the one whose output is being handled
+    std::vector<AuthSession> sessions;
+    AuthSession *session;
+    droneauth::DroneOutput engineOutput;
+    bool raceActive;                 // some session has a request in flight
+    bool authPending;                // requests sent since the last verdict
+    omnetpp::simtime_t authStart;    // first request since the last verdict
     
     // Network
     inet::UdpSocket socket;
-    omnetpp::cMessage *selfMsg;
-    omnetpp::cMessage *timeoutMsg;
+
+    // Power save (powerSave): once the ground station of a handshake in flight
+    // announced wake windows (WAKE_SCHEDULE), the radio is off between them unless a handshake is in
+    // flight. A request that falls due while it is off waits for the next window.
+    bool powerSave;
+    omnetpp::simtime_t sleepGuard;
+    omnetpp::simtime_t minWakeWindow;  // shorter windows are refused
+    omnetpp::simtime_t maxWakePeriod;  // rotationInterval (retryInterval if 0); longer periods are refused
+    inet::physicallayer::IRadio *radio;
+    inet::physicallayer::IRadio::RadioMode awakeRadioMode;
+    bool hasWakeSchedule;
+    bool radioAsleep;
+    bool windowOpen;
+    omnetpp::simtime_t wakeAnchor;     // start of one window
+    omnetpp::simtime_t wakePeriod;
+    omnetpp::simtime_t wakeWindow;
+    omnetpp::simtime_t sleepStart;
+    omnetpp::simtime_t totalSleepTime;
+    omnetpp::simtime_t requestDueAt;   // first request deferred since the last window; -1 = none
+    int numWakeWindows;
+    omnetpp::cMessage *wakeTimer;      // opens the next window
+    omnetpp::cMessage *sleepTimer;     // closes a window, or ends the guard after a handshake
+
+    // Verdict currently shown in the display strings; redrawn only when it changes
+    enum DisplayedVerdict { DISPLAY_NONE, DISPLAY_SUCCESS, DISPLAY_FAILURE };
+    DisplayedVerdict displayedVerdict;
     
     // Statistics
     int numAuthRequests;
     int numAuthSuccess;
     int numAuthFailures;
+    droneauth::AllocStats allocStats;
+    droneauth::PerfRegistry perf;
+    droneauth::LogRing logRing;
+    droneauth::AirtimeMeter airtimeMeter;
+    droneauth::EnergyMeter energyMeter;
+
+    // Energy accounting of the open handshake and totals over closed ones (J);
+    // radio energy counts from the request to the verdict or final timeout
+    double handshakeStartRadioEnergy;
+    double handshakeEndRadioEnergy;    // -1 = no verdict yet
+    double handshakeCpuEnergy;
+    bool handshakeSucceeded;
+    double successfulHandshakeEnergy;
+    double retryHandshakeEnergy;
+    double totalCpuEnergy;
+    int numRetryHandshakes;
     
     // Signals
     omnetpp::simsignal_t authRequestSignal;
     omnetpp::simsignal_t authSuccessSignal;
     omnetpp::simsignal_t authFailureSignal;
+    omnetpp::simsignal_t handshakeAirtimeSignal;
+    omnetpp::simsignal_t handshakeBytesOnAirSignal;
+    omnetpp::simsignal_t handshakeEnergySignal;
+    omnetpp::simsignal_t proofComputeTimeSignal;
+    omnetpp::simsignal_t failoverSignal;
+    omnetpp::simsignal_t authLatencySignal;
+    omnetpp::simsignal_t wakeDelaySignal;
 
 protected:
     virtual int numInitStages() const override { return inet::NUM_INIT_STAGES; }
     virtual void initialize(int stage) override;
+    virtual void loadFleetCredentials(const char *fileName, int index);
+    virtual void loadPasswordKey(std::vector<uint8_t>& key);
     virtual void finish() override;
     
     virtual void handleMessageWhenUp(omnetpp::cMessage *msg) override;
     virtual void handleSelfMessage(omnetpp::cMessage *msg);
     virtual void handleIncomingMessage(omnetpp::cMessage *msg);
+    virtual void runEngineTimer(AuthSession& s, droneauth::DroneTimer timer);
     
-    // Authentication flow
-    virtual void sendAuthenticationRequest();
-    virtual void handleChallengeMessage(const std::vector<uint8_t>& data);
-    virtual void sendZKProof();
-    virtual void handleAuthSuccessMessage(const std::vector<uint8_t>& data);
-    virtual void handleAuthFailureMessage(const std::vector<uint8_t>& data);
+    // Engine output: statistics and display first, then datagram and timers
+    virtual void handleEngineOutput(droneauth::DroneOutput& out);
+    virtual void applyEngineOutput(const droneauth::DroneOutput& out);
+    virtual void cancelEngineTimers(AuthSession& s);
+    virtual void startSessions();
+    virtual AuthSession *findSession(const inet::L3Address& source);
+    virtual bool hasSessionInFlight() const;
+    
+    // Authentication flow events
+    virtual void handleRequestSent();
+    virtual void handleChallenge(droneauth::DroneOutput& out);
+    virtual void handleProofSent(const droneauth::DroneOutput& out);
+    virtual double computeProofTime(const std::string& challenge);
+    virtual void handleAuthSuccess();
+    virtual void handleAuthFailure();
     virtual void handleAuthTimeout();
     
     // Utility
-    virtual void sendPacket(const std::vector<uint8_t>& data);
+    virtual void sendPacket(droneauth::ByteSpan data);
+    virtual void endHandshakeEnergy();
+    virtual void closeHandshakeAccounting();
+    virtual void showVerdict(DisplayedVerdict verdict);
+
+    // Ground-station candidates
+    virtual void resolveCandidates();
+    virtual const inet::L3Address& getDestination();
+    virtual void failOver();
+    virtual void rankCandidates();
+    virtual void subscribeTopology(bool subscribe);
+    virtual void receiveSignal(omnetpp::cComponent *source, omnetpp::simsignal_t signalID,
+                               omnetpp::cObject *obj, omnetpp::cObject *details) override;
+    virtual bool isPastWarmup() const { return numAuthRequests > 1; }
     
+    // Power save
+    virtual void handleWakeSchedule(const std::vector<uint8_t>& bytes);
+    virtual void openWakeWindow();
+    virtual void closeWakeWindow();
+    virtual void setRadioAwake(bool awake);
+    virtual omnetpp::simtime_t getNextWindowStart() const;
+
     // Lifecycle
     virtual void handleStartOperation(inet::LifecycleOperation *operation) override;
     virtual void handleStopOperation(inet::LifecycleOperation *operation) override;
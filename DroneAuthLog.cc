@@ -0,0 +1,31 @@
+/**
+ * DroneAuthLog.cc
+ */
+
+#include "DroneAuthLog.h"
+
+using namespace omnetpp;
+
+namespace droneauth {
+
+void LogRing::dump(const char *fileName, const std::string& modulePath) const {
+    if (records.empty() || fileName == nullptr || *fileName == '\0') {
+        return;
+    }
+    FILE *f = std::fopen(fileName, "ab");
+    if (f == nullptr) {
+        throw cRuntimeError("Cannot open log ring file '%s'", fileName);
+    }
+    uint32_t pathLen = modulePath.length();
+    uint64_t count = total < records.size() ? total : records.size();
+    size_t oldest = total < records.size() ? 0 : head;
+    std::fwrite(&pathLen, 4, 1, f);
+    std::fwrite(modulePath.data(), 1, pathLen, f);
+    std::fwrite(&count, 8, 1, f);
+    for (uint64_t i = 0; i < count; i++) {
+        std::fwrite(&records[(oldest + i) % records.size()], sizeof(LogRecord), 1, f);
+    }
+    std::fclose(f);
+}
+
+} // namespace droneauth
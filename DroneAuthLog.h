@@ -0,0 +1,91 @@
+/**
+ * DroneAuthLog.h
+ * Logging facade for the authentication hot paths
+ *
+ * DA_INFO/DA_WARN/DA_ERROR behave like EV_INFO/EV_WARN/EV_ERROR: the
+ * stream arguments are evaluated only when the log level is enabled. With
+ * -DDRONEAUTH_NO_LOGGING (the default for MODE=release, see makefrag) the
+ * statements are compiled out together with console verdict lines.
+ *
+ * LogRing keeps fixed-size binary event records in a preallocated ring so
+ * that a run can be traced without any text formatting.
+ */
+
+#ifndef __DRONEAUTH_DRONEAUTHLOG_H_
+#define __DRONEAUTH_DRONEAUTHLOG_H_
+
+#include <omnetpp.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "HexCodec.h"
+
+#ifdef DRONEAUTH_NO_LOGGING
+#define DA_LOG_STATEMENT(ev)    if (true) {} else ev
+#define DA_CONSOLE(enabled, ...) do {} while (0)
+#else
+#define DA_LOG_STATEMENT(ev)    ev
+#define DA_CONSOLE(enabled, ...) do { if (enabled) std::printf(__VA_ARGS__); } while (0)
+#endif
+
+#define DA_INFO   DA_LOG_STATEMENT(EV_INFO)
+#define DA_WARN   DA_LOG_STATEMENT(EV_WARN)
+#define DA_ERROR  DA_LOG_STATEMENT(EV_ERROR)
+
+namespace droneauth {
+
+// Event codes stored in LogRing records
+enum LogEvent : uint16_t {
+    LOGEV_AUTH_REQUEST_SENT = 1,
+    LOGEV_CHALLENGE_RECEIVED,
+    LOGEV_PROOF_SENT,
+    LOGEV_AUTH_SUCCESS,
+    LOGEV_AUTH_FAILURE,
+    LOGEV_AUTH_TIMEOUT,
+    LOGEV_GS_AUTH_REQUEST,
+    LOGEV_GS_UNAUTHORIZED,
+    LOGEV_GS_CHALLENGE_SENT,
+    LOGEV_GS_PROOF_VALID,
+    LOGEV_GS_PROOF_INVALID,
+    LOGEV_GS_MALFORMED,
+};
+
+struct LogRecord {
+    int64_t simtimeRaw;   // SimTime::raw() at the event
+    uint32_t arg;         // event-specific value, e.g. a counter or length
+    uint16_t event;       // LogEvent
+    uint16_t reserved;
+};
+
+class LogRing {
+public:
+    LogRing() : head(0), total(0) {}
+
+    // capacity 0 disables recording
+    void init(size_t capacity) { records.assign(capacity, LogRecord{0, 0, 0, 0}); head = 0; total = 0; }
+    bool isEnabled() const { return !records.empty(); }
+
+    void push(LogEvent event, uint32_t arg = 0) {
+        if (records.empty()) {
+            return;
+        }
+        records[head] = LogRecord{omnetpp::simTime().raw(), arg, (uint16_t)event, 0};
+        head = head + 1 == records.size() ? 0 : head + 1;
+        total++;
+    }
+
+    /**
+     * Appends the retained records, oldest first, to a binary file:
+     * [pathLen(4)] [path] [count(8)] [LogRecord * count]
+     */
+    void dump(const char *fileName, const std::string& modulePath) const;
+
+private:
+    std::vector<LogRecord> records;
+    size_t head;
+    uint64_t total;
+};
+
+} // namespace droneauth
+
+#endif
@@ -0,0 +1,42 @@
+/**
+ * DroneCpuProfile.cc
+ */
+
+#include "DroneCpuProfile.h"
+
+namespace droneauth {
+
+// Costs for "host" come from tools/zkp_calibrate on an x86-64 workstation
+// with SHA extensions; the others are scaled from published OpenSSL speed
+// figures for the respective cores. Re-run the tool to refresh them.
+static const CpuProfile profiles[] = {
+    // name              sha256BlockUs  proofOverheadUs  activePowerW
+    { "host",                 0.06,          1.8,            65.0 },
+    { "jetson-orin-nano",     0.45,          2.5,            7.0 },
+    { "jetson-nano",          0.60,          4.0,            5.0 },
+    { "raspberry-pi-4",       1.40,          6.0,            3.5 },
+    { "raspberry-pi-zero2",   3.00,         14.0,            1.5 },
+    { "stm32h7",              3.20,         30.0,            0.30 },
+    { "stm32f4",              9.50,         85.0,            0.12 },
+};
+
+const CpuProfile *CpuProfiles::find(const std::string& name) {
+    for (const CpuProfile& profile : profiles) {
+        if (name == profile.name) {
+            return &profile;
+        }
+    }
+    return nullptr;
+}
+
+const CpuProfile *CpuProfiles::all(size_t& count) {
+    count = sizeof(profiles) / sizeof(profiles[0]);
+    return profiles;
+}
+
+double CpuProfiles::proofGenerationTime(const CpuProfile& profile, size_t proofInputBytes) {
+    double us = profile.proofOverheadUs + sha256Blocks(proofInputBytes) * profile.sha256BlockUs;
+    return us * 1e-6;
+}
+
+} // namespace droneauth
@@ -0,0 +1,41 @@
+/**
+ * DroneCpuProfile.h
+ * Table-driven compute-cost model for ZKP operations on drone CPUs
+ */
+
+#ifndef DRONECPUPROFILE_H_
+#define DRONECPUPROFILE_H_
+
+#include <cstddef>
+#include <string>
+
+namespace droneauth {
+
+/**
+ * Per-operation costs of one CPU. A hash-based ZKP operation costs a fixed
+ * overhead (allocation, RNG, serialization) plus one compression per
+ * SHA-256 block of input, so costs grow with secret/challenge/key sizes.
+ */
+struct CpuProfile {
+    const char *name;
+    double sha256BlockUs;     // one SHA-256 compression (64-byte block)
+    double proofOverheadUs;   // generateProof + serialize, excluding hashing
+    double activePowerW;      // CPU power while computing
+};
+
+class CpuProfiles {
+public:
+    // nullptr if no profile has that name
+    static const CpuProfile *find(const std::string& name);
+    static const CpuProfile *all(size_t& count);
+
+    // SHA-256 blocks needed for a message of the given length (with padding)
+    static size_t sha256Blocks(size_t messageBytes) { return (messageBytes + 9 + 63) / 64; }
+
+    // Modelled time, in seconds, to generate and serialize one proof
+    static double proofGenerationTime(const CpuProfile& profile, size_t proofInputBytes);
+};
+
+} // namespace droneauth
+
+#endif /* DRONECPUPROFILE_H_ */
@@ -0,0 +1,38 @@
+/**
+ * EdgeCache.cc
+ */
+
+#include "EdgeCache.h"
+
+namespace droneauth {
+
+bool EdgeCache::lookup(const std::string& droneId, double now) {
+    auto it = entries.find(droneId);
+    if (it == entries.end() || it->second.expiresAt <= now) {
+        return false;
+    }
+    order.splice(order.begin(), order, it->second.position);
+    return true;
+}
+
+void EdgeCache::insert(const std::string& droneId, double now, std::vector<std::string>& evicted) {
+    if (capacity == 0) {
+        evicted.push_back(droneId);
+        return;
+    }
+    auto it = entries.find(droneId);
+    if (it != entries.end()) {
+        it->second.expiresAt = now + ttl;
+        order.splice(order.begin(), order, it->second.position);
+        return;
+    }
+    while (entries.size() >= capacity) {
+        evicted.push_back(order.back());
+        entries.erase(order.back());
+        order.pop_back();
+    }
+    order.push_front(droneId);
+    entries[droneId] = Entry{now + ttl, order.begin()};
+}
+
+} // namespace droneauth
@@ -0,0 +1,50 @@
+/**
+ * EdgeCache.h
+ * Drones an edge ground station verifies itself in tiered verification.
+ *
+ * An edge keeps the credentials of up to capacity recently verified drones
+ * in its engine and relays everything else to the central verifier. An entry
+ * is valid for ttl seconds after the central last confirmed it, so
+ * revocations at the central reach the edge within ttl. The least recently
+ * used entry makes room for a new one.
+ */
+
+#ifndef EDGECACHE_H_
+#define EDGECACHE_H_
+
+#include <cstddef>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace droneauth {
+
+class EdgeCache {
+public:
+    EdgeCache(size_t capacity, double ttl) : capacity(capacity), ttl(ttl) {}
+
+    // True if the drone is cached and not expired; marks it most recently used
+    bool lookup(const std::string& droneId, double now);
+    // Caches the drone for ttl from now; evicted receives the drones pushed out
+    // (the drone itself with capacity 0)
+    void insert(const std::string& droneId, double now, std::vector<std::string>& evicted);
+
+    size_t size() const { return entries.size(); }
+    size_t getCapacity() const { return capacity; }
+
+private:
+    struct Entry {
+        double expiresAt;
+        std::list<std::string>::iterator position;
+    };
+
+    size_t capacity;
+    double ttl;
+    std::list<std::string> order;   // most recently used first
+    std::unordered_map<std::string, Entry> entries;
+};
+
+} // namespace droneauth
+
+#endif /* EDGECACHE_H_ */
@@ -0,0 +1,54 @@
+/**
+ * EnergyMeter.cc
+ */
+
+#include "EnergyMeter.h"
+
+using namespace omnetpp;
+
+namespace droneauth {
+
+static simsignal_t powerConsumptionChangedSignal = cComponent::registerSignal("powerConsumptionChanged");
+
+EnergyMeter::~EnergyMeter() {
+    unsubscribe();
+}
+
+void EnergyMeter::subscribeTo(cModule *host) {
+    unsubscribe();
+    node = host;
+    lastUpdate = simTime();
+    node->subscribe(powerConsumptionChangedSignal, this);
+}
+
+void EnergyMeter::unsubscribe() {
+    if (node != nullptr) {
+        if (node->isSubscribed(powerConsumptionChangedSignal, this)) {
+            node->unsubscribe(powerConsumptionChangedSignal, this);
+        }
+        node = nullptr;
+    }
+}
+
+void EnergyMeter::integrate() {
+    simtime_t now = simTime();
+    energy += totalPower * (now - lastUpdate).dbl();
+    lastUpdate = now;
+}
+
+double EnergyMeter::getEnergy() {
+    integrate();
+    return energy;
+}
+
+void EnergyMeter::receiveSignal(cComponent *source, simsignal_t signalID, double d, cObject *details) {
+    if (signalID != powerConsumptionChangedSignal) {
+        return;
+    }
+    integrate();
+    double& power = powerBySource[source];
+    totalPower += d - power;
+    power = d;
+}
+
+} // namespace droneauth
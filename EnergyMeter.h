@@ -0,0 +1,45 @@
+/**
+ * EnergyMeter.h
+ * Radio energy integration from INET power consumption signals
+ */
+
+#ifndef __DRONEAUTH_ENERGYMETER_H_
+#define __DRONEAUTH_ENERGYMETER_H_
+
+#include <omnetpp.h>
+#include <map>
+
+namespace droneauth {
+
+/**
+ * Integrates the "powerConsumptionChanged" signals (W) emitted by the INET
+ * energy consumers of a network node, e.g. the StateBasedEpEnergyConsumer
+ * of each radio. Without energy consumers the energy stays zero.
+ */
+class EnergyMeter : public omnetpp::cListener {
+public:
+    EnergyMeter() : node(nullptr), totalPower(0), energy(0) {}
+    virtual ~EnergyMeter();
+
+    void subscribeTo(omnetpp::cModule *node);
+    void unsubscribe();
+
+    // Energy consumed since subscription, in joules, up to the current simulation time
+    double getEnergy();
+
+    virtual void receiveSignal(omnetpp::cComponent *source, omnetpp::simsignal_t signalID,
+                               double d, omnetpp::cObject *details) override;
+
+private:
+    void integrate();
+
+    omnetpp::cModule *node;
+    std::map<omnetpp::cComponent *, double> powerBySource;
+    double totalPower;
+    double energy;
+    omnetpp::simtime_t lastUpdate;
+};
+
+} // namespace droneauth
+
+#endif
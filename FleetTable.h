@@ -0,0 +1,219 @@
+/**
+ * FleetTable.h
+ * Binary provisioning tables written by tools/fleet_provision, read in place
+ * via mmap.
+ *
+ *   NAME.drones  [FleetHeader] [DroneSecret] x numDrones       DroneAuthApp fleetTable
+ *   NAME.auth    [FleetHeader] [AuthRecord] x numDrones        GroundStation fleetTable
+ *                [id index] [commitment index]                 uint32 x indexSlots each
+ *
+ * The ground-station file holds no secrets. Index slots hold record number
+ * + 1 (0 = empty); lookups probe linearly from fleetHash(key) masked to
+ * indexSlots, a power of two at least twice numDrones.
+ *
+ * Credentials follow ZKPModule::initializeProver / createCommitment:
+ * secret = SHA256(droneId || password || nonce), commitment = SHA256(secret || nonce).
+ * A ground station authorizes and enrolls every drone of its table. A drone
+ * takes its ID, password and nonce from its record and boots with the
+ * commitment enrolled for it.
+ */
+
+#ifndef FLEETTABLE_H_
+#define FLEETTABLE_H_
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace droneauth {
+
+static const char FLEET_DRONES_MAGIC[8] = { 'D', 'A', 'F', 'L', 'E', 'E', 'T', 'D' };
+static const char FLEET_AUTH_MAGIC[8] = { 'D', 'A', 'F', 'L', 'E', 'E', 'T', 'A' };
+static const uint32_t FLEET_VERSION = 1;
+static const size_t FLEET_ID_SIZE = 16;       // NUL-padded, e.g. "DRONE_1000000"
+static const size_t FLEET_PASSWORD_SIZE = 32; // hex digits, usable as the NED password
+static const size_t FLEET_HASH_SIZE = 32;
+
+struct FleetHeader {
+    char magic[8];                  // FLEET_DRONES_MAGIC or FLEET_AUTH_MAGIC
+    uint32_t version;
+    uint32_t headerSize;            // offset of the first record
+    uint64_t numDrones;
+    uint64_t indexSlots;            // .auth only
+    uint64_t idIndexOffset;         // .auth only
+    uint64_t commitmentIndexOffset; // .auth only
+};
+
+struct DroneSecret {
+    char droneId[FLEET_ID_SIZE];
+    char password[FLEET_PASSWORD_SIZE];
+    uint8_t nonce[FLEET_HASH_SIZE];
+    uint8_t secret[FLEET_HASH_SIZE];
+};
+
+struct AuthRecord {
+    char droneId[FLEET_ID_SIZE];
+    uint8_t commitment[FLEET_HASH_SIZE];
+};
+
+// FNV-1a; keys are IDs or hashes, so this only has to spread them
+inline uint64_t fleetHash(const uint8_t *key, size_t length) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ key[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+inline size_t fleetIdLength(const char *droneId) {
+    return strnlen(droneId, FLEET_ID_SIZE);
+}
+
+// Maps a whole table read-only; nullptr with a message in error
+inline const uint8_t *mapFleetTable(const char *fileName, size_t& size, std::string& error) {
+    int fd = ::open(fileName, O_RDONLY);
+    if (fd < 0) {
+        error = std::string("cannot open ") + fileName + ": " + std::strerror(errno);
+        return nullptr;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(FleetHeader)) {
+        error = std::string(fileName) + " is not a fleet table (too short)";
+        ::close(fd);
+        return nullptr;
+    }
+    void *mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        error = std::string("cannot map ") + fileName + ": " + std::strerror(errno);
+        return nullptr;
+    }
+    size = st.st_size;
+    return (const uint8_t *)mapping;
+}
+
+// Read-only view of a .drones table
+class FleetDroneTable {
+public:
+    FleetDroneTable() : base(nullptr), size(0) {}
+    ~FleetDroneTable() { close(); }
+
+    bool open(const char *fileName, std::string& error) {
+        close();
+        base = mapFleetTable(fileName, size, error);
+        if (base == nullptr) {
+            return false;
+        }
+        const FleetHeader& h = getHeader();
+        if (std::memcmp(h.magic, FLEET_DRONES_MAGIC, sizeof(h.magic)) != 0 || h.version != FLEET_VERSION
+                || h.headerSize + h.numDrones * sizeof(DroneSecret) > size) {
+            error = std::string(fileName) + " is not a version 1 drone fleet table";
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close() {
+        if (base != nullptr) {
+            munmap((void *)base, size);
+            base = nullptr;
+            size = 0;
+        }
+    }
+
+    const FleetHeader& getHeader() const { return *(const FleetHeader *)base; }
+    uint64_t getNumDrones() const { return getHeader().numDrones; }
+    const DroneSecret& getRecord(uint64_t i) const {
+        return ((const DroneSecret *)(base + getHeader().headerSize))[i];
+    }
+
+private:
+    const uint8_t *base;
+    size_t size;
+};
+
+// Read-only view of a .auth table
+class FleetAuthTable {
+public:
+    FleetAuthTable() : base(nullptr), size(0) {}
+    ~FleetAuthTable() { close(); }
+
+    bool open(const char *fileName, std::string& error) {
+        close();
+        base = mapFleetTable(fileName, size, error);
+        if (base == nullptr) {
+            return false;
+        }
+        const FleetHeader& h = getHeader();
+        uint64_t indexBytes = h.indexSlots * sizeof(uint32_t);
+        if (std::memcmp(h.magic, FLEET_AUTH_MAGIC, sizeof(h.magic)) != 0 || h.version != FLEET_VERSION
+                || h.indexSlots == 0 || (h.indexSlots & (h.indexSlots - 1)) != 0
+                || h.idIndexOffset + indexBytes > size || h.commitmentIndexOffset + indexBytes > size
+                || h.headerSize + h.numDrones * sizeof(AuthRecord) > size) {
+            error = std::string(fileName) + " is not a version 1 ground-station fleet table";
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close() {
+        if (base != nullptr) {
+            munmap((void *)base, size);
+            base = nullptr;
+            size = 0;
+        }
+    }
+
+    const FleetHeader& getHeader() const { return *(const FleetHeader *)base; }
+    uint64_t getNumDrones() const { return getHeader().numDrones; }
+    const AuthRecord& getRecord(uint64_t i) const {
+        return ((const AuthRecord *)(base + getHeader().headerSize))[i];
+    }
+
+    // nullptr if the drone is not provisioned
+    const AuthRecord *findDrone(const char *droneId, size_t length) const {
+        const FleetHeader& h = getHeader();
+        const uint32_t *slots = (const uint32_t *)(base + h.idIndexOffset);
+        for (uint64_t i = fleetHash((const uint8_t *)droneId, length);; i++) {
+            uint32_t slot = slots[i & (h.indexSlots - 1)];
+            if (slot == 0) {
+                return nullptr;
+            }
+            const AuthRecord& record = getRecord(slot - 1);
+            if (fleetIdLength(record.droneId) == length && std::memcmp(record.droneId, droneId, length) == 0) {
+                return &record;
+            }
+        }
+    }
+
+    const AuthRecord *findCommitment(const uint8_t *commitment) const {
+        const FleetHeader& h = getHeader();
+        const uint32_t *slots = (const uint32_t *)(base + h.commitmentIndexOffset);
+        for (uint64_t i = fleetHash(commitment, FLEET_HASH_SIZE);; i++) {
+            uint32_t slot = slots[i & (h.indexSlots - 1)];
+            if (slot == 0) {
+                return nullptr;
+            }
+            const AuthRecord& record = getRecord(slot - 1);
+            if (std::memcmp(record.commitment, commitment, FLEET_HASH_SIZE) == 0) {
+                return &record;
+            }
+        }
+    }
+
+private:
+    const uint8_t *base;
+    size_t size;
+};
+
+} // namespace droneauth
+
+#endif /* FLEETTABLE_H_ */
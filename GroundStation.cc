@@ -3,48 +3,207 @@
  * Ground station with Zero-Knowledge Proof verification
  */
 #include "GroundStation.h"
-#include "ZKPModule.h"
+#include "StatsRecording.h"
+#include "DroneAuthLog.h"
+#include "FleetTable.h"
+#include "SyntheticFleet.h"
 #include <omnetpp.h>
 #include "inet/common/ModuleAccess.h"
 #include "inet/common/packet/Packet.h"
+#include "inet/networklayer/common/L3AddressResolver.h"
 #include "inet/networklayer/common/L3AddressTag_m.h"
+#include "inet/networklayer/contract/IInterfaceTable.h"
+#include "inet/networklayer/ipv4/Ipv4InterfaceData.h"
 #include "inet/transportlayer/common/L4PortTag_m.h"
 #include "inet/transportlayer/contract/udp/UdpSocket.h"
 #include <set>
+#include <cerrno>
 #include <cstdio>
+#include <cstring>
 using namespace inet;
 using namespace omnetpp;
 using namespace droneauth;
 Define_Module(GroundStation);
-GroundStation::GroundStation() {
-    authorizedDrones = {
-        "DRONE_001",
-        "DRONE_002",
-        "DRONE_003",
-        "DRONE_004",
-        "DRONE_005"
-    };
+// Self message kinds
+#define MSG_SERVICE_DONE    1
+#define MSG_SYNC_ROUND      2
+#define MSG_CHURN           3
+#define MSG_BATCH_WINDOW    4
+#define MSG_LOG_SHIP        5
+#define MSG_TAKEOVER        6
+#define MSG_AUDIT_COMMIT    7
+
+// Type of the protocol message inside a datagram, relayed or not
+static uint8_t innerMessageType(const std::vector<uint8_t>& bytes) {
+    if (bytes.size() > 5 && bytes[0] == MSG_RELAY) {
+        return bytes[5];
+    }
+    return bytes.empty() ? 0 : bytes[0];
+}
+
+GroundStation::GroundStation() : requestQueue("requestQueue") {
+    engine = nullptr;
+    replica = nullptr;
+    edgeCache = nullptr;
+    batchTimer = nullptr;
+    sessionLog = nullptr;
+    logShipTimer = nullptr;
+    takeoverTimer = nullptr;
+    auditTimer = nullptr;
+    syncTimer = nullptr;
+    churnTimer = nullptr;
+    numRequestsInService = 0;
 }
 GroundStation::~GroundStation() {
-    // Clean up drone verifiers
-    for (auto& pair : droneVerifiers) {
-        delete pair.second;
+    cancelAndDelete(syncTimer);
+    cancelAndDelete(churnTimer);
+    cancelAndDelete(logShipTimer);
+    cancelAndDelete(takeoverTimer);
+    cancelAndDelete(auditTimer);
+    delete replica;
+    delete edgeCache;
+    delete sessionLog;
+    delete engine;
+    clearRequests();
+    for (cMessage *timer : serviceTimers) {
+        cancelAndDelete(timer);
     }
-    droneVerifiers.clear();
+    cancelAndDelete(batchTimer);
 }
 void GroundStation::initialize(int stage) {
     ApplicationBase::initialize(stage);
     if (stage == INITSTAGE_LOCAL) {
         localPort = par("localPort");
+        printVerdicts = par("printVerdicts");
+        logRing.init(par("logRingSize").intValue());
+        numVerifierCores = par("numVerifierCores");
+        maxQueueLength = par("maxQueueLength");
+        serviceBatches.resize(numVerifierCores);
+        for (int i = 0; i < numVerifierCores; i++) {
+            cMessage *timer = new cMessage("verifierDone", MSG_SERVICE_DONE);
+            timer->setContextPointer(&serviceBatches[i]);
+            serviceTimers.push_back(timer);
+        }
+        maxBatchSize = par("maxBatchSize");
+        batchWindow = par("batchWindow").doubleValue();
+        batchOverheadTime = par("batchOverheadTime").doubleValue();
+        if (maxBatchSize < 1) {
+            throw cRuntimeError("maxBatchSize must be at least 1");
+        }
+        if (maxBatchSize > 1) {
+            batchTimer = new cMessage("batchWindow", MSG_BATCH_WINDOW);
+        }
+        assertAllocFree = par("assertAllocFree");
+        measuredServiceTimes = strcmp(par("serviceTimeMode").stringValue(), "measured") == 0;
+        serviceTimeScale = par("serviceTimeScale");
+        requestServiceTime = par("requestServiceTime").doubleValue();
+        proofServiceTime = par("proofServiceTime").doubleValue();
+        busyTime = SIMTIME_ZERO;
+        serviceStartTime = simTime();
         // Statistics
         numAuthRequests = 0;
         numAuthSuccess = 0;
         numAuthFailures = 0;
+        numDroppedRequests = 0;
         // Register signals
         authRequestSignal = registerSignal("authRequest");
         authSuccessSignal = registerSignal("authSuccess");
         authFailureSignal = registerSignal("authFailure");
-        EV << "Ground Station initialized" << endl;
+        queueingDelaySignal = registerSignal("queueingDelay");
+        queueLengthSignal = registerSignal("queueLength");
+        serviceTimeSignal = registerSignal("serviceTime");
+        requestDroppedSignal = registerSignal("requestDropped");
+        realtimeLagSignal = registerSignal("realtimeLag");
+        recordRealtimeLag = par("recordRealtimeLag");
+        airtimeMeter.subscribeTo(getContainingNode(this), "GroundStationData");
+        GroundStationConfig config;
+        authorizeSyntheticFleet(config, par("syntheticFleetSize").intValue());
+        engine = new GroundStationEngine(config, &perf);
+        const char *fleetTable = par("fleetTable").stringValue();
+        if (*fleetTable != '\0') {
+            loadFleetTable(fleetTable);
+        }
+        syncPort = par("syncPort");
+        syncInterval = par("syncInterval").doubleValue();
+        churnInterval = par("churnInterval").doubleValue();
+        churnSize = par("churnSize");
+        numChurned = 0;
+        numSyncBytes = 0;
+        numSyncMessages = 0;
+        numReplicatedRecords = 0;
+        syncBytesSignal = registerSignal("syncBytes");
+        replicationDelaySignal = registerSignal("replicationDelay");
+        if (*par("syncPeers").stringValue() != '\0') {
+            replica = new AuthReplica(par("syncTreeDepth").intValue());
+            syncTimer = new cMessage("syncRound", MSG_SYNC_ROUND);
+        }
+        if (churnInterval > SIMTIME_ZERO) {
+            churnTimer = new cMessage("authorizationChurn", MSG_CHURN);
+        }
+        backhaulPort = par("backhaulPort");
+        isCentral = *par("edgeAddresses").stringValue() != '\0';
+        relayTimeout = par("relayTimeout").doubleValue();
+        nextRelayId = 0;
+        numCacheHits = 0;
+        numCacheMisses = 0;
+        numBackhaulBytes = 0;
+        numCredentialUpdates = 0;
+        numRelayedDatagrams = 0;
+        verifierBatchSizeSignal = registerSignal("verifierBatchSize");
+        edgeCacheHitSignal = registerSignal("edgeCacheHit");
+        relayLatencySignal = registerSignal("relayLatency");
+        backhaulBytesSignal = registerSignal("backhaulBytes");
+        if (*par("centralAddress").stringValue() != '\0') {
+            edgeCache = new EdgeCache(par("edgeCacheSize").intValue(), par("edgeCacheTtl").doubleValue());
+        }
+        logPort = par("logPort");
+        logShipInterval = par("logShipInterval").doubleValue();
+        heartbeatInterval = par("heartbeatInterval").doubleValue();
+        takeoverTimeout = par("takeoverTimeout").doubleValue();
+        isStandby = *par("standbyFor").stringValue() != '\0';
+        tookOver = false;
+        failoverTime = -1;
+        expectedLogSeq = 0;
+        numLogBytes = 0;
+        numLogFrames = 0;
+        numLogGaps = 0;
+        numLogRejected = 0;
+        logKey = par("logKey").stdstringValue();
+        numLogBytesLost = 0;
+        sessionLogBytesSignal = registerSignal("sessionLogBytes");
+        if (*par("standbyAddress").stringValue() != '\0') {
+            sessionLog = new SessionLogWriter();
+            sessionLog->setKey(logKey);
+            logShipTimer = new cMessage("shipSessionLog", MSG_LOG_SHIP);
+        }
+        if (isStandby) {
+            if (*par("logSource").stringValue() == '\0') {
+                throw cRuntimeError("A standby needs logSource, the primary's backhaul address");
+            }
+            takeoverTimer = new cMessage("takeover", MSG_TAKEOVER);
+        }
+        wakePeriod = par("wakePeriod").doubleValue();
+        wakeWindow = par("wakeWindow").doubleValue();
+        numWakeSchedules = 0;
+        if (wakePeriod > SIMTIME_ZERO && wakeWindow >= wakePeriod) {
+            throw cRuntimeError("wakeWindow must be shorter than wakePeriod");
+        }
+
+        const char *traceFile = par("traceFile").stringValue();
+        if (*traceFile != '\0' && !trace.open(traceFile)) {
+            throw cRuntimeError("Cannot create trace file '%s'", traceFile);
+        }
+        const char *auditLogFile = par("auditLogFile").stringValue();
+        if (*auditLogFile != '\0') {
+            std::string error;
+            if (!auditLog.open(auditLogFile, par("auditSegmentRecords").intValue(), error, &perf)) {
+                throw cRuntimeError("Cannot open audit log '%s': %s", auditLogFile, error.c_str());
+            }
+            auditCommitRecords = par("auditCommitRecords");
+            auditCommitInterval = par("auditCommitInterval").doubleValue();
+            auditTimer = new cMessage("auditCommit", MSG_AUDIT_COMMIT);
+        }
+        DA_INFO << "Ground Station initialized" << endl;
     }
 }
 void GroundStation::finish() {
@@ -56,194 +215,804 @@ void GroundStation::finish() {
         double successRate = (double)numAuthSuccess / numAuthRequests * 100.0;
         recordScalar("successRate", successRate);
     }
+    recordAirtimeUsage(this, airtimeMeter.getTotal(), numAuthSuccess);
+    if (replica != nullptr) {
+        recordScalar("syncBytesSent", numSyncBytes, "B");
+        recordScalar("syncMessagesSent", numSyncMessages);
+        recordScalar("replicatedRecords", numReplicatedRecords);
+        recordScalar("replicaRecords", replica->size());
+    }
+    if (edgeCache != nullptr) {
+        recordScalar("edgeCacheHits", numCacheHits);
+        recordScalar("edgeCacheMisses", numCacheMisses);
+        if (numCacheHits + numCacheMisses > 0) {
+            recordScalar("edgeHitRate", (double)numCacheHits / (numCacheHits + numCacheMisses));
+        }
+        recordScalar("edgeCachedDrones", edgeCache->size());
+        recordScalar("backhaulBytesSent", numBackhaulBytes, "B");
+        recordScalar("credentialUpdatesSent", numCredentialUpdates);
+    }
+    if (numRelayedDatagrams > 0) {
+        recordScalar("relayedDatagrams", numRelayedDatagrams);
+    }
+    if (sessionLog != nullptr) {
+        recordScalar("sessionLogBytesSent", numLogBytes, "B");
+        recordScalar("sessionLogFramesSent", numLogFrames);
+        recordScalar("sessionLogBytesLost", numLogBytesLost, "B");
+        if (numAuthSuccess > 0) {
+            recordScalar("sessionLogBytesPerHandshake", (double)numLogBytes / numAuthSuccess, "B");
+        }
+    }
+    if (isStandby) {
+        recordScalar("sessionLogFramesReceived", numLogFrames);
+        recordScalar("sessionLogGaps", numLogGaps);
+        recordScalar("sessionLogRejected", numLogRejected);
+        recordScalar("tookOver", tookOver);
+        if (tookOver) {
+            recordScalar("takeoverTime", takeoverTime, "s");
+        }
+        if (failoverTime >= SIMTIME_ZERO) {
+            recordScalar("failoverTime", failoverTime, "s");
+        }
+    }
+    if (wakePeriod > SIMTIME_ZERO) {
+        recordScalar("wakeSchedulesSent", numWakeSchedules);
+    }
+    if (numVerifierCores > 0) {
+        simtime_t elapsed = simTime() - serviceStartTime;
+        recordScalar("droppedRequests", numDroppedRequests);
+        recordScalar("verifierBusyTime", busyTime, "s");
+        if (elapsed > SIMTIME_ZERO) {
+            recordScalar("verifierUtilization", busyTime.dbl() / (numVerifierCores * elapsed.dbl()));
+        }
+    }
+    recordAllocStats(this, allocStats);
+    if (assertAllocFree) {
+        checkAllocFree(this, allocStats);
+    }
+    recordPerfRegistry(this, perf, par("perfSummaryFile").stringValue());
+    logRing.dump(par("logRingFile").stringValue(), getFullPath());
+    trace.close();
+    if (auditLog.isOpen()) {
+        commitAuditLog();
+        recordScalar("auditRecords", auditLog.getNumRecords());
+        recordScalar("auditCommits", auditLog.getNumCommits());
+        auditLog.close();
+    }
 }
 void GroundStation::handleMessageWhenUp(cMessage *msg) {
-    if (dynamic_cast<Packet *>(msg)) {
+    if (msg->isSelfMessage()) {
+        if (msg->getKind() == MSG_SYNC_ROUND) {
+            handleSyncRound();
+        } else if (msg->getKind() == MSG_CHURN) {
+            handleChurn();
+        } else if (msg->getKind() == MSG_BATCH_WINDOW) {
+            startServiceIfIdle();
+        } else if (msg->getKind() == MSG_LOG_SHIP) {
+            handleLogShipTimer();
+        } else if (msg->getKind() == MSG_TAKEOVER) {
+            takeOver();
+        } else if (msg->getKind() == MSG_AUDIT_COMMIT) {
+            commitAuditLog();
+            scheduleAfter(auditCommitInterval, auditTimer);
+        } else {
+            handleServiceCompletion(msg);
+        }
+    } else if (isStandby && logSocket.belongsToSocket(msg)) {
+        handleSessionLog(check_and_cast<Packet *>(msg));
+    } else if (replica != nullptr && syncSocket.belongsToSocket(msg)) {
+        handleSyncPacket(check_and_cast<Packet *>(msg));
+    } else if ((edgeCache != nullptr || isCentral) && backhaulSocket.belongsToSocket(msg)) {
+        handleBackhaulPacket(check_and_cast<Packet *>(msg));
+    } else if (dynamic_cast<Packet *>(msg)) {
         Packet *packet = check_and_cast<Packet *>(msg);
         auto chunk = packet->peekDataAsBytes();
-        std::vector<uint8_t> data(chunk->getBytes().begin(), chunk->getBytes().end());
-        auto srcAddr = packet->getTag<inet::L3AddressInd>()->getSrcAddress();
-        auto srcPort = packet->getTag<inet::L4PortInd>()->getSrcPort();
-        if (data.size() < 1) {
+        uint8_t msgType = chunk->getBytes().empty() ? 0 : chunk->getBytes()[0];
+        if (msgType == MSG_RELAY || msgType == MSG_CREDENTIALS) {
+            DA_WARN << "Backhaul frame on the drone port dropped" << endl;  // anyone can send here
             delete packet;
-            return;
+        } else if (edgeCache != nullptr && routeAtEdge(packet)) {
+            // relayed to the central verifier
+        } else if (numVerifierCores > 0) {
+            enqueueRequest(packet);
+        } else {
+            processPacket(packet);
         }
-        uint8_t msgType = data[0];
-        switch (msgType) {
-            case 0x01:
-                handleAuthRequest(data, srcAddr, srcPort);
-                break;
-            case 0x03:
-                handleProof(data, srcAddr, srcPort);
-                break;
-            default:
-                EV_WARN << "Unknown message type: " << (int)msgType << endl;
-        }
-        delete packet;
     } else {
-        EV_WARN << "Received indication message: " << msg->getName() << endl;
+        DA_WARN << "Received indication message: " << msg->getName() << endl;
         delete msg;
     }
 }
-void GroundStation::handleAuthRequest(const std::vector<uint8_t>& data,
-                                      const L3Address& srcAddr, int srcPort) {
-    numAuthRequests++;
-    emit(authRequestSignal, numAuthRequests);
-   
-    EV << "Received authentication request" << endl;
-   
-    // Parse: [type(1)] [droneId_len(4)] [droneId] [commitment_len(4)] [commitment]
-    if (data.size() < 9) {
-        EV_ERROR << "Invalid auth request message" << endl;
-        sendAuthFailure(srcAddr, srcPort);
+void GroundStation::processPacket(Packet *packet) {
+    auto chunk = packet->peekDataAsBytes();
+    const auto& bytes = chunk->getBytes();
+    if (bytes.size() < 1) {
+        delete packet;
         return;
     }
-    size_t offset = 1;
-    // Parse drone ID
-    uint32_t idLen;
-    std::memcpy(&idLen, &data[offset], 4);
-    offset += 4;
-    if (data.size() < offset + idLen + 4) {
-        EV_ERROR << "Auth request message too short" << endl;
-        sendAuthFailure(srcAddr, srcPort);
-        return;
+    // An edge's relay frame is answered in a relay frame with the same ID
+    uint32_t relayId = 0;
+    const uint8_t *datagram = bytes.data();
+    size_t datagramLength = bytes.size();
+    bool relayed = bytes[0] == MSG_RELAY;
+    if (relayed) {
+        if (!AuthCodec::decodeRelay(bytes.data(), bytes.size(), relayId, datagram, datagramLength)) {
+            DA_WARN << "Truncated relay frame" << endl;
+            delete packet;
+            return;
+        }
+        numRelayedDatagrams++;
     }
-    std::string droneId(data.begin() + offset, data.begin() + offset + idLen);
-   
-    // CHECK IF DRONE IS AUTHORIZED
-    if (authorizedDrones.find(droneId) == authorizedDrones.end()) {
-        EV << "✗✗✗ UNAUTHORIZED DRONE: " << droneId << " - Rejecting!" << endl;
-        printf("✗✗✗ UNAUTHORIZED DRONE: %s - Authentication REJECTED!\n", droneId.c_str());
-        sendAuthFailure(srcAddr, srcPort);
-        numAuthFailures++;
-        emit(authFailureSignal, numAuthFailures);
-        return;
+    AllocScope allocScope(allocStats, innerMessageType(bytes) == MSG_PROOF ? ALLOC_GS_RECV_PROOF : ALLOC_GS_RECV_REQUEST);
+    bool warm = numAuthSuccess > 0;  // scratch buffers have grown to handshake size
+    if (recordRealtimeLag) {
+        // Grows without bound once datagrams arrive faster than the simulation can serve them
+        double wallElapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - realtimeBase).count();
+        emit(realtimeLagSignal, wallElapsed - (simTime() - realtimeSimBase).dbl());
     }
-   
-    EV << "✓ Drone " << droneId << " is in authorized list" << endl;
-   
-    offset += idLen;
-    // Parse commitment
-    uint32_t commitLen;
-    std::memcpy(&commitLen, &data[offset], 4);
-    offset += 4;
-    if (data.size() < offset + commitLen) {
-        EV_ERROR << "Invalid commitment in auth request" << endl;
-        sendAuthFailure(srcAddr, srcPort);
-        return;
+    auto srcAddr = packet->getTag<inet::L3AddressInd>()->getSrcAddress();
+    auto srcPort = packet->getTag<inet::L4PortInd>()->getSrcPort();
+    uint32_t tracePeer = 0;
+    if (trace.isOpen()) {
+        // Stamped when served, like its reply: records stay in time order and each
+        // reply directly follows its datagram even with requests queued for a core
+        tracePeer = getTracePeer(srcAddr, srcPort);
+        trace.append(simTime().inUnit(SIMTIME_NS), tracePeer, TRACE_IN, ByteSpan(bytes));
     }
-    std::vector<uint8_t> commitment(data.begin() + offset, data.begin() + offset + commitLen);
-    EV << "Auth request from drone: " << droneId << endl;
-    EV << "Commitment: " << ZKPModule::bytesToHex(commitment).substr(0, 16) << "..." << endl;
-    // Create or get verifier for this drone
-    ZKPModule *verifier = nullptr;
-    auto it = droneVerifiers.find(droneId);
-    if (it == droneVerifiers.end()) {
-        // New drone - create verifier
-        verifier = new ZKPModule();
-        verifier->setup();
-        verifier->initializeVerifier(commitment, droneId);
-        droneVerifiers[droneId] = verifier;
-        EV << "Registered new drone: " << droneId << endl;
-    } else {
-        verifier = it->second;
-    }
-    // Generate challenge
-    std::string challenge = verifier->generateChallenge();
-    pendingChallenges[droneId] = challenge;
-    droneAddresses[droneId] = std::make_pair(srcAddr, srcPort);
-    EV << "Sending challenge: " << challenge << endl;
-    // Send challenge message: [type(1)] [challenge_len(4)] [challenge]
-    std::vector<uint8_t> msgData;
-    msgData.push_back(0x02); // CHALLENGE type
-    uint32_t chalLen = challenge.length();
-    msgData.insert(msgData.end(), (uint8_t*)&chalLen, (uint8_t*)&chalLen + 4);
-    msgData.insert(msgData.end(), challenge.begin(), challenge.end());
-    sendPacket(msgData, srcAddr, srcPort);
-}
-void GroundStation::handleProof(const std::vector<uint8_t>& data,
-                                const L3Address& srcAddr, int srcPort) {
-    EV << "Received proof from drone" << endl;
-    // Parse: [type(1)] [proof_data]
-    if (data.size() < 2) {
-        EV_ERROR << "Invalid proof message" << endl;
-        sendAuthFailure(srcAddr, srcPort);
-        return;
+    engine->onDatagram(ByteSpan(datagram, datagramLength), engineOutput);
+    recordEngineOutput(engineOutput, datagramLength);
+    if (auditLog.isOpen()) {
+        auditVerdict(engineOutput, ByteSpan(datagram, datagramLength), srcAddr);
+    }
+    if (warm && !engineOutput.newDrone && !engineOutput.rotated) {
+        allocScope.markSteadyState();
     }
-    // Deserialize proof
-    std::vector<uint8_t> proofData(data.begin() + 1, data.end());
-    ZKProof proof;
-    try {
-        proof = ZKProof::deserialize(proofData);
-    } catch (const std::exception& e) {
-        EV_ERROR << "Failed to deserialize proof: " << e.what() << endl;
-        sendAuthFailure(srcAddr, srcPort);
+    if (replica != nullptr && (engineOutput.newDrone || engineOutput.rotated)) {
+        recordLocalChange(engineOutput.droneId);
+    }
+    if (tookOver && failoverTime < SIMTIME_ZERO && engineOutput.event == GS_EVENT_PROOF_VALID) {
+        failoverTime = simTime() - lastLogReceived;
+    }
+    if (sessionLog != nullptr) {
+        sessionLog->record(*engine, engineOutput);
+        // The standby must know rotated credentials before the drone switches to them
+        if (engineOutput.rotated || sessionLog->size() >= SESSION_LOG_FRAME_BYTES) {
+            shipSessionLog();
+        }
+    }
+    if (edgeCache != nullptr && engineOutput.rotated) {
+        // Keeps the central authoritative for credentials rotated here
+        engine->getEnrollment(engineOutput.droneId, relayCommitment, &relayNextCommitment);
+        AuthCodec::encodeCredentials(relayBuffer, engineOutput.droneId, relayCommitment, relayNextCommitment);
+        sendBackhaul(ByteSpan(relayBuffer));
+        numCredentialUpdates++;
+    }
+    if (wakePeriod > SIMTIME_ZERO && !relayed && engineOutput.event == GS_EVENT_PROOF_VALID) {
+        sendWakeSchedule(engineOutput.droneId, srcAddr, srcPort);  // ahead of the verdict
+    }
+    if (!engineOutput.datagram.empty()) {
+        ByteSpan reply = engineOutput.datagram;
+        if (relayed) {
+            AuthCodec::encodeRelay(relayBuffer, relayId, reply.data, reply.size);
+            reply = ByteSpan(relayBuffer);
+        }
+        if (trace.isOpen()) {
+            trace.append(simTime().inUnit(SIMTIME_NS), tracePeer, TRACE_OUT, reply);
+        }
+        sendPacket(reply, srcAddr, srcPort, relayed ? &backhaulSocket : nullptr);
+    }
+    delete packet;
+}
+void GroundStation::enqueueRequest(Packet *packet) {
+    if (maxQueueLength >= 0 && requestQueue.getLength() >= maxQueueLength) {
+        DA_WARN << "Verifier queue full, dropping " << packet->getName() << endl;
+        numDroppedRequests++;
+        emit(requestDroppedSignal, (long)numDroppedRequests);
+        delete packet;
         return;
     }
-    // Find drone ID from challenge
-    std::string droneId;
-    for (const auto& pair : pendingChallenges) {
-        if (pair.second == proof.challenge) {
-            droneId = pair.first;
+    requestQueue.insert(packet);
+    emit(queueLengthSignal, (long)requestQueue.getLength());
+    startServiceIfIdle();
+}
+void GroundStation::startServiceIfIdle() {
+    while (numRequestsInService < numVerifierCores && !requestQueue.isEmpty()) {
+        if (requestQueue.getLength() < maxBatchSize) {
+            // A partial batch waits until its oldest request has waited batchWindow
+            simtime_t deadline = check_and_cast<Packet *>(requestQueue.front())->getArrivalTime() + batchWindow;
+            if (deadline > simTime()) {
+                if (!batchTimer->isScheduled()) {
+                    scheduleAt(deadline, batchTimer);
+                }
+                return;
+            }
+        }
+        // The batch is processed (and answered) when its core finishes; the
+        // fixed overhead is paid once per batch
+        cMessage *done = findIdleServiceTimer();
+        auto batch = static_cast<std::vector<Packet *> *>(done->getContextPointer());
+        simtime_t serviceTime = batchOverheadTime * serviceTimeScale;
+        while (!requestQueue.isEmpty() && (int)batch->size() < maxBatchSize) {
+            Packet *packet = check_and_cast<Packet *>(requestQueue.pop());
+            emit(queueingDelaySignal, simTime() - packet->getArrivalTime());
+            serviceTime += getServiceTime(packet);
+            batch->push_back(packet);
+        }
+        emit(queueLengthSignal, (long)requestQueue.getLength());
+        emit(serviceTimeSignal, serviceTime);
+        if (maxBatchSize > 1) {
+            emit(verifierBatchSizeSignal, (long)batch->size());
+        }
+        busyTime += serviceTime;
+        numRequestsInService++;
+        scheduleAt(simTime() + serviceTime, done);
+    }
+}
+void GroundStation::handleServiceCompletion(cMessage *msg) {
+    if (msg->getKind() != MSG_SERVICE_DONE) {
+        throw cRuntimeError("Unknown self message kind: %d", msg->getKind());
+    }
+    auto batch = static_cast<std::vector<Packet *> *>(msg->getContextPointer());
+    numRequestsInService--;
+    for (Packet *packet : *batch) {
+        processPacket(packet);
+    }
+    batch->clear();
+    startServiceIfIdle();
+}
+simtime_t GroundStation::getServiceTime(Packet *packet) {
+    auto chunk = packet->peekDataAsBytes();
+    bool isProof = innerMessageType(chunk->getBytes()) == MSG_PROOF;
+    simtime_t serviceTime = isProof ? proofServiceTime : requestServiceTime;
+    if (measuredServiceTimes) {
+        // Live mean of the real handler cost on this host, once there is a sample
+        const LatencyHistogram& measured = perf.phase(isProof ? PERF_GS_PROOF : PERF_GS_AUTH_REQUEST);
+        if (measured.getCount() > 0) {
+            serviceTime = measured.getMeanNs() * 1e-9;
+        }
+    }
+    return serviceTime * serviceTimeScale;
+}
+void GroundStation::clearRequests() {
+    for (cMessage *timer : serviceTimers) {
+        if (timer->isScheduled()) {
+            auto batch = static_cast<std::vector<Packet *> *>(timer->getContextPointer());
+            for (Packet *packet : *batch) {
+                delete packet;
+            }
+            batch->clear();
+            cancelEvent(timer);
+        }
+    }
+    if (batchTimer != nullptr) {
+        cancelEvent(batchTimer);
+    }
+    numRequestsInService = 0;
+    requestQueue.clear();
+}
+
+cMessage *GroundStation::findIdleServiceTimer() {
+    for (cMessage *timer : serviceTimers) {
+        if (!timer->isScheduled()) {
+            return timer;
+        }
+    }
+    throw cRuntimeError("No idle verifier core timer");
+}
+void GroundStation::recordEngineOutput(const GroundStationOutput& out, size_t datagramSize) {
+    if (out.msgType == MSG_AUTH_REQUEST) {
+        numAuthRequests++;
+        emit(authRequestSignal, numAuthRequests);
+        logRing.push(LOGEV_GS_AUTH_REQUEST, datagramSize);
+        DA_INFO << "Received authentication request" << endl;
+    } else if (out.msgType == MSG_PROOF) {
+        DA_INFO << "Received proof from drone" << endl;
+    }
+    switch (out.event) {
+        case GS_EVENT_CHALLENGE_SENT:
+            DA_INFO << "✓ Drone " << out.droneId << " is in authorized list" << endl;
+            if (out.newDrone) {
+                DA_INFO << "Registered new drone: " << out.droneId << endl;
+            }
+            DA_INFO << "Sending challenge (" << out.datagram.size << " bytes)" << endl;
+            logRing.push(LOGEV_GS_CHALLENGE_SENT, out.datagram.size);
+            break;
+        case GS_EVENT_UNAUTHORIZED:
+            DA_INFO << "✗✗✗ UNAUTHORIZED DRONE: " << out.droneId << " - Rejecting!" << endl;
+            DA_CONSOLE(printVerdicts, "✗✗✗ UNAUTHORIZED DRONE: %s - Authentication REJECTED!\n", out.droneId.c_str());
+            logRing.push(LOGEV_GS_UNAUTHORIZED, out.droneId.length());
+            numAuthFailures++;
+            emit(authFailureSignal, numAuthFailures);
+            break;
+        case GS_EVENT_MALFORMED:
+            DA_ERROR << "Malformed message of type " << (int)out.msgType << endl;
+            logRing.push(LOGEV_GS_MALFORMED, datagramSize);
+            break;
+        case GS_EVENT_UNKNOWN_CHALLENGE:
+            DA_ERROR << "Unknown challenge in proof" << endl;
+            break;
+        case GS_EVENT_PROOF_VALID:
+            numAuthSuccess++;
+            emit(authSuccessSignal, numAuthSuccess);
+            logRing.push(LOGEV_GS_PROOF_VALID, numAuthSuccess);
+            DA_INFO << "Proof verification completed in " << perf.phase(PERF_ZKP_VERIFY_PROOF).getLastNs() / 1e6 << " ms" << endl;
+            DA_INFO << "✓✓✓ Drone " << out.droneId << " AUTHENTICATED successfully!" << endl;
             break;
+        case GS_EVENT_PROOF_INVALID:
+            numAuthFailures++;
+            emit(authFailureSignal, numAuthFailures);
+            logRing.push(LOGEV_GS_PROOF_INVALID, numAuthFailures);
+            DA_ERROR << "✗✗✗ Authentication FAILED for drone " << out.droneId << endl;
+            break;
+        case GS_EVENT_UNKNOWN_TYPE:
+            DA_WARN << "Unknown message type: " << (int)out.msgType << endl;
+            break;
+        default:
+            break;
+    }
+}
+void GroundStation::handleSyncRound() {
+    // One round with every peer; each resolves again so that restarted peers are found
+    cStringTokenizer tokenizer(par("syncPeers").stringValue());
+    while (tokenizer.hasMoreTokens()) {
+        const char *peer = tokenizer.nextToken();
+        L3Address address;
+        if (!L3AddressResolver().tryResolve(peer, address)) {
+            DA_WARN << "Sync peer " << peer << " does not resolve" << endl;
+            continue;
         }
+        syncOut.clear();
+        replica->beginSync(syncOut);
+        sendSyncMessages(address, syncPort);
     }
-    if (droneId.empty()) {
-        EV_ERROR << "Unknown challenge in proof" << endl;
-        sendAuthFailure(srcAddr, srcPort);
-        return;
+    scheduleAfter(syncInterval, syncTimer);
+}
+
+void GroundStation::loadFleetTable(const char *fileName) {
+    FleetAuthTable table;
+    std::string error;
+    if (!table.open(fileName, error)) {
+        throw cRuntimeError("Cannot load fleet table: %s", error.c_str());
+    }
+    // Pinned like credentials from another ground station: only the provisioned commitment verifies
+    std::string droneId;
+    std::vector<uint8_t> commitment;
+    for (uint64_t i = 0; i < table.getNumDrones(); i++) {
+        const AuthRecord& record = table.getRecord(i);
+        droneId.assign(record.droneId, fleetIdLength(record.droneId));
+        commitment.assign(record.commitment, record.commitment + sizeof(record.commitment));
+        engine->setAuthorized(droneId, true);
+        engine->setEnrollment(droneId, commitment);
+    }
+    DA_INFO << "Enrolled " << table.getNumDrones() << " drones from " << fileName << endl;
+}
+
+void GroundStation::handleChurn() {
+    // New IDs past the synthetic fleet, authorized here only
+    int first = par("syntheticFleetSize").intValue() + numChurned;
+    for (int i = 0; i < churnSize; i++) {
+        std::string droneId = syntheticDroneId(first + i);
+        engine->setAuthorized(droneId, true);
+        if (replica != nullptr) {
+            recordLocalChange(droneId);
+        }
+    }
+    numChurned += churnSize;
+    scheduleAfter(churnInterval, churnTimer);
+}
+
+void GroundStation::handleSyncPacket(Packet *packet) {
+    auto chunk = packet->peekDataAsBytes();
+    const auto& bytes = chunk->getBytes();
+    syncOut.clear();
+    syncApplied.clear();
+    if (!replica->onSyncMessage(bytes.data(), bytes.size(), syncOut, syncApplied)) {
+        DA_WARN << "Malformed sync message of " << bytes.size() << " bytes" << endl;
+    }
+    for (const std::string& droneId : syncApplied) {
+        applyReplicatedRecord(droneId);
+    }
+    sendSyncMessages(packet->getTag<L3AddressInd>()->getSrcAddress(), packet->getTag<L4PortInd>()->getSrcPort());
+    delete packet;
+}
+
+void GroundStation::sendSyncMessages(const L3Address& destAddr, int destPort) {
+    for (const std::vector<uint8_t>& message : syncOut) {
+        const auto& payload = makeShared<BytesChunk>(message.data(), message.size());
+        Packet *packet = new Packet("AuthSync");
+        packet->insertAtBack(payload);
+        syncSocket.sendTo(packet, destAddr, destPort);
+        numSyncBytes += message.size();
+        numSyncMessages++;
+        emit(syncBytesSignal, (long)message.size());
+    }
+}
+
+void GroundStation::recordLocalChange(const std::string& droneId) {
+    if (!engine->getEnrollment(droneId, syncCommitment)) {
+        syncCommitment.clear();
+    }
+    replica->update(droneId, engine->isAuthorized(droneId), syncCommitment, simTime().dbl());
+}
+
+void GroundStation::applyReplicatedRecord(const std::string& droneId) {
+    const ReplicaRecord *record = replica->find(droneId);
+    engine->setAuthorized(droneId, record->authorized);
+    if (!record->commitment.empty()) {
+        engine->setEnrollment(droneId, record->commitment);
+    }
+    numReplicatedRecords++;
+    emit(replicationDelaySignal, simTime() - record->changedAt);
+    DA_INFO << "Replicated " << droneId << (record->authorized ? " (authorized)" : " (revoked)") << endl;
+}
+
+void GroundStation::handleBackhaulPacket(Packet *packet) {
+    // An edge takes relay replies from its central only; the central takes
+    // relays and credentials from its configured edges only
+    L3Address srcAddr = packet->getTag<L3AddressInd>()->getSrcAddress();
+    auto chunk = packet->peekDataAsBytes();
+    const auto& bytes = chunk->getBytes();
+    uint8_t msgType = bytes.empty() ? 0 : bytes[0];
+    if (edgeCache != nullptr && srcAddr == centralAddr && msgType == MSG_RELAY) {
+        handleRelayReply(packet);
+    } else if (isCentral && edgeAddrs.count(srcAddr) != 0 && msgType == MSG_CREDENTIALS) {
+        applyCredentials(packet);
+    } else if (isCentral && edgeAddrs.count(srcAddr) != 0 && msgType == MSG_RELAY) {
+        if (numVerifierCores > 0) {
+            enqueueRequest(packet);
+        } else {
+            processPacket(packet);
+        }
+    } else {
+        DA_WARN << "Backhaul frame from " << srcAddr << " dropped" << endl;
+        delete packet;
     }
-    // Get verifier
-    auto it = droneVerifiers.find(droneId);
-    if (it == droneVerifiers.end()) {
-        EV_ERROR << "No verifier found for drone: " << droneId << endl;
-        sendAuthFailure(srcAddr, srcPort);
+}
+
+bool GroundStation::routeAtEdge(Packet *packet) {
+    auto chunk = packet->peekDataAsBytes();
+    const auto& bytes = chunk->getBytes();
+    if (bytes.empty()) {
+        return false;
+    }
+    if (bytes[0] == MSG_AUTH_REQUEST) {
+        if (!AuthCodec::decodeAuthRequest(bytes.data(), bytes.size(), relayDroneId, relayCommitment)) {
+            return false;  // the engine answers malformed requests
+        }
+        bool hit = edgeCache->lookup(relayDroneId, simTime().dbl())
+                && engine->hasCredentials(relayDroneId, relayCommitment);
+        emit(edgeCacheHitSignal, hit);
+        if (hit) {
+            numCacheHits++;
+            relayedHandshakes.erase(relayCommitment);
+            return false;
+        }
+        numCacheMisses++;
+        relayedHandshakes[relayCommitment] = relayDroneId;
+        relayNextCommitment.clear();
+        relayToCentral(packet, bytes, relayDroneId, relayCommitment, relayNextCommitment);
+        return true;
+    }
+    if (bytes[0] == MSG_PROOF && AuthCodec::decodeProof(bytes.data(), bytes.size(), relayProof)) {
+        // Proofs follow the request: challenged at the central, verified there
+        auto it = relayedHandshakes.find(relayProof.commitment);
+        if (it == relayedHandshakes.end()) {
+            return false;
+        }
+        relayToCentral(packet, bytes, it->second, relayProof.commitment, relayProof.nextCommitment);
+        return true;
+    }
+    return false;
+}
+
+void GroundStation::relayToCentral(Packet *packet, const std::vector<uint8_t>& bytes, const std::string& droneId,
+                                   const std::vector<uint8_t>& commitment, const std::vector<uint8_t>& nextCommitment) {
+    expireRelays();
+    uint32_t relayId = nextRelayId++;
+    PendingRelay& relay = pendingRelays[relayId];
+    relay.srcAddr = packet->getTag<L3AddressInd>()->getSrcAddress();
+    relay.srcPort = packet->getTag<L4PortInd>()->getSrcPort();
+    relay.sentAt = simTime();
+    relay.msgType = bytes[0];
+    relay.droneId = droneId;
+    relay.commitment = commitment;
+    relay.nextCommitment = nextCommitment;
+    AuthCodec::encodeRelay(relayBuffer, relayId, bytes.data(), bytes.size());
+    sendBackhaul(ByteSpan(relayBuffer));
+    delete packet;
+}
+
+void GroundStation::handleRelayReply(Packet *packet) {
+    auto chunk = packet->peekDataAsBytes();
+    const auto& bytes = chunk->getBytes();
+    uint32_t relayId;
+    const uint8_t *datagram;
+    size_t datagramLength;
+    auto it = pendingRelays.end();
+    if (AuthCodec::decodeRelay(bytes.data(), bytes.size(), relayId, datagram, datagramLength)) {
+        it = pendingRelays.find(relayId);
+    }
+    if (it == pendingRelays.end() || datagramLength == 0) {
+        DA_WARN << "Relay reply without a waiting drone" << endl;
+        delete packet;
         return;
     }
-    ZKPModule *verifier = it->second;
-    // Verify proof
-    bool isValid = verifier->verifyProof(proof);
-    auto stats = verifier->getLastProofStats();
-    EV << "Proof verification completed in " << stats.verificationTime << " ms" << endl;
-    if (isValid) {
-        numAuthSuccess++;
-        emit(authSuccessSignal, numAuthSuccess);
-        EV << "✓✓✓ Drone " << droneId << " AUTHENTICATED successfully!" << endl;
-        sendAuthSuccess(srcAddr, srcPort);
-        // Clean up
-        pendingChallenges.erase(droneId);
+    PendingRelay& relay = it->second;
+    emit(relayLatencySignal, simTime() - relay.sentAt);
+    bool success = datagram[0] == MSG_AUTH_SUCCESS;
+    if (relay.msgType == MSG_PROOF || datagram[0] == MSG_AUTH_FAILURE) {
+        relayedHandshakes.erase(relay.commitment);  // decided
+    }
+    if (relay.msgType == MSG_PROOF && success) {
+        cacheCredentials(relay.droneId, relay.commitment, relay.nextCommitment);
+    }
+    if (wakePeriod > SIMTIME_ZERO && relay.msgType == MSG_PROOF && success) {
+        sendWakeSchedule(relay.droneId, relay.srcAddr, relay.srcPort);
+    }
+    sendPacket(ByteSpan(datagram, datagramLength), relay.srcAddr, relay.srcPort);
+    pendingRelays.erase(it);
+    delete packet;
+}
+
+void GroundStation::expireRelays() {
+    // Replies lost on the backhaul; IDs grow with time, so the oldest come first
+    while (!pendingRelays.empty() && pendingRelays.begin()->second.sentAt + relayTimeout < simTime()) {
+        const PendingRelay& relay = pendingRelays.begin()->second;
+        if (relay.msgType == MSG_PROOF) {
+            relayedHandshakes.erase(relay.commitment);
+        }
+        pendingRelays.erase(pendingRelays.begin());
+    }
+}
+
+void GroundStation::cacheCredentials(const std::string& droneId, const std::vector<uint8_t>& commitment,
+                                     const std::vector<uint8_t>& nextCommitment) {
+    engine->setAuthorized(droneId, true);
+    engine->setEnrollment(droneId, commitment, &nextCommitment);
+    evictedDrones.clear();
+    edgeCache->insert(droneId, simTime().dbl(), evictedDrones);
+    for (const std::string& evicted : evictedDrones) {
+        engine->forgetDrone(evicted);
+    }
+}
+
+void GroundStation::applyCredentials(Packet *packet) {
+    // From a configured edge, on the backhaul socket
+    auto chunk = packet->peekDataAsBytes();
+    const auto& bytes = chunk->getBytes();
+    if (AuthCodec::decodeCredentials(bytes.data(), bytes.size(), relayDroneId, relayCommitment, relayNextCommitment)
+            && engine->isAuthorized(relayDroneId)) {
+        engine->setEnrollment(relayDroneId, relayCommitment, &relayNextCommitment);
+        if (replica != nullptr) {
+            recordLocalChange(relayDroneId);
+        }
     } else {
-        numAuthFailures++;
-        emit(authFailureSignal, numAuthFailures);
-        EV_ERROR << "✗✗✗ Authentication FAILED for drone " << droneId << endl;
-        sendAuthFailure(srcAddr, srcPort);
+        DA_WARN << "Credentials update rejected" << endl;
     }
+    delete packet;
 }
-void GroundStation::sendAuthSuccess(const L3Address& destAddr, int destPort) {
-    std::vector<uint8_t> msgData;
-    msgData.push_back(0x04); // AUTH_SUCCESS type
-    sendPacket(msgData, destAddr, destPort);
+
+void GroundStation::sendBackhaul(ByteSpan data) {
+    sendPacket(data, centralAddr, backhaulPort, &backhaulSocket);
+    numBackhaulBytes += data.size;
+    emit(backhaulBytesSignal, (long)data.size);
 }
-void GroundStation::sendAuthFailure(const L3Address& destAddr, int destPort) {
-    std::vector<uint8_t> msgData;
-    msgData.push_back(0x05); // AUTH_FAILURE type
-    sendPacket(msgData, destAddr, destPort);
+
+void GroundStation::shipSessionLog() {
+    sessionLog->takeFrame(logFrame);
+    const auto& payload = makeShared<BytesChunk>(logFrame.data(), logFrame.size());
+    Packet *packet = new Packet("SessionLog");
+    packet->insertAtBack(payload);
+    logSocket.sendTo(packet, standbyAddr, logPort);
+    numLogBytes += logFrame.size();
+    numLogFrames++;
+    emit(sessionLogBytesSignal, (long)logFrame.size());
+    lastLogShipped = simTime();
+}
+
+void GroundStation::handleLogShipTimer() {
+    // Records go out in one frame per interval; a quiet primary still sends heartbeats
+    if (!sessionLog->empty() || simTime() - lastLogShipped >= heartbeatInterval) {
+        shipSessionLog();
+    }
+    scheduleAfter(logShipInterval, logShipTimer);
+}
+
+void GroundStation::handleSessionLog(Packet *packet) {
+    auto chunk = packet->peekDataAsBytes();
+    const auto& bytes = chunk->getBytes();
+    // Only the primary's frames count: any other could enroll drones or put off the takeover
+    L3Address srcAddr = packet->getTag<L3AddressInd>()->getSrcAddress();
+    size_t length = bytes.size();
+    if (srcAddr != logSourceAddr || !authenticateSessionLog(bytes.data(), length, logKey, expectedLogSeq)) {
+        DA_WARN << "Session log frame from " << srcAddr << " dropped" << endl;
+        numLogRejected++;
+        delete packet;
+        return;
+    }
+    bool gap = false;
+    if (!applySessionLog(bytes.data(), length, *engine, expectedLogSeq, gap)) {
+        DA_WARN << "Malformed session log frame of " << bytes.size() << " bytes" << endl;
+    }
+    if (gap) {
+        // The sessions in the missing frames fall back to a timeout and retry
+        numLogGaps++;
+    }
+    numLogFrames++;
+    lastLogReceived = simTime();
+    cancelEvent(takeoverTimer);
+    scheduleAfter(takeoverTimeout, takeoverTimer);
+    delete packet;
+}
+
+void GroundStation::takeOver() {
+    // Drones keep sending to the primary's address, which now leads here
+    IInterfaceTable *interfaceTable = L3AddressResolver().interfaceTableOf(getContainingNode(this));
+    NetworkInterface *networkInterface = interfaceTable->findInterfaceByName(par("takeoverInterface").stringValue());
+    if (networkInterface == nullptr) {
+        throw cRuntimeError("No interface '%s' to take over %s with", par("takeoverInterface").stringValue(),
+                            primaryAddr.str().c_str());
+    }
+    networkInterface->getProtocolDataForUpdate<Ipv4InterfaceData>()->setIPAddress(primaryAddr.toIpv4());
+    tookOver = true;
+    takeoverTime = simTime();
+    logSocket.close();
+    DA_WARN << "Session log silent for " << takeoverTimeout << ", took over " << primaryAddr << endl;
 }
-void GroundStation::sendPacket(const std::vector<uint8_t>& data,
-                               const L3Address& destAddr, int destPort) {
-    const auto& payload = makeShared<BytesChunk>(data);
+
+uint32_t GroundStation::getTracePeer(const L3Address& addr, int port) {
+    auto key = std::make_pair(addr, port);
+    auto it = tracePeers.find(key);
+    if (it == tracePeers.end()) {
+        it = tracePeers.emplace(key, (uint32_t)tracePeers.size()).first;
+    }
+    return it->second;
+}
+
+void GroundStation::sendWakeSchedule(const std::string& droneId, const L3Address& destAddr, int destPort) {
+    WakeSchedule schedule = AuthCodec::scheduleWake(droneId, simTime().inUnit(SIMTIME_MS),
+                                                    wakePeriod.inUnit(SIMTIME_MS), wakeWindow.inUnit(SIMTIME_MS));
+    AuthCodec::encodeWakeSchedule(wakeBuffer, schedule);
+    sendPacket(ByteSpan(wakeBuffer), destAddr, destPort);
+    numWakeSchedules++;
+}
+
+void GroundStation::auditVerdict(const GroundStationOutput& out, ByteSpan datagram, const L3Address& srcAddr) {
+    AuditVerdict verdict;
+    switch (out.event) {
+        case GS_EVENT_PROOF_VALID: verdict = AUDIT_ACCEPTED; break;
+        case GS_EVENT_UNAUTHORIZED: verdict = AUDIT_UNAUTHORIZED; break;
+        case GS_EVENT_PROOF_INVALID: verdict = AUDIT_PROOF_INVALID; break;
+        case GS_EVENT_UNKNOWN_CHALLENGE: verdict = AUDIT_UNKNOWN_CHALLENGE; break;
+        case GS_EVENT_MALFORMED: verdict = AUDIT_MALFORMED; break;
+        default: return;  // challenges decide nothing yet
+    }
+    const uint8_t *commitment = nullptr;
+    size_t commitmentLength = 0;
+    AuthCodec::peekCommitment(datagram.data, datagram.size, commitment, commitmentLength);
+    // For relayed datagrams the peer is the edge that relayed them
+    uint32_t peer = srcAddr.getType() == L3Address::IPv4 ? srcAddr.toIpv4().getInt() : 0;
+    if (!auditLog.append(simTime().inUnit(SIMTIME_NS), peer, verdict, out.droneId, commitment, commitmentLength)) {
+        throw cRuntimeError("Cannot append to audit log '%s'", par("auditLogFile").stringValue());
+    }
+    if (auditLog.getUncommitted() >= (uint64_t)auditCommitRecords) {
+        commitAuditLog();
+    }
+}
+
+void GroundStation::commitAuditLog() {
+    if (!auditLog.commit()) {
+        DA_ERROR << "Audit log commit failed: " << strerror(errno) << endl;
+    }
+}
+
+void GroundStation::sendPacket(ByteSpan data, const L3Address& destAddr, int destPort, UdpSocket *via) {
+    // The packet changes owner on send, so it cannot come back to a pool
+    AllocScope allocScope(allocStats, ALLOC_PACKET_IO);
+    const auto& payload = makeShared<BytesChunk>(data.data, data.size);
     Packet *packet = new Packet("GroundStationData");
     packet->insertAtBack(payload);
-    socket.sendTo(packet, destAddr, destPort);
+    (via != nullptr ? via : &socket)->sendTo(packet, destAddr, destPort);
 }
 void GroundStation::handleStartOperation(LifecycleOperation *operation) {
     socket.setOutputGate(gate("socketOut"));
     socket.bind(localPort);
-    EV << "Ground Station started on port " << localPort << endl;
+    realtimeBase = std::chrono::steady_clock::now();
+    realtimeSimBase = simTime();
+    if (edgeCache != nullptr) {
+        centralAddr = L3AddressResolver().resolve(par("centralAddress").stringValue());
+    }
+    if (isCentral) {
+        edgeAddrs.clear();
+        cStringTokenizer tokenizer(par("edgeAddresses").stringValue());
+        while (tokenizer.hasMoreTokens()) {
+            edgeAddrs.insert(L3AddressResolver().resolve(tokenizer.nextToken()));
+        }
+    }
+    if (edgeCache != nullptr || isCentral) {
+        backhaulSocket.setOutputGate(gate("socketOut"));
+        backhaulSocket.bind(backhaulPort);
+    }
+    if (sessionLog != nullptr) {
+        standbyAddr = L3AddressResolver().resolve(par("standbyAddress").stringValue());
+        logSocket.setOutputGate(gate("socketOut"));
+        lastLogShipped = simTime();
+        scheduleAfter(logShipInterval, logShipTimer);
+    }
+    if (isStandby && !tookOver) {
+        // Resolved while the primary is up; its address is what the drones hold
+        primaryAddr = L3AddressResolver().resolve(par("standbyFor").stringValue());
+        logSourceAddr = L3AddressResolver().resolve(par("logSource").stringValue());
+        logSocket.setOutputGate(gate("socketOut"));
+        logSocket.bind(L3AddressResolver().addressOf(getContainingNode(this), par("logInterface").stringValue()), logPort);
+        lastLogReceived = simTime();
+        scheduleAfter(takeoverTimeout, takeoverTimer);
+    }
+    if (replica != nullptr) {
+        syncSocket.setOutputGate(gate("socketOut"));
+        syncSocket.bind(syncPort);
+        scheduleAfter(uniform(0, syncInterval.dbl()), syncTimer);  // peers out of step
+    }
+    if (churnTimer != nullptr) {
+        scheduleAfter(churnInterval, churnTimer);
+    }
+    if (auditTimer != nullptr) {
+        scheduleAfter(auditCommitInterval, auditTimer);
+    }
+    DA_INFO << "Ground Station started on port " << localPort << endl;
 }
 void GroundStation::handleStopOperation(LifecycleOperation *operation) {
+    clearRequests();
     socket.close();
+    if (edgeCache != nullptr || isCentral) {
+        backhaulSocket.close();
+    }
+    if (sessionLog != nullptr) {
+        shipSessionLog();  // an orderly stop loses nothing
+        cancelEvent(logShipTimer);
+        logSocket.close();
+    }
+    if (isStandby && !tookOver) {
+        cancelEvent(takeoverTimer);
+        logSocket.close();
+    }
+    if (replica != nullptr) {
+        cancelEvent(syncTimer);
+        syncSocket.close();
+    }
+    if (churnTimer != nullptr) {
+        cancelEvent(churnTimer);
+    }
+    if (auditTimer != nullptr) {
+        commitAuditLog();
+        cancelEvent(auditTimer);
+    }
 }
 void GroundStation::handleCrashOperation(LifecycleOperation *operation) {
+    clearRequests();
     socket.destroy();
+    if (edgeCache != nullptr || isCentral) {
+        backhaulSocket.destroy();
+    }
+    if (sessionLog != nullptr) {
+        numLogBytesLost += sessionLog->size();
+        sessionLog->clear();
+        cancelEvent(logShipTimer);
+        logSocket.destroy();
+    }
+    if (isStandby && !tookOver) {
+        cancelEvent(takeoverTimer);
+        logSocket.destroy();
+    }
+    if (replica != nullptr) {
+        cancelEvent(syncTimer);
+        syncSocket.destroy();
+    }
+    if (churnTimer != nullptr) {
+        cancelEvent(churnTimer);
+    }
+    if (auditTimer != nullptr) {
+        // Appended records sit in the page cache; only a host crash would lose them
+        cancelEvent(auditTimer);
+    }
 }
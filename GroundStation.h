@@ -11,31 +11,52 @@
 using namespace omnetpp;
 #include <vector>
 #include <map>
+#include <set>
 #include "inet/common/INETDefs.h"
 #include "inet/applications/base/ApplicationBase.h"
 #include "inet/transportlayer/contract/udp/UdpSocket.h"
 #include "inet/networklayer/common/L3Address.h"
-#include <set>
-
-// Forward declaration
-namespace droneauth {
-    class ZKPModule;
-}
+#include "inet/common/packet/Packet.h"
+#include "AllocTracker.h"
+#include "PerfTimer.h"
+#include "DroneAuthLog.h"
+#include "AirtimeMeter.h"
+#include "AuthEngine.h"
+#include "AuthTrace.h"
+#include "AuditLog.h"
+#include "AuthSync.h"
+#include "EdgeCache.h"
+#include "SessionLog.h"
+#include <chrono>
 
 class GroundStation : public inet::ApplicationBase
 {
 protected:
     // Parameters
     int localPort;
-    
-    // ZKP verifiers for each drone
-    std::map<std::string, droneauth::ZKPModule*> droneVerifiers;
-    
-    // Pending challenges
-    std::map<std::string, std::string> pendingChallenges;
-    
-    // Drone addresses for responses
-    std::map<std::string, std::pair<inet::L3Address, int>> droneAddresses;
+    bool printVerdicts;
+
+    // Verifier CPU model: numVerifierCores == 0 processes requests inline in zero time
+    int numVerifierCores;
+    int maxQueueLength;
+    bool measuredServiceTimes;
+    double serviceTimeScale;
+    omnetpp::simtime_t requestServiceTime;
+    omnetpp::simtime_t proofServiceTime;
+    omnetpp::cQueue requestQueue;
+    std::vector<omnetpp::cMessage *> serviceTimers;  // one per core, reused; scheduled = busy
+    std::vector<std::vector<inet::Packet *>> serviceBatches;  // per core, the requests in service
+    int maxBatchSize;
+    omnetpp::simtime_t batchWindow;
+    omnetpp::simtime_t batchOverheadTime;
+    omnetpp::cMessage *batchTimer;  // a partial batch's window ends
+    int numRequestsInService;
+    omnetpp::simtime_t busyTime;
+    omnetpp::simtime_t serviceStartTime;
+
+    // Protocol state machine; this module only moves its datagrams
+    droneauth::GroundStationEngine *engine;
+    droneauth::GroundStationOutput engineOutput;
     
     // Network
     inet::UdpSocket socket;
@@ -44,16 +65,134 @@ protected:
     int numAuthRequests;
     int numAuthSuccess;
     int numAuthFailures;
+    int numDroppedRequests;
+    droneauth::AllocStats allocStats;
+    droneauth::PerfRegistry perf;
+    droneauth::LogRing logRing;
+    droneauth::AirtimeMeter airtimeMeter;
+
+    // Datagram capture (traceFile); peers are numbered by first appearance
+    droneauth::TraceWriter trace;
+    std::map<std::pair<inet::L3Address, int>, uint32_t> tracePeers;
+
+    // Audit log of verdicts (auditLogFile), committed every auditCommitRecords
+    // verdicts or auditCommitInterval, whichever comes first
+    droneauth::AuditLog auditLog;
+    int auditCommitRecords;
+    omnetpp::simtime_t auditCommitInterval;
+    omnetpp::cMessage *auditTimer;
+
+    // Anti-entropy replication of authorization data with syncPeers; replica is
+    // nullptr without peers. churnTimer authorizes new drones to replicate.
+    droneauth::AuthReplica *replica;
+    inet::UdpSocket syncSocket;
+    int syncPort;
+    omnetpp::simtime_t syncInterval;
+    omnetpp::cMessage *syncTimer;
+    omnetpp::simtime_t churnInterval;
+    int churnSize;
+    int numChurned;
+    omnetpp::cMessage *churnTimer;
+    std::vector<std::vector<uint8_t>> syncOut;  // scratch
+    std::vector<std::string> syncApplied;
+    std::vector<uint8_t> syncCommitment;
+    long numSyncBytes;
+    long numSyncMessages;
+    long numReplicatedRecords;
+
+    // Tiered verification: an edge (centralAddress set) verifies the drones in
+    // edgeCache itself and relays everything else to the central verifier
+    // (edgeAddresses set). RELAY and CREDENTIALS travel on backhaulSocket only,
+    // between the central and its configured edges.
+    struct PendingRelay {
+        inet::L3Address srcAddr;
+        int srcPort;
+        omnetpp::simtime_t sentAt;
+        uint8_t msgType;
+        std::string droneId;
+        std::vector<uint8_t> commitment;
+        std::vector<uint8_t> nextCommitment;
+    };
+    droneauth::EdgeCache *edgeCache;  // nullptr unless this is an edge
+    inet::UdpSocket backhaulSocket;
+    int backhaulPort;
+    bool isCentral;
+    inet::L3Address centralAddr;
+    std::set<inet::L3Address> edgeAddrs;  // central only
+    omnetpp::simtime_t relayTimeout;
+    uint32_t nextRelayId;
+    std::map<uint32_t, PendingRelay> pendingRelays;                 // relayId -> drone awaiting the reply
+    std::map<std::vector<uint8_t>, std::string> relayedHandshakes;  // commitment -> droneId, decided centrally
+    std::vector<uint8_t> relayBuffer;
+    std::vector<std::string> evictedDrones;
+    std::string relayDroneId;                 // decode scratch
+    std::vector<uint8_t> relayCommitment;     // decode scratch
+    std::vector<uint8_t> relayNextCommitment; // decode scratch
+    droneauth::ZKProof relayProof;            // decode scratch
+    long numCacheHits;
+    long numCacheMisses;
+    long numBackhaulBytes;
+    long numCredentialUpdates;
+    long numRelayedDatagrams;  // served for edges
+
+    // Hot standby: a primary (standbyAddress set) ships its session changes to
+    // the standby; a standby (standbyFor set) applies them and takes over the
+    // primary's address once the log has been silent for takeoverTimeout
+    droneauth::SessionLogWriter *sessionLog;  // primary only
+    bool isStandby;
+    bool tookOver;
+    inet::UdpSocket logSocket;
+    int logPort;
+    inet::L3Address standbyAddr;
+    inet::L3Address primaryAddr;
+    inet::L3Address logSourceAddr;     // standby: frames from anywhere else are dropped
+    std::string logKey;                // HMAC key of the frames; empty = none
+    omnetpp::simtime_t logShipInterval;
+    omnetpp::simtime_t heartbeatInterval;
+    omnetpp::simtime_t takeoverTimeout;
+    omnetpp::simtime_t lastLogShipped;
+    omnetpp::simtime_t lastLogReceived;
+    omnetpp::simtime_t takeoverTime;
+    omnetpp::simtime_t failoverTime;   // last frame from the primary to the first success here; -1 = none yet
+    omnetpp::cMessage *logShipTimer;   // primary
+    omnetpp::cMessage *takeoverTimer;  // standby; every frame pushes it back
+    uint32_t expectedLogSeq;
+    std::vector<uint8_t> logFrame;
+    long numLogBytes;
+    long numLogFrames;
+    long numLogGaps;
+    long numLogRejected;
+    long numLogBytesLost;
+
+    // Power save: drones are told when to wake (WAKE_SCHEDULE) after each
+    // success; wakePeriod 0 = off. Windows are spread over the period by drone ID.
+    omnetpp::simtime_t wakePeriod;
+    omnetpp::simtime_t wakeWindow;
+    std::vector<uint8_t> wakeBuffer;
+    long numWakeSchedules;
+
+    // Emulation: wall clock and simulation time when the app started
+    bool recordRealtimeLag;
+    bool assertAllocFree;
+    std::chrono::steady_clock::time_point realtimeBase;
+    omnetpp::simtime_t realtimeSimBase;
     
     // Signals
     omnetpp::simsignal_t authRequestSignal;
     omnetpp::simsignal_t authSuccessSignal;
     omnetpp::simsignal_t authFailureSignal;
-
-private:
-    std::set<std::string> authorizedDrones = {
-        "DRONE_001", "DRONE_002", "DRONE_003", "DRONE_004", "DRONE_005"
-    };
+    omnetpp::simsignal_t queueingDelaySignal;
+    omnetpp::simsignal_t queueLengthSignal;
+    omnetpp::simsignal_t serviceTimeSignal;
+    omnetpp::simsignal_t requestDroppedSignal;
+    omnetpp::simsignal_t realtimeLagSignal;
+    omnetpp::simsignal_t syncBytesSignal;
+    omnetpp::simsignal_t replicationDelaySignal;
+    omnetpp::simsignal_t verifierBatchSizeSignal;
+    omnetpp::simsignal_t edgeCacheHitSignal;
+    omnetpp::simsignal_t relayLatencySignal;
+    omnetpp::simsignal_t backhaulBytesSignal;
+    omnetpp::simsignal_t sessionLogBytesSignal;
 
 protected:
     virtual int numInitStages() const override { return inet::NUM_INIT_STAGES; }
@@ -61,20 +200,61 @@ protected:
     virtual void finish() override;
     
     virtual void handleMessageWhenUp(omnetpp::cMessage *msg) override;
+    virtual void processPacket(inet::Packet *packet);
     
-    // Message handlers
-    virtual void handleAuthRequest(const std::vector<uint8_t>& data,
-                                   const inet::L3Address& srcAddr, int srcPort);
-    virtual void handleProof(const std::vector<uint8_t>& data,
-                            const inet::L3Address& srcAddr, int srcPort);
+    // Verifier CPU model
+    virtual void enqueueRequest(inet::Packet *packet);
+    virtual void startServiceIfIdle();
+    virtual void handleServiceCompletion(omnetpp::cMessage *msg);
+    virtual omnetpp::simtime_t getServiceTime(inet::Packet *packet);
+    virtual void clearRequests();
+    virtual omnetpp::cMessage *findIdleServiceTimer();
     
-    // Response messages
-    virtual void sendAuthSuccess(const inet::L3Address& destAddr, int destPort);
-    virtual void sendAuthFailure(const inet::L3Address& destAddr, int destPort);
+    // Statistics and logging for one engine result
+    virtual void recordEngineOutput(const droneauth::GroundStationOutput& out, size_t datagramSize);
     
+    // Replication
+    virtual void handleSyncRound();
+    virtual void loadFleetTable(const char *fileName);
+    virtual void handleChurn();
+    virtual void handleSyncPacket(inet::Packet *packet);
+    virtual void sendSyncMessages(const inet::L3Address& destAddr, int destPort);
+    virtual void recordLocalChange(const std::string& droneId);
+    virtual void applyReplicatedRecord(const std::string& droneId);
+
+    // Tiered verification
+    virtual void handleBackhaulPacket(inet::Packet *packet);
+    virtual bool routeAtEdge(inet::Packet *packet);
+    virtual void relayToCentral(inet::Packet *packet, const std::vector<uint8_t>& bytes, const std::string& droneId,
+                                const std::vector<uint8_t>& commitment, const std::vector<uint8_t>& nextCommitment);
+    virtual void handleRelayReply(inet::Packet *packet);
+    virtual void expireRelays();
+    virtual void cacheCredentials(const std::string& droneId, const std::vector<uint8_t>& commitment,
+                                  const std::vector<uint8_t>& nextCommitment);
+    virtual void applyCredentials(inet::Packet *packet);
+    virtual void sendBackhaul(droneauth::ByteSpan data);
+
+    // Hot standby
+    virtual void shipSessionLog();
+    virtual void handleLogShipTimer();
+    virtual void handleSessionLog(inet::Packet *packet);
+    virtual void takeOver();
+
+    // Power save
+    virtual void sendWakeSchedule(const std::string& droneId, const inet::L3Address& destAddr, int destPort);
+
+    // Trace capture
+    virtual uint32_t getTracePeer(const inet::L3Address& addr, int port);
+
+    // Audit log
+    virtual void auditVerdict(const droneauth::GroundStationOutput& out, droneauth::ByteSpan datagram,
+                              const inet::L3Address& srcAddr);
+    virtual void commitAuditLog();
+
     // Utility
-    virtual void sendPacket(const std::vector<uint8_t>& data,
-                           const inet::L3Address& destAddr, int destPort);
+    // On the drone-facing socket unless via is given
+    virtual void sendPacket(droneauth::ByteSpan data,
+                           const inet::L3Address& destAddr, int destPort, inet::UdpSocket *via = nullptr);
     
     // Lifecycle
     virtual void handleStartOperation(inet::LifecycleOperation *operation) override;
@@ -0,0 +1,300 @@
+/**
+ * GroundStationStages.cc
+ * Stages of the StagedGroundStation compound module
+ */
+#include "GroundStationStages.h"
+#include "AuthCodec.h"
+#include "StatsRecording.h"
+#include "DroneAuthLog.h"
+#include "SyntheticFleet.h"
+#include "inet/networklayer/common/L3AddressTag_m.h"
+#include "inet/transportlayer/common/L4PortTag_m.h"
+using namespace inet;
+using namespace omnetpp;
+using namespace droneauth;
+
+Define_Module(GroundStationParser);
+Define_Module(GroundStationAdmission);
+Define_Module(GroundStationVerifier);
+Define_Module(GroundStationResponder);
+
+// Jobs held by one server while it is busy
+class StageBatch : public cMessage
+{
+public:
+    std::vector<cMessage *> jobs;
+    StageBatch() : cMessage("batchDone") {}
+};
+
+// ---------------------------------------------------------------------------
+// GroundStationStage
+// ---------------------------------------------------------------------------
+
+GroundStationStage::GroundStationStage() : queue("queue") {
+}
+
+GroundStationStage::~GroundStationStage() {
+    for (cMessage *msg : batchesInService) {
+        StageBatch *batch = static_cast<StageBatch *>(msg);
+        for (cMessage *job : batch->jobs) {
+            delete job;
+        }
+        cancelAndDelete(batch);
+    }
+}
+
+void GroundStationStage::initialize(int stage) {
+    if (stage == INITSTAGE_LOCAL) {
+        numServers = par("numServers");
+        queueCapacity = par("queueCapacity");
+        batchSize = par("batchSize");
+        serviceTime = par("serviceTime").doubleValue();
+        batchOverhead = par("batchOverhead").doubleValue();
+        if (numServers < 1 || batchSize < 1) {
+            throw cRuntimeError("numServers and batchSize must be at least 1");
+        }
+        busyTime = SIMTIME_ZERO;
+        numProcessed = 0;
+        numDropped = 0;
+        queueLengthSignal = registerSignal("queueLength");
+        queueingDelaySignal = registerSignal("queueingDelay");
+        batchSizeSignal = registerSignal("batchSize");
+        droppedSignal = registerSignal("dropped");
+    }
+}
+
+void GroundStationStage::finish() {
+    recordScalar("processed", numProcessed);
+    recordScalar("dropped", numDropped);
+    recordScalar("busyTime", busyTime, "s");
+    if (simTime() > SIMTIME_ZERO) {
+        recordScalar("utilization", busyTime.dbl() / (numServers * simTime().dbl()));
+    }
+}
+
+void GroundStationStage::handleMessage(cMessage *msg) {
+    if (msg->isSelfMessage()) {
+        handleBatchDone(msg);
+    } else {
+        enqueue(msg);
+    }
+}
+
+void GroundStationStage::enqueue(cMessage *msg) {
+    if (queueCapacity >= 0 && queue.getLength() >= queueCapacity) {
+        numDropped++;
+        emit(droppedSignal, (long)numDropped);
+        delete msg;
+        return;
+    }
+    msg->setTimestamp();
+    queue.insert(msg);
+    emit(queueLengthSignal, (long)queue.getLength());
+    startServiceIfIdle();
+}
+
+void GroundStationStage::startServiceIfIdle() {
+    while ((int)batchesInService.size() < numServers && !queue.isEmpty()) {
+        StageBatch *batch = new StageBatch();
+        while ((int)batch->jobs.size() < batchSize && !queue.isEmpty()) {
+            cMessage *job = check_and_cast<cMessage *>(queue.pop());
+            emit(queueingDelaySignal, simTime() - job->getTimestamp());
+            batch->jobs.push_back(job);
+        }
+        emit(queueLengthSignal, (long)queue.getLength());
+        emit(batchSizeSignal, (long)batch->jobs.size());
+        simtime_t duration = batchOverhead + serviceTime * (double)batch->jobs.size();
+        busyTime += duration;
+        batchesInService.insert(batch);
+        scheduleAt(simTime() + duration, batch);
+    }
+}
+
+void GroundStationStage::handleBatchDone(cMessage *msg) {
+    StageBatch *batch = check_and_cast<StageBatch *>(msg);
+    batchesInService.erase(batch);
+    for (cMessage *job : batch->jobs) {
+        numProcessed++;
+        processJob(job);
+    }
+    delete batch;
+    startServiceIfIdle();
+}
+
+// ---------------------------------------------------------------------------
+// GroundStationParser
+// ---------------------------------------------------------------------------
+
+void GroundStationParser::initialize(int stage) {
+    GroundStationStage::initialize(stage);
+    if (stage == INITSTAGE_LOCAL) {
+        numAuthRequests = 0;
+        authRequestSignal = registerSignal("authRequest");
+    }
+}
+
+void GroundStationParser::finish() {
+    GroundStationStage::finish();
+    recordScalar("totalAuthRequests", numAuthRequests);
+}
+
+void GroundStationParser::processJob(cMessage *msg) {
+    Packet *packet = dynamic_cast<Packet *>(msg);
+    if (packet == nullptr) {
+        // Socket indications (e.g. close confirmations) end here
+        delete msg;
+        return;
+    }
+
+    auto chunk = packet->peekDataAsBytes();
+    const auto& bytes = chunk->getBytes();
+    if (bytes.empty()) {
+        delete packet;
+        return;
+    }
+
+    AuthJob *job = new AuthJob();
+    job->srcAddr = packet->getTag<L3AddressInd>()->getSrcAddress();
+    job->srcPort = packet->getTag<L4PortInd>()->getSrcPort();
+    job->msgType = bytes[0];
+    switch (job->msgType) {
+        case MSG_AUTH_REQUEST: {
+            numAuthRequests++;
+            emit(authRequestSignal, numAuthRequests);
+            std::vector<uint8_t> commitment;
+            job->malformed = !AuthCodec::decodeAuthRequest(bytes.data(), bytes.size(), job->droneId, commitment);
+            break;
+        }
+        case MSG_PROOF:
+            break;  // decoded and judged by the engine
+        default:
+            DA_WARN << "Unknown message type: " << (int)job->msgType << endl;
+            delete job;
+            delete packet;
+            return;
+    }
+    job->datagram = bytes;
+    delete packet;
+    send(job, "out", 0);
+}
+
+// ---------------------------------------------------------------------------
+// GroundStationAdmission
+// ---------------------------------------------------------------------------
+
+void GroundStationAdmission::initialize(int stage) {
+    GroundStationStage::initialize(stage);
+    if (stage == INITSTAGE_LOCAL) {
+        verifier = check_and_cast<GroundStationVerifier *>(getParentModule()->getSubmodule("verifier"));
+    }
+}
+
+void GroundStationAdmission::processJob(cMessage *msg) {
+    // Answers as the engine would, without taking verifier time
+    AuthJob *job = check_and_cast<AuthJob *>(msg);
+    if (job->malformed) {
+        DA_ERROR << "Malformed message from " << job->srcAddr << endl;
+        AuthCodec::encodeVerdict(job->reply, false);
+        send(job, "out", 1);
+    } else if (job->msgType == MSG_AUTH_REQUEST && !verifier->getEngine().isAuthorized(job->droneId)) {
+        DA_INFO << "✗✗✗ UNAUTHORIZED DRONE: " << job->droneId << " - Rejecting!" << endl;
+        AuthCodec::encodeVerdict(job->reply, false);
+        send(job, "out", 1);
+    } else {
+        send(job, "out", 0);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// GroundStationVerifier
+// ---------------------------------------------------------------------------
+
+GroundStationVerifier::~GroundStationVerifier() {
+    delete engine;
+}
+
+void GroundStationVerifier::initialize(int stage) {
+    GroundStationStage::initialize(stage);
+    if (stage == INITSTAGE_LOCAL) {
+        GroundStationConfig config;
+        authorizeSyntheticFleet(config, par("syntheticFleetSize").intValue());
+        engine = new GroundStationEngine(config, &perf);
+    }
+}
+
+void GroundStationVerifier::finish() {
+    GroundStationStage::finish();
+    recordPerfRegistry(this, perf, "");
+}
+
+void GroundStationVerifier::processJob(cMessage *msg) {
+    AuthJob *job = check_and_cast<AuthJob *>(msg);
+    engine->onDatagram(ByteSpan(job->datagram), engineOutput);
+    if (engineOutput.event == GS_EVENT_UNKNOWN_CHALLENGE) {
+        DA_ERROR << "Unknown challenge in proof" << endl;
+    } else if (engineOutput.event == GS_EVENT_MALFORMED) {
+        DA_ERROR << "Malformed message from " << job->srcAddr << endl;
+    }
+    job->droneId = engineOutput.droneId;
+    job->reply.assign(engineOutput.datagram.data, engineOutput.datagram.data + engineOutput.datagram.size);
+    send(job, "out", 0);
+}
+
+// ---------------------------------------------------------------------------
+// GroundStationResponder
+// ---------------------------------------------------------------------------
+
+void GroundStationResponder::initialize(int stage) {
+    GroundStationStage::initialize(stage);
+    if (stage == INITSTAGE_LOCAL) {
+        localPort = par("localPort");
+        wakePeriod = par("wakePeriod").doubleValue();
+        wakeWindow = par("wakeWindow").doubleValue();
+        if (wakePeriod > SIMTIME_ZERO && wakeWindow >= wakePeriod) {
+            throw cRuntimeError("wakeWindow must be shorter than wakePeriod");
+        }
+        numAuthSuccess = 0;
+        numAuthFailures = 0;
+        authSuccessSignal = registerSignal("authSuccess");
+        authFailureSignal = registerSignal("authFailure");
+    } else if (stage == INITSTAGE_APPLICATION_LAYER) {
+        // Indications for this socket arrive at the compound module's socketIn, i.e. at the parser
+        socket.setOutputGate(gate("socketOut"));
+        socket.bind(localPort);
+    }
+}
+
+void GroundStationResponder::finish() {
+    GroundStationStage::finish();
+    recordScalar("totalAuthSuccess", numAuthSuccess);
+    recordScalar("totalAuthFailures", numAuthFailures);
+}
+
+void GroundStationResponder::processJob(cMessage *msg) {
+    AuthJob *job = check_and_cast<AuthJob *>(msg);
+    if (job->reply.empty()) {
+        delete job;
+        return;
+    }
+    if (job->reply[0] == MSG_AUTH_SUCCESS) {
+        numAuthSuccess++;
+        emit(authSuccessSignal, numAuthSuccess);
+        if (wakePeriod > SIMTIME_ZERO) {
+            WakeSchedule schedule = AuthCodec::scheduleWake(job->droneId, simTime().inUnit(SIMTIME_MS),
+                                                            wakePeriod.inUnit(SIMTIME_MS), wakeWindow.inUnit(SIMTIME_MS));
+            AuthCodec::encodeWakeSchedule(wakeBuffer, schedule);
+            sendDatagram(wakeBuffer, job->srcAddr, job->srcPort);  // ahead of the verdict
+        }
+    } else if (job->reply[0] == MSG_AUTH_FAILURE) {
+        numAuthFailures++;
+        emit(authFailureSignal, numAuthFailures);
+    }
+    sendDatagram(job->reply, job->srcAddr, job->srcPort);
+    delete job;
+}
+
+void GroundStationResponder::sendDatagram(const std::vector<uint8_t>& data, const L3Address& destAddr, int destPort) {
+    Packet *packet = new Packet("GroundStationData");
+    packet->insertAtBack(makeShared<BytesChunk>(data));
+    socket.sendTo(packet, destAddr, destPort);
+}
@@ -0,0 +1,150 @@
+/**
+ * GroundStationStages.h
+ * Staged (SEDA-style) ground station: parser, admission, verifier and
+ * responder stages joined by bounded queues
+ */
+
+#ifndef __DRONEAUTH_GROUNDSTATIONSTAGES_H_
+#define __DRONEAUTH_GROUNDSTATIONSTAGES_H_
+
+#include <omnetpp.h>
+#include <string>
+using namespace omnetpp;
+#include <vector>
+#include <set>
+#include "inet/common/INETDefs.h"
+#include "inet/common/packet/Packet.h"
+#include "inet/networklayer/common/L3Address.h"
+#include "inet/transportlayer/contract/udp/UdpSocket.h"
+#include "AuthEngine.h"
+#include "PerfTimer.h"
+
+// One datagram travelling through the stages, plus the decisions taken on it
+class AuthJob : public omnetpp::cMessage
+{
+public:
+    // Received datagram
+    inet::L3Address srcAddr;
+    int srcPort = 0;
+    std::vector<uint8_t> datagram;
+    uint8_t msgType = 0;
+    bool malformed = false;
+    std::string droneId;               // from an AUTH_REQUEST, or the engine's verdict
+
+    // Response for the responder to send; empty = none
+    std::vector<uint8_t> reply;
+
+    explicit AuthJob(const char *name = "authJob") : cMessage(name) {}
+    virtual AuthJob *dup() const override { return new AuthJob(*this); }
+};
+
+/**
+ * Common stage: a bounded FIFO queue served by numServers servers. A server
+ * takes up to batchSize jobs at once and is busy for
+ * batchOverhead + n * serviceTime before handing them to processJob().
+ */
+class GroundStationStage : public omnetpp::cSimpleModule
+{
+protected:
+    // Parameters
+    int numServers;
+    int queueCapacity;
+    int batchSize;
+    omnetpp::simtime_t serviceTime;
+    omnetpp::simtime_t batchOverhead;
+
+    // State
+    omnetpp::cQueue queue;
+    std::set<omnetpp::cMessage *> batchesInService;
+
+    // Statistics
+    omnetpp::simtime_t busyTime;
+    int numProcessed;
+    int numDropped;
+    omnetpp::simsignal_t queueLengthSignal;
+    omnetpp::simsignal_t queueingDelaySignal;
+    omnetpp::simsignal_t batchSizeSignal;
+    omnetpp::simsignal_t droppedSignal;
+
+protected:
+    virtual int numInitStages() const override { return inet::NUM_INIT_STAGES; }
+    virtual void initialize(int stage) override;
+    virtual void finish() override;
+    virtual void handleMessage(omnetpp::cMessage *msg) override;
+
+    virtual void enqueue(omnetpp::cMessage *msg);
+    virtual void startServiceIfIdle();
+    virtual void handleBatchDone(omnetpp::cMessage *batch);
+
+    // Consumes msg: forwards it with send(), or deletes it
+    virtual void processJob(omnetpp::cMessage *msg) = 0;
+
+public:
+    GroundStationStage();
+    virtual ~GroundStationStage();
+};
+
+// Decodes UDP datagrams into AuthJobs
+class GroundStationParser : public GroundStationStage
+{
+protected:
+    omnetpp::simsignal_t authRequestSignal;
+    int numAuthRequests;
+
+    virtual void initialize(int stage) override;
+    virtual void finish() override;
+    virtual void processJob(omnetpp::cMessage *msg) override;
+};
+
+class GroundStationVerifier;
+
+// Drops malformed requests and rejects unauthorized drones (out[1] to the responder)
+class GroundStationAdmission : public GroundStationStage
+{
+protected:
+    GroundStationVerifier *verifier;  // holds the authorization data
+
+    virtual void initialize(int stage) override;
+    virtual void processJob(omnetpp::cMessage *msg) override;
+};
+
+// Issues challenges and verifies proofs through the same GroundStationEngine
+// as GroundStation, which owns all per-drone ZKP state
+class GroundStationVerifier : public GroundStationStage
+{
+protected:
+    droneauth::GroundStationEngine *engine;
+    droneauth::GroundStationOutput engineOutput;
+    droneauth::PerfRegistry perf;
+
+    virtual void initialize(int stage) override;
+    virtual void finish() override;
+    virtual void processJob(omnetpp::cMessage *msg) override;
+
+public:
+    GroundStationVerifier() : engine(nullptr) {}
+    virtual ~GroundStationVerifier();
+    const droneauth::GroundStationEngine& getEngine() const { return *engine; }
+};
+
+// Encodes responses and sends them; owns the UDP socket
+class GroundStationResponder : public GroundStationStage
+{
+protected:
+    int localPort;
+    inet::UdpSocket socket;
+    omnetpp::simtime_t wakePeriod;  // power save as in GroundStation; 0 = no schedules
+    omnetpp::simtime_t wakeWindow;
+    std::vector<uint8_t> wakeBuffer;
+    int numAuthSuccess;
+    int numAuthFailures;
+    omnetpp::simsignal_t authSuccessSignal;
+    omnetpp::simsignal_t authFailureSignal;
+
+    virtual void initialize(int stage) override;
+    virtual void finish() override;
+    virtual void processJob(omnetpp::cMessage *msg) override;
+    virtual void sendDatagram(const std::vector<uint8_t>& data, const inet::L3Address& destAddr, int destPort);
+};
+
+#endif
@@ -0,0 +1,50 @@
+/**
+ * HexCodec.h
+ * Table-driven hex encoding without allocation
+ */
+
+#ifndef HEXCODEC_H_
+#define HEXCODEC_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+namespace droneauth {
+
+// Writes 2*length lowercase hex digits to out (not NUL-terminated)
+inline void hexEncode(const uint8_t *data, size_t length, char *out) {
+    static const char digits[] = "0123456789abcdef";
+    for (size_t i = 0; i < length; i++) {
+        out[2 * i] = digits[data[i] >> 4];
+        out[2 * i + 1] = digits[data[i] & 0x0f];
+    }
+}
+
+/**
+ * Streams the hex form of the first maxBytes bytes of a buffer. Encoding
+ * happens in operator<<, i.e. only when the log line is actually emitted.
+ */
+class HexPrefix {
+public:
+    static const size_t MAX_BYTES = 32;
+
+    HexPrefix(const std::vector<uint8_t>& bytes, size_t maxBytes = 8)
+        : data(bytes.data()), length(std::min(std::min(bytes.size(), maxBytes), MAX_BYTES)) {}
+
+    friend std::ostream& operator<<(std::ostream& os, const HexPrefix& h) {
+        char buf[2 * MAX_BYTES];
+        hexEncode(h.data, h.length, buf);
+        return os.write(buf, 2 * h.length);
+    }
+
+private:
+    const uint8_t *data;
+    size_t length;
+};
+
+} // namespace droneauth
+
+#endif /* HEXCODEC_H_ */
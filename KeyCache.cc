@@ -0,0 +1,140 @@
+/**
+ * KeyCache.cc
+ */
+
+#include "KeyCache.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+#include <openssl/sha.h>
+
+namespace droneauth {
+
+static const char KEY_MAGIC[8] = { 'D', 'A', 'K', 'E', 'Y', '0', '0', '2' };
+static const size_t TAG_SIZE = 16;
+
+bool deriveDroneKey(const std::string& droneId, const std::string& password,
+                    const KdfParams& params, std::vector<uint8_t>& key) {
+    if (params.logN < 1 || params.logN > 30 || params.r < 1 || params.p < 1) {
+        return false;
+    }
+    std::string salt = "droneauth:" + droneId;
+    uint64_t n = (uint64_t)1 << params.logN;
+    // OpenSSL refuses anything above maxmem; allow exactly what the parameters need
+    uint64_t maxMemory = 128 * (uint64_t)params.r * (n + 2 + params.p) + (1 << 20);
+    key.resize(DRONE_KEY_SIZE);
+    return EVP_PBE_scrypt(password.data(), password.size(), (const unsigned char *)salt.data(), salt.size(),
+                          n, params.r, params.p, maxMemory, key.data(), key.size()) == 1;
+}
+
+void deviceSealingKey(const std::string& deviceIdentity, std::vector<uint8_t>& key) {
+    std::string input = "droneauth-device:" + deviceIdentity;
+    key.resize(SHA256_DIGEST_LENGTH);
+    SHA256((const unsigned char *)input.data(), input.size(), key.data());
+}
+
+static void fillHeader(SealedKeyHeader& header, const std::string& droneId, const KdfParams& params) {
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, KEY_MAGIC, sizeof(header.magic));
+    header.logN = params.logN;
+    header.r = params.r;
+    header.p = params.p;
+    std::strncpy(header.droneId, droneId.c_str(), sizeof(header.droneId));
+}
+
+// AES-256-GCM over the key, with the header and the password's hash as
+// authenticated data
+static bool seal(bool encrypt, const std::vector<uint8_t>& sealingKey, const SealedKeyHeader& header,
+                 const std::string& password, const uint8_t *in, uint8_t *out, uint8_t *tag) {
+    if (sealingKey.size() != 32) {
+        return false;
+    }
+    EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+    if (ctx == nullptr) {
+        return false;
+    }
+    std::string input = "droneauth-cache:" + password;
+    uint8_t passwordHash[SHA256_DIGEST_LENGTH];
+    SHA256((const unsigned char *)input.data(), input.size(), passwordHash);
+    int length = 0;
+    bool ok = EVP_CipherInit_ex(ctx, EVP_aes_256_gcm(), nullptr, sealingKey.data(), header.iv, encrypt ? 1 : 0) == 1
+            && EVP_CipherUpdate(ctx, nullptr, &length, (const uint8_t *)&header, sizeof(header)) == 1
+            && EVP_CipherUpdate(ctx, nullptr, &length, passwordHash, sizeof(passwordHash)) == 1
+            && EVP_CipherUpdate(ctx, out, &length, in, DRONE_KEY_SIZE) == 1;
+    if (ok && !encrypt) {
+        ok = EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_TAG, TAG_SIZE, tag) == 1;
+    }
+    ok = ok && EVP_CipherFinal_ex(ctx, out + length, &length) == 1;
+    if (ok && encrypt) {
+        ok = EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG, TAG_SIZE, tag) == 1;
+    }
+    EVP_CIPHER_CTX_free(ctx);
+    std::fill(input.begin(), input.end(), 0);
+    std::memset(passwordHash, 0, sizeof(passwordHash));
+    return ok;
+}
+
+bool loadSealedKey(const char *fileName, const std::vector<uint8_t>& sealingKey, const std::string& droneId,
+                   const std::string& password, const KdfParams& params, std::vector<uint8_t>& key) {
+    FILE *file = std::fopen(fileName, "rb");
+    if (file == nullptr) {
+        return false;
+    }
+    SealedKeyHeader header;
+    uint8_t ciphertext[DRONE_KEY_SIZE];
+    uint8_t tag[TAG_SIZE];
+    bool complete = std::fread(&header, sizeof(header), 1, file) == 1
+            && std::fread(ciphertext, sizeof(ciphertext), 1, file) == 1
+            && std::fread(tag, sizeof(tag), 1, file) == 1;
+    std::fclose(file);
+    if (!complete) {
+        return false;
+    }
+    // Compare against the expected header; the tag then covers the IV as well
+    SealedKeyHeader expected;
+    fillHeader(expected, droneId, params);
+    std::memcpy(expected.iv, header.iv, sizeof(expected.iv));
+    if (std::memcmp(&header, &expected, sizeof(header)) != 0) {
+        return false;
+    }
+    key.resize(DRONE_KEY_SIZE);
+    if (!seal(false, sealingKey, header, password, ciphertext, key.data(), tag)) {
+        std::fill(key.begin(), key.end(), 0);
+        key.clear();
+        return false;
+    }
+    return true;
+}
+
+bool storeSealedKey(const char *fileName, const std::vector<uint8_t>& sealingKey, const std::string& droneId,
+                    const std::string& password, const KdfParams& params, const std::vector<uint8_t>& key) {
+    if (key.size() != DRONE_KEY_SIZE) {
+        return false;
+    }
+    SealedKeyHeader header;
+    fillHeader(header, droneId, params);
+    uint8_t ciphertext[DRONE_KEY_SIZE];
+    uint8_t tag[TAG_SIZE];
+    if (RAND_bytes(header.iv, sizeof(header.iv)) != 1
+            || !seal(true, sealingKey, header, password, key.data(), ciphertext, tag)) {
+        return false;
+    }
+    std::string temporary = std::string(fileName) + ".tmp";
+    FILE *file = std::fopen(temporary.c_str(), "wb");
+    if (file == nullptr) {
+        return false;
+    }
+    bool written = std::fwrite(&header, sizeof(header), 1, file) == 1
+            && std::fwrite(ciphertext, sizeof(ciphertext), 1, file) == 1
+            && std::fwrite(tag, sizeof(tag), 1, file) == 1;
+    written = std::fclose(file) == 0 && written;
+    if (!written || std::rename(temporary.c_str(), fileName) != 0) {
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+} // namespace droneauth
@@ -0,0 +1,63 @@
+/**
+ * KeyCache.h
+ * Memory-hard derivation of a drone's password key (scrypt), and a cache
+ * holding the result sealed to the airframe so that boots skip the KDF.
+ *
+ *   file  [SealedKeyHeader] [ciphertext(32)] [tag(16)]
+ *
+ * Sealing is AES-256-GCM under a device key. The header (KDF parameters and
+ * drone ID) and a SHA-256 of the password are authenticated data; the hash
+ * is not stored. A cache written for other parameters, another drone,
+ * another device or a changed password does not open, and the key is
+ * derived again.
+ */
+
+#ifndef KEYCACHE_H_
+#define KEYCACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace droneauth {
+
+static const size_t DRONE_KEY_SIZE = 32;
+
+// scrypt cost: 128 * r * 2^logN bytes of memory, p independent lanes
+struct KdfParams {
+    uint32_t logN = 14;
+    uint32_t r = 8;
+    uint32_t p = 1;
+};
+
+struct SealedKeyHeader {
+    char magic[8];          // "DAKEY002"
+    uint32_t logN;
+    uint32_t r;
+    uint32_t p;
+    uint32_t reserved;
+    char droneId[32];       // NUL-padded
+    uint8_t iv[12];
+    uint8_t reserved2[4];
+};
+
+// scrypt(password, "droneauth:" || droneId); false if OpenSSL rejects the parameters
+bool deriveDroneKey(const std::string& droneId, const std::string& password,
+                    const KdfParams& params, std::vector<uint8_t>& key);
+
+// Sealing key of a device identity. Hardware would take it from a secure
+// element; the simulation hashes the airframe's identity.
+void deviceSealingKey(const std::string& deviceIdentity, std::vector<uint8_t>& key);
+
+// false if the file is missing, damaged or sealed for something else
+bool loadSealedKey(const char *fileName, const std::vector<uint8_t>& sealingKey, const std::string& droneId,
+                   const std::string& password, const KdfParams& params, std::vector<uint8_t>& key);
+
+// Writes a temporary file and renames it over fileName
+bool storeSealedKey(const char *fileName, const std::vector<uint8_t>& sealingKey, const std::string& droneId,
+                    const std::string& password, const KdfParams& params, const std::vector<uint8_t>& key);
+
+} // namespace droneauth
+
+#endif /* KEYCACHE_H_ */
@@ -0,0 +1,151 @@
+/**
+ * PerfTimer.cc
+ */
+
+#include "PerfTimer.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define DRONEAUTH_HAVE_TSC
+#endif
+
+namespace droneauth {
+
+static uint64_t steadyNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint64_t CycleClock::now() {
+#ifdef DRONEAUTH_HAVE_TSC
+    return __rdtsc();
+#else
+    return steadyNs();
+#endif
+}
+
+static double calibrateNsPerTick() {
+#ifdef DRONEAUTH_HAVE_TSC
+    // Spin for ~10ms and compare TSC ticks with steady_clock
+    uint64_t ns0 = steadyNs();
+    uint64_t t0 = __rdtsc();
+    uint64_t ns1 = ns0;
+    while (ns1 - ns0 < 10000000) {
+        ns1 = steadyNs();
+    }
+    uint64_t t1 = __rdtsc();
+    return t1 > t0 ? (double)(ns1 - ns0) / (double)(t1 - t0) : 1.0;
+#else
+    return 1.0;
+#endif
+}
+
+double CycleClock::nsPerTick() {
+    static const double value = calibrateNsPerTick();
+    return value;
+}
+
+LatencyHistogram::LatencyHistogram() {
+    clear();
+}
+
+void LatencyHistogram::clear() {
+    std::fill(buckets, buckets + NUM_BUCKETS, 0);
+    count = 0;
+    sumNs = 0;
+    minNs = UINT64_MAX;
+    maxNs = 0;
+    lastNs = 0;
+}
+
+int LatencyHistogram::bucketOf(uint64_t ns) {
+    if (ns < 4) {
+        return (int)ns;
+    }
+    int msb = 63 - __builtin_clzll(ns);
+    int sub = (int)((ns >> (msb - 2)) & 3);
+    return 4 * (msb - 1) + sub;
+}
+
+uint64_t LatencyHistogram::bucketLowerNs(int bucket) {
+    if (bucket < 4) {
+        return bucket;
+    }
+    int msb = bucket / 4 + 1;
+    int sub = bucket % 4;
+    if (msb >= 64) {
+        return UINT64_MAX;
+    }
+    return (uint64_t)(4 + sub) << (msb - 2);
+}
+
+void LatencyHistogram::add(uint64_t ns) {
+    buckets[bucketOf(ns)]++;
+    count++;
+    sumNs += ns;
+    minNs = std::min(minNs, ns);
+    maxNs = std::max(maxNs, ns);
+    lastNs = ns;
+}
+
+double LatencyHistogram::percentileNs(double q) const {
+    if (count == 0) {
+        return 0.0;
+    }
+    uint64_t rank = (uint64_t)(q * (count - 1)) + 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < NUM_BUCKETS; i++) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            // Midpoint of the bucket, clamped to the observed range
+            double mid = 0.5 * ((double)bucketLowerNs(i) + (double)bucketUpperNs(i));
+            return std::min(std::max(mid, (double)minNs), (double)maxNs);
+        }
+    }
+    return (double)maxNs;
+}
+
+const char *PerfRegistry::phaseName(int phase) {
+    static const char *const names[PERF_PHASE_COUNT] = {
+        "zkpInitProver",
+        "zkpCreateCommitment",
+        "zkpGenerateProof",
+        "zkpGenerateChallenge",
+        "zkpVerifyProof",
+        "gsHandleAuthRequest",
+        "gsHandleProof",
+        "droneSendPacket",
+        "keyDerive",
+        "keyUnseal",
+        "auditAppend",
+        "auditCommit",
+    };
+    if (phase < 0 || phase >= PERF_PHASE_COUNT) {
+        return "unknown";
+    }
+    return names[phase];
+}
+
+void PerfRegistry::writeSummary(std::ostream& os, const char *title) const {
+    char line[160];
+    os << "# " << title << "\n";
+    std::snprintf(line, sizeof(line), "%-22s %10s %10s %10s %10s %10s %10s\n",
+                  "phase", "count", "mean_us", "min_us", "p50_us", "p99_us", "max_us");
+    os << line;
+    for (int i = 0; i < PERF_PHASE_COUNT; i++) {
+        const LatencyHistogram& h = histograms[i];
+        if (h.getCount() == 0) {
+            continue;
+        }
+        std::snprintf(line, sizeof(line), "%-22s %10llu %10.3f %10.3f %10.3f %10.3f %10.3f\n",
+                      phaseName(i), (unsigned long long)h.getCount(),
+                      h.getMeanNs() / 1e3, h.getMinNs() / 1e3,
+                      h.percentileNs(0.50) / 1e3, h.percentileNs(0.99) / 1e3,
+                      h.getMaxNs() / 1e3);
+        os << line;
+    }
+}
+
+} // namespace droneauth
@@ -0,0 +1,111 @@
+/**
+ * PerfTimer.h
+ * Calibrated cycle-counter timers feeding log-bucketed latency histograms
+ */
+
+#ifndef PERFTIMER_H_
+#define PERFTIMER_H_
+
+#include <cstdint>
+#include <ostream>
+
+namespace droneauth {
+
+// Phases timed in the authentication hot path
+enum PerfPhase {
+    PERF_ZKP_INIT_PROVER = 0,
+    PERF_ZKP_CREATE_COMMITMENT,
+    PERF_ZKP_GENERATE_PROOF,
+    PERF_ZKP_GENERATE_CHALLENGE,
+    PERF_ZKP_VERIFY_PROOF,
+    PERF_GS_AUTH_REQUEST,
+    PERF_GS_PROOF,
+    PERF_DRONE_SEND_PACKET,
+    PERF_KEY_DERIVE,
+    PERF_KEY_UNSEAL,
+    PERF_AUDIT_APPEND,
+    PERF_AUDIT_COMMIT,
+    PERF_PHASE_COUNT
+};
+
+/**
+ * Time-stamp counter on x86 (steady_clock elsewhere). The tick length is
+ * calibrated once per process against steady_clock.
+ */
+class CycleClock {
+public:
+    static uint64_t now();
+    static double nsPerTick();
+    static uint64_t toNs(uint64_t ticks) { return (uint64_t)(ticks * nsPerTick()); }
+};
+
+/**
+ * Histogram with four linear sub-buckets per power of two of nanoseconds,
+ * so every bucket is within 25% of its lower bound.
+ */
+class LatencyHistogram {
+public:
+    static const int NUM_BUCKETS = 252;
+
+    LatencyHistogram();
+    void add(uint64_t ns);
+    void clear();
+
+    uint64_t getCount() const { return count; }
+    uint64_t getLastNs() const { return lastNs; }
+    uint64_t getMinNs() const { return count ? minNs : 0; }
+    uint64_t getMaxNs() const { return maxNs; }
+    double getMeanNs() const { return count ? (double)sumNs / count : 0.0; }
+    uint64_t getBucketCount(int bucket) const { return buckets[bucket]; }
+    double percentileNs(double q) const;
+
+    static int bucketOf(uint64_t ns);
+    static uint64_t bucketLowerNs(int bucket);
+    static uint64_t bucketUpperNs(int bucket) { return bucketLowerNs(bucket + 1); }
+
+private:
+    uint64_t buckets[NUM_BUCKETS];
+    uint64_t count;
+    uint64_t sumNs;
+    uint64_t minNs;
+    uint64_t maxNs;
+    uint64_t lastNs;
+};
+
+// One histogram per phase; owned by a module and shared with its ZKPModules
+class PerfRegistry {
+public:
+    static const char *phaseName(int phase);
+
+    LatencyHistogram& phase(PerfPhase p) { return histograms[p]; }
+    const LatencyHistogram& phase(PerfPhase p) const { return histograms[p]; }
+
+    // Plain-text table of count, mean, min, p50, p99 and max per phase
+    void writeSummary(std::ostream& os, const char *title) const;
+
+private:
+    LatencyHistogram histograms[PERF_PHASE_COUNT];
+};
+
+// Adds the lifetime of the scope to a phase histogram; no-op without a registry
+class ScopedTimer {
+public:
+    ScopedTimer(PerfRegistry *registry, PerfPhase phase)
+        : histogram(registry ? &registry->phase(phase) : nullptr),
+          start(registry ? CycleClock::now() : 0) {}
+    ~ScopedTimer() {
+        if (histogram) {
+            histogram->add(CycleClock::toNs(CycleClock::now() - start));
+        }
+    }
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    LatencyHistogram *histogram;
+    uint64_t start;
+};
+
+} // namespace droneauth
+
+#endif /* PERFTIMER_H_ */
@@ -0,0 +1,148 @@
+/**
+ * SessionLog.cc
+ */
+
+#include "SessionLog.h"
+#include <cstring>
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+
+namespace droneauth {
+
+bool SessionLogWriter::appendRecord(SessionRecordType type, const std::string& droneId,
+                                    const std::vector<const std::vector<uint8_t> *>& fields) {
+    // One-byte lengths; a drone with longer fields is not replicated
+    if (droneId.size() > 255) {
+        return false;
+    }
+    for (const std::vector<uint8_t> *field : fields) {
+        if (field->size() > 255) {
+            return false;
+        }
+    }
+    records.push_back(type);
+    records.push_back((uint8_t)droneId.size());
+    records.insert(records.end(), droneId.begin(), droneId.end());
+    for (const std::vector<uint8_t> *field : fields) {
+        records.push_back((uint8_t)field->size());
+        records.insert(records.end(), field->begin(), field->end());
+    }
+    return true;
+}
+
+void SessionLogWriter::record(const GroundStationEngine& engine, const GroundStationOutput& out) {
+    if (out.droneId.empty()) {
+        return;
+    }
+    if ((out.newDrone || out.rotated) && engine.getEnrollment(out.droneId, commitment, &nextCommitment)) {
+        appendRecord(SESSION_ENROLL, out.droneId, { &commitment, &nextCommitment });
+    }
+    if (out.event == GS_EVENT_CHALLENGE_SENT && engine.getPendingChallenge(out.droneId, challenge)) {
+        challengeBytes.assign(challenge.begin(), challenge.end());
+        appendRecord(SESSION_CHALLENGE, out.droneId, { &challengeBytes });
+    } else if (out.event == GS_EVENT_PROOF_VALID) {
+        appendRecord(SESSION_VERIFIED, out.droneId, {});
+    }
+}
+
+void SessionLogWriter::takeFrame(std::vector<uint8_t>& frame) {
+    frame.clear();
+    frame.push_back(MSG_SESSION_LOG);
+    frame.insert(frame.end(), (const uint8_t *)&nextSeq, (const uint8_t *)&nextSeq + 4);
+    frame.insert(frame.end(), records.begin(), records.end());
+    records.clear();
+    nextSeq++;
+    if (!key.empty()) {
+        size_t signedLength = frame.size();
+        frame.resize(signedLength + SESSION_LOG_MAC_BYTES);
+        HMAC(EVP_sha256(), key.data(), (int)key.size(), frame.data(), signedLength, frame.data() + signedLength, nullptr);
+    }
+}
+
+bool authenticateSessionLog(const uint8_t *data, size_t& length, const std::string& key, uint32_t expectedSeq) {
+    size_t macLength = key.empty() ? 0 : SESSION_LOG_MAC_BYTES;
+    if (length < 5 + macLength || data[0] != MSG_SESSION_LOG) {
+        return false;
+    }
+    uint32_t seq;
+    std::memcpy(&seq, data + 1, 4);
+    if (seq < expectedSeq) {
+        return false;
+    }
+    if (macLength == 0) {
+        return true;
+    }
+    size_t signedLength = length - SESSION_LOG_MAC_BYTES;
+    uint8_t mac[EVP_MAX_MD_SIZE];
+    if (HMAC(EVP_sha256(), key.data(), (int)key.size(), data, signedLength, mac, nullptr) == nullptr
+            || CRYPTO_memcmp(mac, data + signedLength, SESSION_LOG_MAC_BYTES) != 0) {
+        return false;
+    }
+    length = signedLength;
+    return true;
+}
+
+static bool readShortField(const uint8_t *data, size_t length, size_t& offset,
+                           const uint8_t *& field, size_t& fieldLength) {
+    if (offset >= length || length - offset - 1 < data[offset]) {
+        return false;
+    }
+    fieldLength = data[offset];
+    field = data + offset + 1;
+    offset += 1 + fieldLength;
+    return true;
+}
+
+bool applySessionLog(const uint8_t *data, size_t length, GroundStationEngine& engine,
+                     uint32_t& expectedSeq, bool& gap) {
+    if (length < 5 || data[0] != MSG_SESSION_LOG) {
+        return false;
+    }
+    uint32_t seq;
+    std::memcpy(&seq, data + 1, 4);
+    gap = seq != expectedSeq;
+    expectedSeq = seq + 1;
+
+    size_t offset = 5;
+    std::string droneId;
+    std::vector<uint8_t> commitment;
+    std::vector<uint8_t> nextCommitment;
+    const uint8_t *field;
+    size_t fieldLength;
+    while (offset < length) {
+        uint8_t type = data[offset++];
+        if (!readShortField(data, length, offset, field, fieldLength)) {
+            return false;
+        }
+        droneId.assign((const char *)field, fieldLength);
+        switch (type) {
+            case SESSION_ENROLL:
+                if (!readShortField(data, length, offset, field, fieldLength)) {
+                    return false;
+                }
+                commitment.assign(field, field + fieldLength);
+                if (!readShortField(data, length, offset, field, fieldLength)) {
+                    return false;
+                }
+                nextCommitment.assign(field, field + fieldLength);
+                engine.setAuthorized(droneId, true);
+                engine.setEnrollment(droneId, commitment, &nextCommitment);
+                break;
+            case SESSION_CHALLENGE:
+                if (!readShortField(data, length, offset, field, fieldLength)) {
+                    return false;
+                }
+                engine.setPendingChallenge(droneId, std::string((const char *)field, fieldLength));
+                break;
+            case SESSION_VERIFIED:
+                engine.setPendingChallenge(droneId, std::string());
+                break;
+            default:
+                return false;
+        }
+    }
+    return true;
+}
+
+} // namespace droneauth
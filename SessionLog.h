@@ -0,0 +1,89 @@
+/**
+ * SessionLog.h
+ * Session changes shipped from a primary ground station to its hot standby.
+ *
+ * The primary appends a record for every change to a drone's session and
+ * ships the records every logShipInterval; no handshake waits for the
+ * standby. A rotation ships at once, before its verdict reaches the drone. The standby applies them to its own engine. Once it has taken
+ * over the primary's address it answers outstanding challenges and later
+ * requests as the primary would have, so the fleet does not start over.
+ *
+ *   SESSION_LOG  [0x30] [seq(4)] record... ([mac(32)])
+ *   ENROLL       [0x01] [id_len(1)] [id] [commitment_len(1)] [commitment]
+ *                [next_len(1)] [next_commitment]
+ *   CHALLENGE    [0x02] [id_len(1)] [id] [challenge_len(1)] [challenge]
+ *   VERIFIED     [0x03] [id_len(1)] [id]
+ *
+ * A frame without records is a heartbeat. Records not yet shipped at a crash
+ * are lost, and their drones time out and retry. A rotation record is lost
+ * only if its frame is: the drone then fails with the new credentials at the
+ * standby and switches back to the old ones (AuthEngine.h).
+ *
+ * The standby drops frames with an old sequence number. With a key shared
+ * by primary and standby every frame also ends in an HMAC-SHA256 over the
+ * bytes before it, and frames with a bad MAC are dropped too, so forged and
+ * replayed frames neither change its engine nor put off the takeover.
+ */
+
+#ifndef SESSIONLOG_H_
+#define SESSIONLOG_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "AuthEngine.h"
+
+namespace droneauth {
+
+static const uint8_t MSG_SESSION_LOG = 0x30;
+static const size_t SESSION_LOG_FRAME_BYTES = 1400;  // ship at once beyond this, without waiting
+static const size_t SESSION_LOG_MAC_BYTES = 32;
+
+enum SessionRecordType : uint8_t {
+    SESSION_ENROLL = 0x01,
+    SESSION_CHALLENGE = 0x02,
+    SESSION_VERIFIED = 0x03,
+};
+
+class SessionLogWriter {
+public:
+    // Appends the session changes behind one engine result
+    void record(const GroundStationEngine& engine, const GroundStationOutput& out);
+    // Replaces frame with the pending records under the next sequence number
+    void takeFrame(std::vector<uint8_t>& frame);
+    // Drops the pending records (crash)
+    void clear() { records.clear(); }
+    // Frames carry a MAC under key from now on; empty = none
+    void setKey(const std::string& key) { this->key = key; }
+
+    size_t size() const { return records.size(); }
+    bool empty() const { return records.empty(); }
+
+private:
+    bool appendRecord(SessionRecordType type, const std::string& droneId,
+                      const std::vector<const std::vector<uint8_t> *>& fields);
+
+    std::vector<uint8_t> records;
+    uint32_t nextSeq = 0;
+    std::string key;
+    std::vector<uint8_t> commitment;      // scratch
+    std::vector<uint8_t> nextCommitment;  // scratch
+    std::string challenge;                // scratch
+    std::vector<uint8_t> challengeBytes;  // scratch
+};
+
+// Checks a frame against expectedSeq and, unless key is empty, its MAC under
+// key, which it drops from length; false if the frame is older than
+// expectedSeq (replayed) or the MAC is wrong
+bool authenticateSessionLog(const uint8_t *data, size_t& length, const std::string& key, uint32_t expectedSeq);
+
+// Applies a frame to the standby's engine. gap is set when frames before it
+// were lost; false if the frame is malformed (records before the fault stay
+// applied).
+bool applySessionLog(const uint8_t *data, size_t length, GroundStationEngine& engine,
+                     uint32_t& expectedSeq, bool& gap);
+
+} // namespace droneauth
+
+#endif /* SESSIONLOG_H_ */
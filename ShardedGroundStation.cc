@@ -0,0 +1,144 @@
+/**
+ * ShardedGroundStation.cc
+ */
+
+#include "ShardedGroundStation.h"
+#include <cstring>
+
+namespace droneauth {
+
+// Inbound slots a worker takes from one producer before looking at the next
+static const int WORKER_BATCH = 32;
+
+ShardedGroundStation::ShardedGroundStation(const GroundStationConfig& config, int numWorkers,
+                                           int numProducers, size_t ringCapacity)
+    : routes(numProducers), numProducers(numProducers) {
+    for (int w = 0; w < numWorkers; w++) {
+        Worker *worker = new Worker(config);
+        for (int p = 0; p < numProducers; p++) {
+            worker->inbound.emplace_back(new SpscRing<ShardMessage>(ringCapacity));
+            worker->outbound.emplace_back(new SpscRing<ShardMessage>(ringCapacity));
+        }
+        workers.emplace_back(worker);
+    }
+}
+
+ShardedGroundStation::~ShardedGroundStation() {
+    stop();
+}
+
+void ShardedGroundStation::start() {
+    if (running.exchange(true)) {
+        return;
+    }
+    for (auto& worker : workers) {
+        Worker *w = worker.get();
+        w->thread = std::thread([this, w] { runWorker(*w); });
+    }
+}
+
+void ShardedGroundStation::stop() {
+    if (!running.exchange(false)) {
+        return;
+    }
+    for (auto& worker : workers) {
+        worker->thread.join();
+    }
+}
+
+static uint64_t hashBytes(const uint8_t *data, size_t length) {
+    uint64_t hash = 14695981039346656037ULL;  // FNV-1a
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ data[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+int ShardedGroundStation::route(int producer, const uint8_t *data, size_t length) {
+    const uint8_t *commitment;
+    size_t commitmentLength;
+    if (!AuthCodec::peekCommitment(data, length, commitment, commitmentLength)) {
+        return 0;  // malformed: any shard can reject it
+    }
+    Routes& r = routes[producer];
+    uint64_t commitmentHash = hashBytes(commitment, commitmentLength);
+    const uint8_t *droneId;
+    size_t droneIdLength;
+    if (AuthCodec::peekDroneId(data, length, droneId, droneIdLength)) {
+        int shard = (int)(hashBytes(droneId, droneIdLength) % workers.size());
+        // A rotated drone requests with its new commitment; forget the old one
+        uint64_t& current = r.commitmentOf[hashBytes(droneId, droneIdLength)];
+        if (current != commitmentHash) {
+            r.shardOf.erase(current);
+            current = commitmentHash;
+            r.shardOf[commitmentHash] = shard;
+        }
+        return shard;
+    }
+    // A PROOF without a request seen here: its shard rejects it as unknown
+    auto it = r.shardOf.find(commitmentHash);
+    return it != r.shardOf.end() ? it->second : (int)(commitmentHash % workers.size());
+}
+
+bool ShardedGroundStation::submit(int producer, const uint8_t *data, size_t length, uint64_t peer) {
+    if (length > ShardMessage::MAX_DATAGRAM) {
+        return false;
+    }
+    SpscRing<ShardMessage>& ring = *workers[route(producer, data, length)]->inbound[producer];
+    ShardMessage *slot = ring.beginPush();
+    if (slot == nullptr) {
+        return false;
+    }
+    slot->peer = peer;
+    slot->length = length;
+    std::memcpy(slot->data, data, length);
+    ring.commitPush();
+    return true;
+}
+
+uint64_t ShardedGroundStation::getProcessed() const {
+    uint64_t total = 0;
+    for (auto& worker : workers) {
+        total += worker->processed.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+void ShardedGroundStation::runWorker(Worker& worker) {
+    int idleRounds = 0;
+    while (running.load(std::memory_order_relaxed)) {
+        bool busy = false;
+        for (int p = 0; p < numProducers; p++) {
+            SpscRing<ShardMessage>& in = *worker.inbound[p];
+            SpscRing<ShardMessage>& out = *worker.outbound[p];
+            for (int n = 0; n < WORKER_BATCH; n++) {
+                // Leave the request queued while the producer has not drained its replies
+                ShardMessage *reply = out.beginPush();
+                if (reply == nullptr) {
+                    break;
+                }
+                ShardMessage *request = in.front();
+                if (request == nullptr) {
+                    break;
+                }
+                worker.engine.onDatagram(ByteSpan(request->data, request->length), worker.output);
+                if (!worker.output.datagram.empty()) {
+                    reply->peer = request->peer;
+                    reply->length = worker.output.datagram.size;
+                    std::memcpy(reply->data, worker.output.datagram.data, reply->length);
+                    out.commitPush();
+                }
+                in.commitPop();
+                busy = true;
+                worker.processed.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        if (busy) {
+            idleRounds = 0;
+        } else if (++idleRounds > 64) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+} // namespace droneauth
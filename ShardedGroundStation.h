@@ -0,0 +1,107 @@
+/**
+ * ShardedGroundStation.h
+ * Multi-threaded ground station: drone sessions are partitioned over worker
+ * threads, each owning a GroundStationEngine for its shard, so session state
+ * is never shared or locked. I/O threads ("producers") hand datagrams to
+ * workers and collect replies over single-producer/single-consumer rings,
+ * one ring per (producer, worker) pair and direction.
+ *
+ * The shard key is the drone ID, which stays fixed when the drone rotates its
+ * credentials. PROOF does not carry it, so each producer remembers the shard
+ * of every commitment it saw in an AUTH_REQUEST and sends the PROOF there; a
+ * drone's datagrams must therefore all go through one producer.
+ */
+
+#ifndef SHARDEDGROUNDSTATION_H_
+#define SHARDEDGROUNDSTATION_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "AuthEngine.h"
+#include "SpscRing.h"
+
+namespace droneauth {
+
+// One datagram in a ring slot; peer is an opaque return address chosen by the producer
+struct ShardMessage {
+    static const size_t MAX_DATAGRAM = 512;
+    uint64_t peer;
+    uint32_t length;
+    uint8_t data[MAX_DATAGRAM];
+};
+
+class ShardedGroundStation {
+public:
+    ShardedGroundStation(const GroundStationConfig& config, int numWorkers, int numProducers = 1,
+                         size_t ringCapacity = 1024);
+    ~ShardedGroundStation();
+
+    void start();
+    void stop();
+
+    // Called from producer thread `producer` only. False if the datagram is
+    // too large or the shard's ring is full (drop, or poll and retry).
+    bool submit(int producer, const uint8_t *data, size_t length, uint64_t peer);
+
+    // Producer `producer` calls handle(const ShardMessage&) for each reply
+    // waiting for it, up to max; returns the number handled
+    template <typename Handler>
+    size_t poll(int producer, Handler&& handle, size_t max = 64);
+
+    int getNumWorkers() const { return (int)workers.size(); }
+    uint64_t getProcessed() const;
+
+private:
+    struct Worker {
+        GroundStationEngine engine;
+        GroundStationOutput output;
+        std::vector<std::unique_ptr<SpscRing<ShardMessage>>> inbound;   // per producer
+        std::vector<std::unique_ptr<SpscRing<ShardMessage>>> outbound;  // per producer
+        std::atomic<uint64_t> processed{0};
+        std::thread thread;
+
+        explicit Worker(const GroundStationConfig& config) : engine(config) {}
+    };
+
+    // Touched by its producer thread only; keys are FNV-1a hashes, so a
+    // lookup does not allocate
+    struct Routes {
+        std::unordered_map<uint64_t, uint64_t> commitmentOf;  // drone ID -> current commitment
+        std::unordered_map<uint64_t, int> shardOf;            // commitment -> shard
+    };
+
+    int route(int producer, const uint8_t *data, size_t length);
+    void runWorker(Worker& worker);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<Routes> routes;       // per producer
+    int numProducers;
+    std::atomic<bool> running{false};
+};
+
+template <typename Handler>
+size_t ShardedGroundStation::poll(int producer, Handler&& handle, size_t max) {
+    size_t handled = 0;
+    for (auto& worker : workers) {
+        SpscRing<ShardMessage>& ring = *worker->outbound[producer];
+        while (handled < max) {
+            ShardMessage *reply = ring.front();
+            if (reply == nullptr) {
+                break;
+            }
+            handle(*reply);
+            ring.commitPop();
+            handled++;
+        }
+    }
+    return handled;
+}
+
+} // namespace droneauth
+
+#endif /* SHARDEDGROUNDSTATION_H_ */
@@ -0,0 +1,76 @@
+/**
+ * SpscRing.h
+ * Bounded single-producer/single-consumer ring with lock-free handoff.
+ * Exactly one thread may push and exactly one other thread may pop.
+ */
+
+#ifndef SPSCRING_H_
+#define SPSCRING_H_
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace droneauth {
+
+template <typename T>
+class SpscRing {
+public:
+    // capacity is rounded up to a power of two
+    explicit SpscRing(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        slots.resize(size);
+        mask = size - 1;
+    }
+
+    size_t capacity() const { return slots.size(); }
+
+    // Producer: the slot to fill, or nullptr if the ring is full; publish with commitPush()
+    T *beginPush() {
+        size_t tail = tailIndex.load(std::memory_order_relaxed);
+        if (tail - cachedHead == slots.size()) {
+            cachedHead = headIndex.load(std::memory_order_acquire);
+            if (tail - cachedHead == slots.size()) {
+                return nullptr;
+            }
+        }
+        return &slots[tail & mask];
+    }
+
+    void commitPush() {
+        tailIndex.store(tailIndex.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Consumer: the oldest slot, or nullptr if the ring is empty; release with commitPop()
+    T *front() {
+        size_t head = headIndex.load(std::memory_order_relaxed);
+        if (head == cachedTail) {
+            cachedTail = tailIndex.load(std::memory_order_acquire);
+            if (head == cachedTail) {
+                return nullptr;
+            }
+        }
+        return &slots[head & mask];
+    }
+
+    void commitPop() {
+        headIndex.store(headIndex.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+private:
+    std::vector<T> slots;
+    size_t mask;
+
+    // Producer and consumer indices on separate cache lines, each with a private copy of the other
+    alignas(64) std::atomic<size_t> tailIndex{0};
+    size_t cachedHead = 0;
+    alignas(64) std::atomic<size_t> headIndex{0};
+    size_t cachedTail = 0;
+};
+
+} // namespace droneauth
+
+#endif /* SPSCRING_H_ */
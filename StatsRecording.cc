@@ -0,0 +1,96 @@
+/**
+ * StatsRecording.cc
+ */
+
+#include "StatsRecording.h"
+#include <fstream>
+#include <string>
+
+using namespace omnetpp;
+
+namespace droneauth {
+
+void recordAllocStats(cComponent *component, const AllocStats& stats) {
+    if (!AllocTracker::enabled()) {
+        return;
+    }
+    for (int i = 0; i < ALLOC_PHASE_COUNT; i++) {
+        const AllocCounters& counters = stats.phases[i];
+        if (counters.scopes == 0) {
+            continue;
+        }
+        std::string prefix = std::string("alloc.") + AllocTracker::phaseName(i);
+        component->recordScalar((prefix + ".scopes").c_str(), counters.scopes);
+        component->recordScalar((prefix + ".count").c_str(), counters.count);
+        component->recordScalar((prefix + ".bytes").c_str(), counters.bytes);
+        if (counters.steadyScopes > 0) {
+            component->recordScalar((prefix + ".steadyScopes").c_str(), counters.steadyScopes);
+            component->recordScalar((prefix + ".steadyCount").c_str(), counters.steadyCount);
+        }
+    }
+}
+
+void checkAllocFree(cComponent *component, const AllocStats& stats) {
+    if (!AllocTracker::enabled()) {
+        return;
+    }
+    for (int i = 0; i < ALLOC_PHASE_COUNT; i++) {
+        const AllocCounters& counters = stats.phases[i];
+        if (counters.steadyCount > 0) {
+            throw cRuntimeError("%s: %llu heap allocations in %llu steady-state %s handlers",
+                                component->getFullPath().c_str(), (unsigned long long)counters.steadyCount,
+                                (unsigned long long)counters.steadyScopes, AllocTracker::phaseName(i));
+        }
+    }
+}
+
+void recordAirtimeUsage(cComponent *component, const AirtimeUsage& usage, int numAuthSuccess) {
+    component->recordScalar("authAirtime", usage.airtime, "s");
+    component->recordScalar("authBytesOnAir", usage.bytes, "B");
+    component->recordScalar("authFramesOnAir", usage.frames);
+    component->recordScalar("authMacRetries", usage.retries);
+    component->recordScalar("authAcksSent", usage.acks);
+    if (numAuthSuccess > 0) {
+        component->recordScalar("airtimePerSuccessfulAuth", usage.airtime / numAuthSuccess, "s");
+        component->recordScalar("bytesOnAirPerSuccessfulAuth", (double)usage.bytes / numAuthSuccess, "B");
+    }
+}
+
+void recordPerfRegistry(cComponent *component, const PerfRegistry& perf,
+                        const char *summaryFile) {
+    for (int i = 0; i < PERF_PHASE_COUNT; i++) {
+        const LatencyHistogram& h = perf.phase((PerfPhase)i);
+        if (h.getCount() == 0) {
+            continue;
+        }
+
+        // Rebuild the log buckets as histogram bins between the first and last used bucket
+        int first = LatencyHistogram::bucketOf(h.getMinNs());
+        int last = LatencyHistogram::bucketOf(h.getMaxNs());
+        std::vector<double> edges;
+        for (int b = first; b <= last + 1; b++) {
+            edges.push_back(LatencyHistogram::bucketLowerNs(b) * 1e-9);
+        }
+
+        std::string name = std::string("perf.") + PerfRegistry::phaseName(i);
+        cHistogram histogram(name.c_str(), true);
+        histogram.setBinEdges(edges);
+        for (int b = first; b <= last; b++) {
+            uint64_t n = h.getBucketCount(b);
+            if (n > 0) {
+                histogram.collectWeighted(0.5 * (edges[b - first] + edges[b - first + 1]), (double)n);
+            }
+        }
+        component->recordStatistic(&histogram, "s");
+    }
+
+    if (summaryFile != nullptr && *summaryFile != '\0') {
+        std::ofstream out(summaryFile, std::ios::app);
+        if (!out) {
+            throw cRuntimeError("Cannot open perf summary file '%s'", summaryFile);
+        }
+        perf.writeSummary(out, component->getFullPath().c_str());
+    }
+}
+
+} // namespace droneauth
@@ -0,0 +1,38 @@
+/**
+ * StatsRecording.h
+ * Result recording helpers shared by the drone and ground station apps
+ */
+
+#ifndef __DRONEAUTH_STATSRECORDING_H_
+#define __DRONEAUTH_STATSRECORDING_H_
+
+#include <omnetpp.h>
+#include "AllocTracker.h"
+#include "PerfTimer.h"
+#include "AirtimeMeter.h"
+
+namespace droneauth {
+
+// alloc.<phase>.{scopes,count,bytes,steadyScopes,steadyCount} scalars; nothing unless built with ALLOC_TRACKING
+void recordAllocStats(omnetpp::cComponent *component, const AllocStats& stats);
+
+// Throws cRuntimeError if any steady-state scope allocated; no-op unless built with ALLOC_TRACKING
+void checkAllocFree(omnetpp::cComponent *component, const AllocStats& stats);
+
+/**
+ * authAirtime/authBytesOnAir/authFramesOnAir/authMacRetries/authAcksSent totals
+ * and their ratios per successful authentication.
+ */
+void recordAirtimeUsage(omnetpp::cComponent *component, const AirtimeUsage& usage, int numAuthSuccess);
+
+/**
+ * Records every non-empty phase histogram as an OMNeT++ histogram named
+ * perf.<phase> (in seconds) and, if summaryFile is not empty, appends a
+ * plain-text summary of the registry to that file.
+ */
+void recordPerfRegistry(omnetpp::cComponent *component, const PerfRegistry& perf,
+                        const char *summaryFile);
+
+} // namespace droneauth
+
+#endif
@@ -0,0 +1,32 @@
+/**
+ * SyntheticFleet.h
+ * Synthetic drone IDs, authorized by syntheticFleetSize and used by the
+ * standalone benchmarks and load generators
+ */
+
+#ifndef SYNTHETICFLEET_H_
+#define SYNTHETICFLEET_H_
+
+#include <cstdio>
+#include <string>
+#include "AuthEngine.h"
+
+namespace droneauth {
+
+// "DRONE_00001" ... for index 0 ...
+inline std::string syntheticDroneId(int index) {
+    char id[32];
+    std::snprintf(id, sizeof(id), "DRONE_%05d", index + 1);
+    return id;
+}
+
+// Authorizes the first numDrones synthetic IDs in addition to the configured ones
+inline void authorizeSyntheticFleet(GroundStationConfig& config, int numDrones) {
+    for (int i = 0; i < numDrones; i++) {
+        config.authorizedDrones.insert(syntheticDroneId(i));
+    }
+}
+
+} // namespace droneauth
+
+#endif /* SYNTHETICFLEET_H_ */
@@ -3,8 +3,8 @@
  */
 
 #include "ZKPModule.h"
-#include <sstream>
-#include <iomanip>
+#include "HexCodec.h"
+#include <cstdio>
 #include <cstring>
 #include <chrono>
 #include <stdexcept>
@@ -25,39 +25,18 @@ std::vector<uint8_t> ZKProof::serialize() const {
     result.insert(result.end(), (uint8_t*)&chalLen, (uint8_t*)&chalLen + 4);
     result.insert(result.end(), challenge.begin(), challenge.end());
     
+    if (!nextCommitment.empty()) {
+        uint32_t nextSize = nextCommitment.size();
+        result.insert(result.end(), (uint8_t*)&nextSize, (uint8_t*)&nextSize + 4);
+        result.insert(result.end(), nextCommitment.begin(), nextCommitment.end());
+    }
+    
     result.insert(result.end(), (uint8_t*)&timestamp, (uint8_t*)&timestamp + 8);
     return result;
 }
 
-ZKProof ZKProof::deserialize(const std::vector<uint8_t>& data) {
-    ZKProof proof;
-    size_t offset = 0;
-    
-    uint32_t proofSize;
-    std::memcpy(&proofSize, &data[offset], 4);
-    offset += 4;
-    proof.proofData.assign(data.begin() + offset, data.begin() + offset + proofSize);
-    offset += proofSize;
-    
-    uint32_t commitSize;
-    std::memcpy(&commitSize, &data[offset], 4);
-    offset += 4;
-    proof.commitment.assign(data.begin() + offset, data.begin() + offset + commitSize);
-    offset += commitSize;
-    
-    uint32_t chalLen;
-    std::memcpy(&chalLen, &data[offset], 4);
-    offset += 4;
-    proof.challenge.assign(data.begin() + offset, data.begin() + offset + chalLen);
-    offset += chalLen;
-    
-    std::memcpy(&proof.timestamp, &data[offset], 8);
-    return proof;
-}
-
 ZKPModule::ZKPModule() 
-    : proverInitialized(false), verifierInitialized(false), keysGenerated(false) {
-    lastStats = ProofStats{0, 0, 0.0, 0.0};
+    : perf(nullptr), proverInitialized(false), verifierInitialized(false), keysGenerated(false) {
 }
 
 ZKPModule::ZKPModule(const std::string& id) : ZKPModule() {
@@ -99,10 +78,14 @@ void ZKPModule::generateKeys() {
 }
 
 void ZKPModule::initializeProver(const std::string& id, const std::string& password) {
+    initializeProver(id, password, generateRandomBytes(32));
+}
+
+void ZKPModule::initializeProver(const std::string& id, const std::string& password, const std::vector<uint8_t>& nonce) {
+    ScopedTimer timer(perf, PERF_ZKP_INIT_PROVER);
     droneId = id;
     std::vector<uint8_t> idBytes(id.begin(), id.end());
     std::vector<uint8_t> pwBytes(password.begin(), password.end());
-    std::vector<uint8_t> nonce = generateRandomBytes(32);
     
     std::vector<uint8_t> combined = combineVectors({idBytes, pwBytes, nonce});
     privateSecret = sha256Hash(combined);
@@ -110,7 +93,20 @@ void ZKPModule::initializeProver(const std::string& id, const std::string& passw
     proverInitialized = true;
 }
 
+void ZKPModule::initializeProverFromKey(const std::string& id, const std::vector<uint8_t>& passwordKey) {
+    ScopedTimer timer(perf, PERF_ZKP_INIT_PROVER);
+    droneId = id;
+    std::vector<uint8_t> idBytes(id.begin(), id.end());
+    std::vector<uint8_t> nonce = generateRandomBytes(32);
+
+    std::vector<uint8_t> combined = combineVectors({idBytes, passwordKey, nonce});
+    privateSecret = sha256Hash(combined);
+    sessionNonce = nonce;
+    proverInitialized = true;
+}
+
 void ZKPModule::createCommitment() {
+    ScopedTimer timer(perf, PERF_ZKP_CREATE_COMMITMENT);
     if (!proverInitialized) {
         throw std::runtime_error("Prover not initialized");
     }
@@ -119,27 +115,31 @@ void ZKPModule::createCommitment() {
 }
 
 ZKProof ZKPModule::generateProof(const std::string& challenge) {
-    auto startTime = std::chrono::high_resolution_clock::now();
+    ZKProof proof;
+    generateProof(challenge, proof);
+    return proof;
+}
+
+void ZKPModule::generateProof(const std::string& challenge, ZKProof& proof) {
+    ScopedTimer timer(perf, PERF_ZKP_GENERATE_PROOF);
     
     if (!proverInitialized) {
         throw std::runtime_error("Prover not initialized");
     }
     
-    ZKProof proof;
-    proof.challenge = challenge;
-    proof.commitment = publicCommitment;
+    proof.challenge.assign(challenge);
+    proof.commitment.assign(publicCommitment.begin(), publicCommitment.end());
     proof.timestamp = std::chrono::system_clock::now().time_since_epoch().count();
     
-    std::vector<uint8_t> challengeBytes(challenge.begin(), challenge.end());
-    std::vector<uint8_t> proofInput = combineVectors({privateSecret, challengeBytes, sessionNonce});
-    proof.proofData = sha256Hash(proofInput);
-    
-    auto endTime = std::chrono::high_resolution_clock::now();
-    lastStats.generationTime = std::chrono::duration<double, std::milli>(endTime - startTime).count();
-    lastStats.proofSize = proof.proofData.size();
-    lastStats.commitmentSize = proof.commitment.size();
-    
-    return proof;
+    // privateSecret || challenge || sessionNonce || nextCommitment. The mock
+    // verifier cannot recompute this, so the ground station does not trust the
+    // announcement until the new credentials pass a handshake (AuthEngine.h)
+    proofInput.assign(privateSecret.begin(), privateSecret.end());
+    proofInput.insert(proofInput.end(), challenge.begin(), challenge.end());
+    proofInput.insert(proofInput.end(), sessionNonce.begin(), sessionNonce.end());
+    proofInput.insert(proofInput.end(), proof.nextCommitment.begin(), proof.nextCommitment.end());
+    proof.proofData.resize(SHA256_DIGEST_LENGTH);
+    SHA256(proofInput.data(), proofInput.size(), proof.proofData.data());
 }
 
 std::vector<uint8_t> ZKPModule::getCommitment() const {
@@ -153,19 +153,28 @@ void ZKPModule::initializeVerifier(const std::vector<uint8_t>& commitment, const
 }
 
 std::string ZKPModule::generateChallenge() {
+    std::string challenge;
+    generateChallenge(challenge);
+    return challenge;
+}
+
+void ZKPModule::generateChallenge(std::string& challenge) {
+    ScopedTimer timer(perf, PERF_ZKP_GENERATE_CHALLENGE);
     auto now = std::chrono::system_clock::now().time_since_epoch().count();
-    auto randomBytes = generateRandomBytes(16);
+    uint8_t randomBytes[8];
+    RAND_bytes(randomBytes, sizeof(randomBytes));
     
-    std::stringstream ss;
-    ss << "CHALLENGE_" << now << "_";
-    ss << bytesToHex(randomBytes).substr(0, 16);
+    // "CHALLENGE_<now>_<16 hex digits>"
+    char buf[64];
+    int len = std::snprintf(buf, sizeof(buf) - 16, "CHALLENGE_%lld_", (long long)now);
+    hexEncode(randomBytes, sizeof(randomBytes), buf + len);
     
-    lastChallenge = ss.str();
-    return lastChallenge;
+    lastChallenge.assign(buf, len + 16);
+    challenge.assign(buf, len + 16);
 }
 
 bool ZKPModule::verifyProof(const ZKProof& proof) {
-    auto startTime = std::chrono::high_resolution_clock::now();
+    ScopedTimer timer(perf, PERF_ZKP_VERIFY_PROOF);
     
     if (!verifierInitialized) {
         throw std::runtime_error("Verifier not initialized");
@@ -185,9 +194,6 @@ bool ZKPModule::verifyProof(const ZKProof& proof) {
         return false;
     }
     
-    auto endTime = std::chrono::high_resolution_clock::now();
-    lastStats.verificationTime = std::chrono::duration<double, std::milli>(endTime - startTime).count();
-    
     return true;
 }
 
@@ -205,16 +211,9 @@ void ZKPModule::reset() {
 }
 
 std::string ZKPModule::bytesToHex(const std::vector<uint8_t>& bytes) {
-    std::stringstream ss;
-    ss << std::hex << std::setfill('0');
-    for (uint8_t b : bytes) {
-        ss << std::setw(2) << (int)b;
-    }
-    return ss.str();
-}
-
-ZKPModule::ProofStats ZKPModule::getLastProofStats() const {
-    return lastStats;
+    std::string hex(2 * bytes.size(), '0');
+    hexEncode(bytes.data(), bytes.size(), &hex[0]);
+    return hex;
 }
 
 } // namespace droneauth
@@ -12,6 +12,7 @@
 #include <memory>
 #include <openssl/sha.h>
 #include <openssl/rand.h>
+#include "PerfTimer.h"
 
 namespace droneauth {
 
@@ -19,11 +20,11 @@ struct ZKProof {
     std::vector<uint8_t> proofData;
     std::vector<uint8_t> commitment;
     std::string challenge;
+    std::vector<uint8_t> nextCommitment;  // credentials the drone rotates to; empty = none announced
     uint64_t timestamp;
     
     ZKProof() : timestamp(0) {}
     std::vector<uint8_t> serialize() const;
-    static ZKProof deserialize(const std::vector<uint8_t>& data);
 };
 
 class ZKPModule {
@@ -47,12 +48,24 @@ public:
     void setup();
     void generateKeys();
     void initializeProver(const std::string& id, const std::string& password = "");
+    // Same, from a provisioned nonce (FleetTable.h) instead of a fresh one
+    void initializeProver(const std::string& id, const std::string& password, const std::vector<uint8_t>& nonce);
+    // Same, from a memory-hard password key (KeyCache.h) instead of the password
+    void initializeProverFromKey(const std::string& id, const std::vector<uint8_t>& passwordKey);
     void createCommitment();
     ZKProof generateProof(const std::string& challenge);
+    // Same, into proof's existing storage: no allocation once its buffers have grown.
+    // Binds the proof.nextCommitment already set by the caller.
+    void generateProof(const std::string& challenge, ZKProof& proof);
     std::vector<uint8_t> getCommitment() const;
+    // Bytes hashed by generateProof for a challenge (drives the compute-cost model)
+    size_t getProofInputSize(const std::string& challenge, size_t nextCommitmentSize = 0) const {
+        return privateSecret.size() + challenge.size() + sessionNonce.size() + nextCommitmentSize;
+    }
     
     void initializeVerifier(const std::vector<uint8_t>& commitment, const std::string& droneId);
     std::string generateChallenge();
+    void generateChallenge(std::string& challenge);
     bool verifyProof(const ZKProof& proof);
     
     bool isProverInitialized() const;
@@ -62,20 +75,16 @@ public:
     
     static std::string bytesToHex(const std::vector<uint8_t>& bytes);
     
-    struct ProofStats {
-        size_t proofSize;
-        size_t commitmentSize;
-        double generationTime;
-        double verificationTime;
-    };
-    ProofStats getLastProofStats() const;
+    // Operation timings go to the owner's registry (may be nullptr)
+    void setPerfRegistry(PerfRegistry *registry) { perf = registry; }
 
 private:
-    ProofStats lastStats;
+    PerfRegistry *perf;
     bool proverInitialized;
     bool verifierInitialized;
     bool keysGenerated;
     std::string lastChallenge;
+    std::vector<uint8_t> proofInput;  // generateProof scratch
 };
 
 } // namespace droneauth
@@ -0,0 +1,201 @@
+/**
+ * audit_bench.cc
+ * Appends verdicts to an AuditLog at a fixed rate with group commits, then
+ * reports what the log costs per verdict and checks the chain.
+ *
+ *   ./audit_bench PATH [--rate 50000] [--seconds 5] [--group 256]
+ *                      [--interval-ms 10] [--segment 1048576]
+ *
+ *   --rate         verdicts per second, paced in 1 ms ticks
+ *   --group        commit once this many verdicts are pending
+ *   --interval-ms  and at least this often
+ *   --segment      records per segment file (PATH.0, PATH.1, ...)
+ *
+ * PATH must not hold a log yet. After the run the log is reopened, one
+ * more verdict is appended to check that it continues the chain, and every
+ * segment is verified against the last chain hash. Finally one byte of the
+ * first record in the last segment is changed, and the log must refuse to
+ * reopen.
+ */
+
+#include "AuditLog.h"
+#include "SyntheticFleet.h"
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/stat.h>
+#include <time.h>
+
+using namespace droneauth;
+
+typedef std::chrono::steady_clock Clock;
+
+// msync waits for the device; this thread's CPU time excludes the wait
+static double threadCpuSeconds() {
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void printPhase(const char *label, const LatencyHistogram& h) {
+    std::printf("%-8s %9llu  mean %7.0f ns  p50 %7.0f ns  p99 %8.0f ns  max %9llu ns\n", label,
+                (unsigned long long)h.getCount(), h.getMeanNs(), h.percentileNs(0.50), h.percentileNs(0.99),
+                (unsigned long long)h.getMaxNs());
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2 || argv[1][0] == '-') {
+        std::fprintf(stderr, "usage: %s PATH [--rate N] [--seconds N] [--group N] [--interval-ms N] [--segment N]\n",
+                     argv[0]);
+        return 1;
+    }
+    std::string path = argv[1];
+    double rate = 50000;
+    double seconds = 5;
+    long group = 256;
+    double intervalMs = 10;
+    long long segmentRecords = 1048576;
+    for (int i = 2; i + 1 < argc; i += 2) {
+        const char *option = argv[i];
+        const char *value = argv[i + 1];
+        if (std::strcmp(option, "--rate") == 0) {
+            rate = std::atof(value);
+        } else if (std::strcmp(option, "--seconds") == 0) {
+            seconds = std::atof(value);
+        } else if (std::strcmp(option, "--group") == 0) {
+            group = std::atol(value);
+        } else if (std::strcmp(option, "--interval-ms") == 0) {
+            intervalMs = std::atof(value);
+        } else if (std::strcmp(option, "--segment") == 0) {
+            segmentRecords = std::atoll(value);
+        } else {
+            std::fprintf(stderr, "unknown option %s (see the header of audit_bench.cc)\n", option);
+            return 1;
+        }
+    }
+    if (rate <= 0 || seconds <= 0 || group < 1 || intervalMs <= 0 || segmentRecords < 1) {
+        std::fprintf(stderr, "invalid arguments\n");
+        return 1;
+    }
+    struct stat st;
+    if (::stat((path + ".0").c_str(), &st) == 0) {
+        std::fprintf(stderr, "%s.0 exists; the bench needs a fresh log\n", path.c_str());
+        return 1;
+    }
+
+    PerfRegistry perf;
+    AuditLog log;
+    std::string error;
+    if (!log.open(path.c_str(), segmentRecords, error, &perf)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    // Verdicts cycle through a small fleet; one in 16 is a rejection
+    const int numDrones = 1000;
+    std::vector<std::string> ids;
+    for (int i = 0; i < numDrones; i++) {
+        ids.push_back(syntheticDroneId(i));
+    }
+    uint8_t commitment[32];
+    std::memset(commitment, 0xa5, sizeof(commitment));
+
+    uint64_t total = (uint64_t)(rate * seconds);
+    uint64_t appended = 0;
+    Clock::duration interval = std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double, std::milli>(intervalMs));
+    Clock::time_point start = Clock::now();
+    Clock::time_point lastCommit = start;
+    double cpuStart = threadCpuSeconds();
+    while (appended < total) {
+        Clock::time_point now = Clock::now();
+        uint64_t due = std::min<uint64_t>(total, std::chrono::duration<double>(now - start).count() * rate);
+        for (; appended < due; appended++) {
+            std::memcpy(commitment, &appended, sizeof(appended));
+            AuditVerdict verdict = appended % 16 == 15 ? AUDIT_PROOF_INVALID : AUDIT_ACCEPTED;
+            uint64_t timeNs = std::chrono::duration_cast<std::chrono::nanoseconds>(now - start).count();
+            if (!log.append(timeNs, 0x0a000001 + appended % 250, verdict, ids[appended % numDrones],
+                            commitment, sizeof(commitment))) {
+                std::fprintf(stderr, "append failed after %llu records\n", (unsigned long long)appended);
+                return 1;
+            }
+            if (log.getUncommitted() >= (uint64_t)group) {
+                log.commit();
+                lastCommit = Clock::now();
+            }
+        }
+        if (log.getUncommitted() > 0 && Clock::now() - lastCommit >= interval) {
+            log.commit();
+            lastCommit = Clock::now();
+        }
+        std::this_thread::sleep_until(now + std::chrono::milliseconds(1));
+    }
+    log.commit();
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    double cpuNs = (threadCpuSeconds() - cpuStart) * 1e9 / appended;
+
+    const LatencyHistogram& appendTime = perf.phase(PERF_AUDIT_APPEND);
+    const LatencyHistogram& commitTime = perf.phase(PERF_AUDIT_COMMIT);
+    double perVerdictNs = (appendTime.getMeanNs() * appendTime.getCount()
+            + commitTime.getMeanNs() * commitTime.getCount()) / appended;
+    std::printf("%llu verdicts in %.2f s (%.0f/s), %llu commits (%.1f verdicts each), %.1f MB\n",
+                (unsigned long long)appended, elapsed, appended / elapsed,
+                (unsigned long long)log.getNumCommits(), (double)appended / log.getNumCommits(),
+                appended * sizeof(AuditRecord) / 1e6);
+    printPhase("append", appendTime);
+    printPhase("commit", commitTime);
+    std::printf("wall per verdict: %.0f ns (append %.0f + commit share %.0f), %.2f%% of the thread at %.0f/s\n",
+                perVerdictNs, appendTime.getMeanNs(), perVerdictNs - appendTime.getMeanNs(),
+                perVerdictNs * rate / 1e7, rate);
+    std::printf("CPU per verdict: %.0f ns including the pacing loop, %.2f%% of one core\n",
+                cpuNs, cpuNs * rate / 1e7);
+    log.close();
+
+    // Reopen: the next record must continue the chain
+    if (!log.open(path.c_str(), segmentRecords, error) || log.getNumRecords() != appended
+            || !log.append(0, 0, AUDIT_ACCEPTED, ids[0], nullptr, 0)) {
+        std::fprintf(stderr, "reopen did not continue the log: %s\n", error.c_str());
+        return 1;
+    }
+    uint8_t lastHash[AUDIT_HASH_SIZE];
+    std::memcpy(lastHash, log.getLastHash(), sizeof(lastHash));
+    log.close();
+    uint64_t verified = 0;
+    Clock::time_point verifyStart = Clock::now();
+    if (!verifyAuditLog(path.c_str(), verified, error, lastHash)) {
+        std::fprintf(stderr, "verification failed: %s\n", error.c_str());
+        return 1;
+    }
+    double verifySeconds = std::chrono::duration<double>(Clock::now() - verifyStart).count();
+    std::printf("verified %llu records in %.2f s (%.0f records/s)\n", (unsigned long long)verified,
+                verifySeconds, verified / verifySeconds);
+    if (verified != appended + 1) {
+        return 1;
+    }
+
+    // A committed record altered on disk: reopening must not clear it and what follows
+    int last = 0;
+    while (::stat((path + "." + std::to_string(last + 1)).c_str(), &st) == 0) {
+        last++;
+    }
+    FILE *segment = std::fopen((path + "." + std::to_string(last)).c_str(), "r+b");
+    if (segment == nullptr || std::fseek(segment, sizeof(AuditHeader) + offsetof(AuditRecord, timeNs), SEEK_SET) != 0) {
+        std::fprintf(stderr, "cannot open the last segment\n");
+        return 1;
+    }
+    int byte = std::fgetc(segment);
+    std::fseek(segment, -1, SEEK_CUR);
+    std::fputc(byte ^ 1, segment);
+    std::fclose(segment);
+    if (log.open(path.c_str(), segmentRecords, error)) {
+        std::fprintf(stderr, "reopen accepted an altered record\n");
+        return 1;
+    }
+    std::printf("altered record refused: %s\n", error.c_str());
+    return 0;
+}
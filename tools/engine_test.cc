@@ -0,0 +1,174 @@
+/**
+ * engine_test.cc
+ * Protocol checks on DroneEngine and GroundStationEngine, in memory and
+ * without OMNeT++/INET. Exits non-zero on the first failed check.
+ *
+ *   ./engine_test        (or make -C tools check)
+ */
+
+#include "AuthEngine.h"
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace droneauth;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            std::exit(1); \
+        } \
+    } while (0)
+
+// Applied to a PROOF on its way to the ground station
+typedef void (*ProofFilter)(std::vector<uint8_t>& datagram);
+
+// Rewrites the next commitment a PROOF announces, as an on-path relay could
+static void tamperAnnouncement(std::vector<uint8_t>& datagram) {
+    ZKProof proof;
+    CHECK(AuthCodec::decodeProof(datagram.data(), datagram.size(), proof));
+    CHECK(!proof.nextCommitment.empty());
+    proof.nextCommitment.assign(proof.nextCommitment.size(), 0xA5);
+    AuthCodec::encodeProof(datagram, proof);
+}
+
+// One handshake; returns the drone's verdict event
+static DroneEvent handshake(DroneEngine& drone, GroundStationEngine& gs, GroundStationOutput& gsOut,
+                            ProofFilter filter = nullptr) {
+    DroneOutput out;
+    drone.onTimer(DRONE_TIMER_REQUEST, out);
+    gs.onDatagram(out.datagram, gsOut);
+    drone.onDatagram(gsOut.datagram, out);
+    if (out.event != DRONE_EVENT_CHALLENGE) {
+        return out.event;
+    }
+    drone.onTimer(DRONE_TIMER_PROOF, out);
+    std::vector<uint8_t> datagram(out.datagram.data, out.datagram.data + out.datagram.size);
+    if (filter != nullptr) {
+        filter(datagram);
+    }
+    gs.onDatagram(ByteSpan(datagram), gsOut);
+    drone.onDatagram(gsOut.datagram, out);
+    if (out.timers[DRONE_TIMER_PREPARE].op == TimerRequest::ARM) {
+        DroneOutput prepared;
+        drone.onTimer(DRONE_TIMER_PREPARE, prepared);
+    }
+    return out.event;
+}
+
+static void testTamperedAnnouncement() {
+    DroneConfig config;
+    config.droneId = "DRONE_001";
+    config.password = "secure";
+    config.rotationInterval = 30;
+    DroneEngine drone(config);
+    GroundStationEngine gs;
+    GroundStationOutput gsOut;
+    std::vector<uint8_t> original = drone.getProver().getCommitment();
+    std::vector<uint8_t> enrolled;
+    std::vector<uint8_t> next;
+
+    // Enrolls; the success prepares the standby credentials
+    CHECK(handshake(drone, gs, gsOut) == DRONE_EVENT_SUCCESS);
+    std::vector<uint8_t> announced = drone.getNextCommitment();
+    CHECK(!announced.empty());
+
+    // The announcement is altered on the way: the drone switches, the ground
+    // station stores the forged commitment but keeps the original valid
+    CHECK(handshake(drone, gs, gsOut, tamperAnnouncement) == DRONE_EVENT_SUCCESS);
+    CHECK(drone.getProver().getCommitment() == announced);
+    CHECK(gs.getEnrollment(config.droneId, enrolled, &next));
+    CHECK(enrolled == original);
+    CHECK(next != announced);
+
+    // The forged commitment is never promoted: the new credentials are refused
+    CHECK(handshake(drone, gs, gsOut) == DRONE_EVENT_FAILURE);
+    CHECK(gsOut.event == GS_EVENT_UNKNOWN_CHALLENGE);
+    CHECK(gs.getEnrollment(config.droneId, enrolled, &next));
+    CHECK(enrolled == original);
+
+    // The drone is back on the original credentials and announces again
+    CHECK(drone.getProver().getCommitment() == original);
+    CHECK(drone.getNextCommitment() == announced);
+    CHECK(handshake(drone, gs, gsOut) == DRONE_EVENT_SUCCESS);
+    CHECK(gs.getEnrollment(config.droneId, enrolled, &next));
+    CHECK(enrolled == original);
+    CHECK(next == announced);
+
+    // The first handshake with the new credentials retires the original ones
+    CHECK(handshake(drone, gs, gsOut) == DRONE_EVENT_SUCCESS);
+    CHECK(gs.getEnrollment(config.droneId, enrolled, &next));
+    CHECK(enrolled == announced);
+    CHECK(!gs.hasCredentials(config.droneId, original));
+}
+
+static void testAnnouncementCannotTakeOverAnotherDrone() {
+    DroneConfig victimConfig;
+    victimConfig.droneId = "DRONE_002";
+    victimConfig.password = "secure";
+    DroneEngine victim(victimConfig);
+    DroneConfig config;
+    config.droneId = "DRONE_003";
+    config.password = "secure";
+    config.rotationInterval = 30;
+    DroneEngine drone(config);
+    GroundStationEngine gs;
+    GroundStationOutput gsOut;
+    CHECK(handshake(victim, gs, gsOut) == DRONE_EVENT_SUCCESS);
+    CHECK(handshake(drone, gs, gsOut) == DRONE_EVENT_SUCCESS);
+
+    // DRONE_003 announces DRONE_002's commitment: ignored
+    static std::vector<uint8_t> victimCommitment;
+    victimCommitment = victim.getProver().getCommitment();
+    CHECK(handshake(drone, gs, gsOut, [](std::vector<uint8_t>& datagram) {
+        ZKProof proof;
+        CHECK(AuthCodec::decodeProof(datagram.data(), datagram.size(), proof));
+        proof.nextCommitment = victimCommitment;
+        AuthCodec::encodeProof(datagram, proof);
+    }) == DRONE_EVENT_SUCCESS);
+    std::vector<uint8_t> enrolled;
+    std::vector<uint8_t> next;
+    CHECK(gs.getEnrollment(config.droneId, enrolled, &next));
+    CHECK(next != victimCommitment);
+    CHECK(gs.hasCredentials(victimConfig.droneId, victimCommitment));
+}
+
+static void testProvisionedCredentials() {
+    // Derived as tools/fleet_provision writes them (FleetTable.h)
+    DroneConfig config;
+    config.droneId = "DRONE_00001";
+    config.password = "0123456789abcdef0123456789abcdef";
+    config.provisionedNonce.assign(32, 0x5c);
+    std::string input = config.droneId + config.password
+            + std::string(config.provisionedNonce.begin(), config.provisionedNonce.end());
+    uint8_t secret[SHA256_DIGEST_LENGTH];
+    SHA256((const uint8_t *)input.data(), input.size(), secret);
+    input.assign((const char *)secret, sizeof(secret));
+    input.append(config.provisionedNonce.begin(), config.provisionedNonce.end());
+    std::vector<uint8_t> provisioned(SHA256_DIGEST_LENGTH);
+    SHA256((const uint8_t *)input.data(), input.size(), provisioned.data());
+
+    DroneEngine drone(config);
+    CHECK(drone.getProver().getCommitment() == provisioned);
+    GroundStationEngine gs;
+    GroundStationOutput gsOut;
+    gs.setAuthorized(config.droneId, true);
+    gs.setEnrollment(config.droneId, provisioned);
+    CHECK(handshake(drone, gs, gsOut) == DRONE_EVENT_SUCCESS);
+    CHECK(!gsOut.newDrone);
+
+    // Without the nonce the same ID and password give other credentials, which are refused
+    config.provisionedNonce.clear();
+    DroneEngine impostor(config);
+    CHECK(handshake(impostor, gs, gsOut) == DRONE_EVENT_FAILURE);
+}
+
+int main() {
+    testTamperedAnnouncement();
+    testAnnouncementCannotTakeOverAnotherDrone();
+    testProvisionedCredentials();
+    std::printf("engine_test: all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,287 @@
+/**
+ * fleet_provision.cc
+ * Offline provisioning of a drone fleet: per-drone passwords, secrets and
+ * commitments plus the ground stations' authorization indexes, written as
+ * binary tables (FleetTable.h) straight into memory-mapped output files.
+ *
+ *   ./fleet_provision NAME [--drones 1000000] [--threads N] [--first 0]
+ *
+ *   NAME.drones   per-drone credentials (keep secret; DroneAuthApp fleetTable)
+ *   NAME.auth     IDs and commitments with ID and commitment indexes
+ *                 (GroundStation fleetTable)
+ *
+ *   --threads  worker threads, default one per core
+ *   --first    index of the first drone; IDs follow SyntheticFleet.h
+ *              ("DRONE_00001" for index 0)
+ *
+ * Workers claim batches of drones. Each batch draws its random bytes in one
+ * call and hashes from one contiguous input buffer. The indexes are filled
+ * in a second parallel pass with compare-and-swap on the slots.
+ *
+ * A drone loaded from NAME.drones boots from the stored nonce, so its
+ * commitment is the one NAME.auth enrolls at the ground stations. The
+ * tables hash the password itself, not the scrypt password key
+ * (KeyCache.h).
+ */
+
+#include "FleetTable.h"
+#include "HexCodec.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <openssl/rand.h>
+#include <openssl/sha.h>
+
+using namespace droneauth;
+
+typedef std::chrono::steady_clock Clock;
+
+static const uint64_t BATCH = 1024;
+static const size_t PASSWORD_BYTES = FLEET_PASSWORD_SIZE / 2;
+
+// A file of the given size mapped read-write; the mapping outlives the descriptor
+struct MappedOutput {
+    uint8_t *base = nullptr;
+    size_t size = 0;
+
+    bool create(const std::string& fileName, size_t bytes) {
+        int fd = ::open(fileName.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+        if (fd < 0) {
+            std::fprintf(stderr, "cannot create %s: %s\n", fileName.c_str(), std::strerror(errno));
+            return false;
+        }
+        if (ftruncate(fd, bytes) != 0) {
+            std::fprintf(stderr, "cannot size %s: %s\n", fileName.c_str(), std::strerror(errno));
+            ::close(fd);
+            return false;
+        }
+        void *mapping = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (mapping == MAP_FAILED) {
+            std::fprintf(stderr, "cannot map %s: %s\n", fileName.c_str(), std::strerror(errno));
+            return false;
+        }
+        base = (uint8_t *)mapping;
+        size = bytes;
+        return true;
+    }
+
+    void close() {
+        if (base != nullptr) {
+            munmap(base, size);
+            base = nullptr;
+        }
+    }
+};
+
+struct Provisioner {
+    uint64_t numDrones;
+    uint64_t first;
+    uint64_t indexSlots;
+    DroneSecret *secrets;
+    AuthRecord *records;
+    uint32_t *idIndex;
+    uint32_t *commitmentIndex;
+    std::atomic<uint64_t> nextBatch{0};
+    std::atomic<bool> randomFailed{false};
+
+    void generate();
+    void index();
+};
+
+void Provisioner::generate() {
+    // Batch layout: password bytes and nonces for all drones from one RAND_bytes call
+    std::vector<uint8_t> random(BATCH * (PASSWORD_BYTES + FLEET_HASH_SIZE));
+    uint8_t input[FLEET_ID_SIZE + FLEET_PASSWORD_SIZE + FLEET_HASH_SIZE];
+    for (;;) {
+        uint64_t begin = nextBatch.fetch_add(BATCH, std::memory_order_relaxed);
+        if (begin >= numDrones) {
+            return;
+        }
+        uint64_t end = std::min(begin + BATCH, numDrones);
+        if (RAND_bytes(random.data(), (end - begin) * (PASSWORD_BYTES + FLEET_HASH_SIZE)) != 1) {
+            randomFailed = true;
+            return;
+        }
+        for (uint64_t i = begin; i < end; i++) {
+            const uint8_t *drawn = random.data() + (i - begin) * (PASSWORD_BYTES + FLEET_HASH_SIZE);
+            DroneSecret& secret = secrets[i];
+            AuthRecord& record = records[i];
+            std::memset(secret.droneId, 0, FLEET_ID_SIZE);
+            int idLength = std::snprintf(secret.droneId, FLEET_ID_SIZE, "DRONE_%05llu",
+                                         (unsigned long long)(first + i + 1));
+            hexEncode(drawn, PASSWORD_BYTES, secret.password);
+            std::memcpy(secret.nonce, drawn + PASSWORD_BYTES, FLEET_HASH_SIZE);
+
+            // secret = SHA256(id || password || nonce)
+            size_t length = 0;
+            std::memcpy(input, secret.droneId, idLength);
+            length += idLength;
+            std::memcpy(input + length, secret.password, FLEET_PASSWORD_SIZE);
+            length += FLEET_PASSWORD_SIZE;
+            std::memcpy(input + length, secret.nonce, FLEET_HASH_SIZE);
+            length += FLEET_HASH_SIZE;
+            SHA256(input, length, secret.secret);
+
+            // commitment = SHA256(secret || nonce)
+            std::memcpy(input, secret.secret, FLEET_HASH_SIZE);
+            std::memcpy(input + FLEET_HASH_SIZE, secret.nonce, FLEET_HASH_SIZE);
+            SHA256(input, 2 * FLEET_HASH_SIZE, record.commitment);
+            std::memcpy(record.droneId, secret.droneId, FLEET_ID_SIZE);
+        }
+    }
+}
+
+static void insertSlot(uint32_t *slots, uint64_t numSlots, uint64_t hash, uint32_t value) {
+    for (uint64_t i = hash;; i++) {
+        uint32_t expected = 0;
+        if (__atomic_compare_exchange_n(&slots[i & (numSlots - 1)], &expected, value, false,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            return;
+        }
+    }
+}
+
+void Provisioner::index() {
+    for (;;) {
+        uint64_t begin = nextBatch.fetch_add(BATCH, std::memory_order_relaxed);
+        if (begin >= numDrones) {
+            return;
+        }
+        uint64_t end = std::min(begin + BATCH, numDrones);
+        for (uint64_t i = begin; i < end; i++) {
+            const AuthRecord& record = records[i];
+            uint64_t idHash = fleetHash((const uint8_t *)record.droneId, fleetIdLength(record.droneId));
+            insertSlot(idIndex, indexSlots, idHash, i + 1);
+            insertSlot(commitmentIndex, indexSlots, fleetHash(record.commitment, FLEET_HASH_SIZE), i + 1);
+        }
+    }
+}
+
+template <typename F>
+static double runParallel(int numThreads, F work) {
+    Clock::time_point start = Clock::now();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < numThreads; t++) {
+        threads.emplace_back(work);
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static void writeHeader(uint8_t *base, const char *magic, uint64_t numDrones) {
+    FleetHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, magic, sizeof(header.magic));
+    header.version = FLEET_VERSION;
+    header.headerSize = sizeof(FleetHeader);
+    header.numDrones = numDrones;
+    std::memcpy(base, &header, sizeof(header));
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2 || argv[1][0] == '-') {
+        std::fprintf(stderr, "usage: %s NAME [--drones N] [--threads N] [--first N]\n", argv[0]);
+        return 1;
+    }
+    std::string name = argv[1];
+    long long numDrones = 1000000;
+    long long first = 0;
+    int numThreads = std::max(1u, std::thread::hardware_concurrency());
+    for (int i = 2; i + 1 < argc; i += 2) {
+        const char *option = argv[i];
+        const char *value = argv[i + 1];
+        if (std::strcmp(option, "--drones") == 0) {
+            numDrones = std::atoll(value);
+        } else if (std::strcmp(option, "--threads") == 0) {
+            numThreads = std::atoi(value);
+        } else if (std::strcmp(option, "--first") == 0) {
+            first = std::atoll(value);
+        } else {
+            std::fprintf(stderr, "unknown option %s (see the header of fleet_provision.cc)\n", option);
+            return 1;
+        }
+    }
+    // IDs must fit FLEET_ID_SIZE and record numbers the uint32 index slots
+    if (numDrones < 1 || numDrones >= (1LL << 31) || first < 0 || first + numDrones > 999999999LL
+            || numThreads < 1) {
+        std::fprintf(stderr, "invalid arguments\n");
+        return 1;
+    }
+
+    Provisioner p;
+    p.numDrones = numDrones;
+    p.first = first;
+    p.indexSlots = 1;
+    while (p.indexSlots < 2 * p.numDrones) {
+        p.indexSlots <<= 1;
+    }
+
+    MappedOutput dronesFile;
+    MappedOutput authFile;
+    size_t indexBytes = p.indexSlots * sizeof(uint32_t);
+    size_t recordsEnd = sizeof(FleetHeader) + p.numDrones * sizeof(AuthRecord);
+    size_t idIndexOffset = (recordsEnd + 63) & ~(size_t)63;
+    size_t commitmentIndexOffset = idIndexOffset + indexBytes;
+    if (!dronesFile.create(name + ".drones", sizeof(FleetHeader) + p.numDrones * sizeof(DroneSecret))
+            || !authFile.create(name + ".auth", commitmentIndexOffset + indexBytes)) {
+        return 1;
+    }
+    // Fresh pages from ftruncate read as zero, so the index slots start empty
+    writeHeader(dronesFile.base, FLEET_DRONES_MAGIC, p.numDrones);
+    writeHeader(authFile.base, FLEET_AUTH_MAGIC, p.numDrones);
+    FleetHeader *authHeader = (FleetHeader *)authFile.base;
+    authHeader->indexSlots = p.indexSlots;
+    authHeader->idIndexOffset = idIndexOffset;
+    authHeader->commitmentIndexOffset = commitmentIndexOffset;
+    p.secrets = (DroneSecret *)(dronesFile.base + sizeof(FleetHeader));
+    p.records = (AuthRecord *)(authFile.base + sizeof(FleetHeader));
+    p.idIndex = (uint32_t *)(authFile.base + idIndexOffset);
+    p.commitmentIndex = (uint32_t *)(authFile.base + commitmentIndexOffset);
+
+    std::printf("provisioning %lld drones with %d threads into %s.drones and %s.auth\n",
+                numDrones, numThreads, name.c_str(), name.c_str());
+    double generateSeconds = runParallel(numThreads, [&p]() { p.generate(); });
+    if (p.randomFailed) {
+        std::fprintf(stderr, "RAND_bytes failed\n");
+        return 1;
+    }
+    p.nextBatch = 0;
+    double indexSeconds = runParallel(numThreads, [&p]() { p.index(); });
+    dronesFile.close();
+    authFile.close();
+
+    double total = generateSeconds + indexSeconds;
+    std::printf("credentials: %.2f s, %.0f drones/s, %.0f drones/s per core\n", generateSeconds,
+                numDrones / generateSeconds, numDrones / generateSeconds / numThreads);
+    std::printf("indexes:     %.2f s, %.0f drones/s, %.0f drones/s per core\n", indexSeconds,
+                numDrones / indexSeconds, numDrones / indexSeconds / numThreads);
+    std::printf("total:       %.2f s, %.0f drones/s, %.0f drones/s per core\n", total,
+                numDrones / total, numDrones / total / numThreads);
+
+    // Spot-check the written table through the reader
+    FleetAuthTable table;
+    std::string error;
+    if (!table.open((name + ".auth").c_str(), error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    uint64_t step = std::max<uint64_t>(1, p.numDrones / 1000);
+    for (uint64_t i = 0; i < p.numDrones; i += step) {
+        const AuthRecord& record = table.getRecord(i);
+        if (table.findDrone(record.droneId, fleetIdLength(record.droneId)) != &record
+                || table.findCommitment(record.commitment) != &record) {
+            std::fprintf(stderr, "index lookup failed for %.*s\n", (int)FLEET_ID_SIZE, record.droneId);
+            return 1;
+        }
+    }
+    return 0;
+}
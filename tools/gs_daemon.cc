@@ -0,0 +1,204 @@
+/**
+ * gs_daemon.cc
+ * Ground station on a real UDP socket (Linux). Runs GroundStationEngine and
+ * moves up to --batch datagrams per syscall with recvmmsg/sendmmsg; requests
+ * are parsed in place from a receive ring that is set up once and reused.
+ * --batch 1 uses plain recvfrom/sendto as the one-datagram-per-syscall
+ * baseline.
+ *
+ *   ./gs_daemon [--port 5000] [--batch 64] [--fleet N] [--duration S]
+ *
+ * --fleet N authorizes the synthetic drones of gs_loadgen in addition to the
+ * default list. Prints packets/s once per second and totals at exit.
+ */
+
+#include "AuthEngine.h"
+#include "SyntheticFleet.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace droneauth;
+
+static const int MAX_BATCH = 64;
+static const size_t MAX_DATAGRAM = 2048;
+
+static volatile sig_atomic_t stopRequested = 0;
+
+static void onSignal(int) {
+    stopRequested = 1;
+}
+
+// Receive and send slots, allocated once; iovecs point into the buffers
+struct DatagramRing {
+    uint8_t buffers[MAX_BATCH][MAX_DATAGRAM];
+    sockaddr_in addrs[MAX_BATCH];
+    iovec iov[MAX_BATCH];
+    mmsghdr msgs[MAX_BATCH];
+
+    // Points slot i at its buffer and address; length is the buffer size or the payload to send
+    void prepare(int i, size_t length) {
+        iov[i].iov_base = buffers[i];
+        iov[i].iov_len = length;
+        std::memset(&msgs[i].msg_hdr, 0, sizeof(msghdr));
+        msgs[i].msg_hdr.msg_name = &addrs[i];
+        msgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+};
+
+struct DaemonStats {
+    unsigned long rxPackets = 0;
+    unsigned long txPackets = 0;
+    unsigned long rxSyscalls = 0;
+    unsigned long txSyscalls = 0;
+};
+
+int main(int argc, char **argv) {
+    int port = 5000;
+    int batch = MAX_BATCH;
+    int fleet = 0;
+    double duration = 0;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (std::strcmp(argv[i], "--port") == 0) {
+            port = std::atoi(argv[i + 1]);
+        } else if (std::strcmp(argv[i], "--batch") == 0) {
+            batch = std::atoi(argv[i + 1]);
+        } else if (std::strcmp(argv[i], "--fleet") == 0) {
+            fleet = std::atoi(argv[i + 1]);
+        } else if (std::strcmp(argv[i], "--duration") == 0) {
+            duration = std::atof(argv[i + 1]);
+        } else {
+            std::fprintf(stderr, "usage: %s [--port P] [--batch 1..%d] [--fleet N] [--duration S]\n", argv[0], MAX_BATCH);
+            return 1;
+        }
+    }
+    if (batch < 1 || batch > MAX_BATCH) {
+        std::fprintf(stderr, "--batch must be 1..%d\n", MAX_BATCH);
+        return 1;
+    }
+
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) {
+        std::perror("socket");
+        return 1;
+    }
+    int bufSize = 8 << 20;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &bufSize, sizeof(bufSize));
+    setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &bufSize, sizeof(bufSize));
+    // Wake up periodically to report and to notice signals
+    timeval tv = { 0, 200000 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    sockaddr_in local = {};
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+    local.sin_port = htons(port);
+    if (bind(fd, (sockaddr *)&local, sizeof(local)) < 0) {
+        std::perror("bind");
+        return 1;
+    }
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+
+    GroundStationConfig config;
+    authorizeSyntheticFleet(config, fleet);
+    GroundStationEngine engine(config);
+    GroundStationOutput out;
+
+    static DatagramRing rx;
+    static DatagramRing tx;
+    DaemonStats stats;
+    DaemonStats lastReport;
+
+    std::printf("gs_daemon: port %d, batch %d (%s), %zu authorized drones\n", port, batch,
+                batch == 1 ? "recvfrom/sendto" : "recvmmsg/sendmmsg", config.authorizedDrones.size());
+    std::fflush(stdout);
+
+    auto start = std::chrono::steady_clock::now();
+    auto nextReport = start + std::chrono::seconds(1);
+    while (!stopRequested) {
+        int received;
+        if (batch == 1) {
+            socklen_t addrLen = sizeof(sockaddr_in);
+            ssize_t n = recvfrom(fd, rx.buffers[0], MAX_DATAGRAM, 0, (sockaddr *)&rx.addrs[0], &addrLen);
+            received = n < 0 ? -1 : 1;
+            rx.msgs[0].msg_len = n < 0 ? 0 : n;
+        } else {
+            for (int i = 0; i < batch; i++) {
+                rx.prepare(i, MAX_DATAGRAM);
+            }
+            received = recvmmsg(fd, rx.msgs, batch, MSG_WAITFORONE, nullptr);
+        }
+        if (received < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            std::perror("recv");
+            break;
+        }
+
+        if (received > 0) {
+            stats.rxSyscalls++;
+            stats.rxPackets += received;
+            int replies = 0;
+            for (int i = 0; i < received; i++) {
+                // Parsed in place; the reply is copied into the send slot before the next call
+                engine.onDatagram(ByteSpan(rx.buffers[i], rx.msgs[i].msg_len), out);
+                if (out.datagram.empty()) {
+                    continue;
+                }
+                std::memcpy(tx.buffers[replies], out.datagram.data, out.datagram.size);
+                tx.addrs[replies] = rx.addrs[i];
+                tx.prepare(replies, out.datagram.size);
+                replies++;
+            }
+            if (batch == 1) {
+                for (int i = 0; i < replies; i++) {
+                    sendto(fd, tx.buffers[i], tx.iov[i].iov_len, 0, (sockaddr *)&tx.addrs[i], sizeof(sockaddr_in));
+                    stats.txSyscalls++;
+                }
+                stats.txPackets += replies;
+            } else {
+                int sent = 0;
+                while (sent < replies) {
+                    int n = sendmmsg(fd, tx.msgs + sent, replies - sent, 0);
+                    stats.txSyscalls++;
+                    if (n <= 0) {
+                        break;
+                    }
+                    sent += n;
+                }
+                stats.txPackets += sent;
+            }
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (now >= nextReport) {
+            unsigned long rxDelta = stats.rxPackets - lastReport.rxPackets;
+            unsigned long callDelta = stats.rxSyscalls - lastReport.rxSyscalls;
+            std::printf("rx %lu pkt/s, tx %lu pkt/s, %.1f datagrams per recv syscall\n",
+                        rxDelta, stats.txPackets - lastReport.txPackets,
+                        callDelta > 0 ? (double)rxDelta / callDelta : 0.0);
+            std::fflush(stdout);
+            lastReport = stats;
+            nextReport = now + std::chrono::seconds(1);
+        }
+        if (duration > 0 && std::chrono::duration<double>(now - start).count() >= duration) {
+            break;
+        }
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("total: %lu rx, %lu tx in %.1f s (%.0f rx pkt/s); %.1f datagrams per recv, %.1f per send syscall\n",
+                stats.rxPackets, stats.txPackets, seconds, stats.rxPackets / seconds,
+                stats.rxSyscalls > 0 ? (double)stats.rxPackets / stats.rxSyscalls : 0.0,
+                stats.txSyscalls > 0 ? (double)stats.txPackets / stats.txSyscalls : 0.0);
+    close(fd);
+    return 0;
+}
@@ -0,0 +1,199 @@
+/**
+ * gs_loadgen.cc
+ * Closed-loop UDP load for gs_daemon (Linux). Each of --window slots is one
+ * synthetic drone (DroneEngine) with its own connected socket, so replies
+ * need no session ID. A slot answers a challenge with its proof immediately
+ * and starts its next handshake as soon as it gets a verdict.
+ *
+ *   ./gs_loadgen [--target 127.0.0.1] [--port 5000] [--window 256]
+ *                [--duration 5] [--warmup 1]
+ *
+ * Reports handshakes/s, datagrams/s to the daemon and the round-trip time
+ * per datagram (p50/p99). Start the daemon with --fleet >= window.
+ */
+
+#include "AuthEngine.h"
+#include "SyntheticFleet.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+using namespace droneauth;
+
+typedef std::chrono::steady_clock Clock;
+
+static const double LOSS_TIMEOUT = 1.0;    // s without a reply before a slot restarts
+
+struct Slot {
+    int fd = -1;
+    std::unique_ptr<DroneEngine> drone;
+    Clock::time_point sentAt;
+};
+
+struct LoadStats {
+    unsigned long handshakes = 0;
+    unsigned long failures = 0;
+    unsigned long datagrams = 0;
+    unsigned long lost = 0;
+    LatencyHistogram rtt;
+};
+
+static void sendDatagram(Slot& slot, const DroneOutput& out, LoadStats& stats) {
+    if (out.datagram.empty()) {
+        return;
+    }
+    if (send(slot.fd, out.datagram.data, out.datagram.size, 0) >= 0) {
+        stats.datagrams++;
+    }
+    slot.sentAt = Clock::now();
+}
+
+int main(int argc, char **argv) {
+    const char *target = "127.0.0.1";
+    int port = 5000;
+    int window = 256;
+    double duration = 5;
+    double warmup = 1;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (std::strcmp(argv[i], "--target") == 0) {
+            target = argv[i + 1];
+        } else if (std::strcmp(argv[i], "--port") == 0) {
+            port = std::atoi(argv[i + 1]);
+        } else if (std::strcmp(argv[i], "--window") == 0) {
+            window = std::atoi(argv[i + 1]);
+        } else if (std::strcmp(argv[i], "--duration") == 0) {
+            duration = std::atof(argv[i + 1]);
+        } else if (std::strcmp(argv[i], "--warmup") == 0) {
+            warmup = std::atof(argv[i + 1]);
+        } else {
+            std::fprintf(stderr, "usage: %s [--target A] [--port P] [--window N] [--duration S] [--warmup S]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (window < 1) {
+        std::fprintf(stderr, "--window must be positive\n");
+        return 1;
+    }
+
+    sockaddr_in server = {};
+    server.sin_family = AF_INET;
+    server.sin_port = htons(port);
+    if (inet_pton(AF_INET, target, &server.sin_addr) != 1) {
+        std::fprintf(stderr, "bad target address %s\n", target);
+        return 1;
+    }
+
+    int epfd = epoll_create1(0);
+    std::vector<Slot> slots(window);
+    for (int i = 0; i < window; i++) {
+        Slot& slot = slots[i];
+        slot.fd = socket(AF_INET, SOCK_DGRAM, 0);
+        if (slot.fd < 0 || connect(slot.fd, (sockaddr *)&server, sizeof(server)) < 0) {
+            std::perror("socket");
+            return 1;
+        }
+        fcntl(slot.fd, F_SETFL, O_NONBLOCK);
+        epoll_event ev = {};
+        ev.events = EPOLLIN;
+        ev.data.u32 = i;
+        epoll_ctl(epfd, EPOLL_CTL_ADD, slot.fd, &ev);
+        DroneConfig config;
+        config.droneId = syntheticDroneId(i);
+        config.password = "secure";
+        slot.drone.reset(new DroneEngine(config));
+    }
+
+    LoadStats stats;
+    LoadStats warmupStats;
+    DroneOutput out;
+    for (Slot& slot : slots) {
+        slot.drone->onTimer(DRONE_TIMER_REQUEST, out);
+        sendDatagram(slot, out, stats);
+    }
+
+    auto start = Clock::now();
+    auto measureStart = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(warmup));
+    auto end = measureStart + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(duration));
+    auto nextLossCheck = start;
+    bool measuring = warmup <= 0;
+    uint8_t buffer[2048];
+    epoll_event events[64];
+    for (;;) {
+        auto now = Clock::now();
+        if (now >= end) {
+            break;
+        }
+        if (!measuring && now >= measureStart) {
+            // Throughput counts only the measurement interval
+            warmupStats.handshakes = stats.handshakes;
+            warmupStats.failures = stats.failures;
+            warmupStats.datagrams = stats.datagrams;
+            warmupStats.lost = stats.lost;
+            stats.rtt = LatencyHistogram();
+            measuring = true;
+        }
+        if (now >= nextLossCheck) {
+            for (Slot& slot : slots) {
+                if (std::chrono::duration<double>(now - slot.sentAt).count() > LOSS_TIMEOUT) {
+                    stats.lost++;
+                    slot.drone->onTimer(DRONE_TIMER_REQUEST, out);
+                    sendDatagram(slot, out, stats);
+                }
+            }
+            nextLossCheck = now + std::chrono::milliseconds(100);
+        }
+
+        int ready = epoll_wait(epfd, events, 64, 10);
+        for (int e = 0; e < ready; e++) {
+            Slot& slot = slots[events[e].data.u32];
+            ssize_t n;
+            while ((n = recv(slot.fd, buffer, sizeof(buffer), 0)) > 0) {
+                auto received = Clock::now();
+                stats.rtt.add(std::chrono::duration_cast<std::chrono::nanoseconds>(received - slot.sentAt).count());
+                slot.drone->onDatagram(ByteSpan(buffer, n), out);
+                switch (out.event) {
+                    case DRONE_EVENT_CHALLENGE:
+                        // No compute delay: the proof goes out right away
+                        slot.drone->onTimer(DRONE_TIMER_PROOF, out);
+                        sendDatagram(slot, out, stats);
+                        break;
+                    case DRONE_EVENT_SUCCESS:
+                    case DRONE_EVENT_FAILURE:
+                        stats.handshakes++;
+                        if (out.event == DRONE_EVENT_FAILURE) {
+                            stats.failures++;
+                        }
+                        slot.drone->onTimer(DRONE_TIMER_REQUEST, out);
+                        sendDatagram(slot, out, stats);
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    double seconds = duration;
+    unsigned long handshakes = stats.handshakes - warmupStats.handshakes;
+    unsigned long datagrams = stats.datagrams - warmupStats.datagrams;
+    std::printf("gs_loadgen: %d slots, %.1f s measured\n", window, seconds);
+    std::printf("  %.0f handshakes/s (%lu failed, %lu lost), %.0f datagrams/s to the daemon\n",
+                handshakes / seconds, stats.failures - warmupStats.failures,
+                stats.lost - warmupStats.lost, datagrams / seconds);
+    std::printf("  round trip per datagram: mean %.1f us, p50 %.1f us, p99 %.1f us\n",
+                stats.rtt.getMeanNs() / 1e3, stats.rtt.percentileNs(0.50) / 1e3, stats.rtt.percentileNs(0.99) / 1e3);
+    for (Slot& slot : slots) {
+        close(slot.fd);
+    }
+    close(epfd);
+    return 0;
+}
@@ -0,0 +1,165 @@
+/**
+ * shard_bench.cc
+ * Scaling of ShardedGroundStation: handshakes/s with 1..N worker threads on
+ * synthetic traffic. Producer threads play the drones (DroneEngines), hand
+ * requests and proofs to the shards and feed the replies back.
+ *
+ *   ./shard_bench [--max-workers N] [--producers P] [--drones D] [--duration S]
+ *
+ * Without --producers each step uses as many producers as workers. Drone
+ * work (proof generation) runs on the producer threads, so give the machine
+ * at least workers + producers cores for a clean curve.
+ */
+
+#include "ShardedGroundStation.h"
+#include "SyntheticFleet.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace droneauth;
+
+typedef std::chrono::steady_clock Clock;
+
+struct Producer {
+    std::vector<std::unique_ptr<DroneEngine>> drones;
+    std::vector<uint32_t> blocked;      // drones whose datagram did not fit into a ring
+    std::atomic<uint64_t> handshakes{0};
+    std::thread thread;
+};
+
+static void submitOrQueue(ShardedGroundStation& gs, int id, Producer& producer,
+                          uint32_t drone, const DroneOutput& out) {
+    if (!gs.submit(id, out.datagram.data, out.datagram.size, drone)) {
+        producer.blocked.push_back(drone);
+    }
+}
+
+static void runProducer(ShardedGroundStation& gs, int id, Producer& producer,
+                        const std::atomic<bool>& running) {
+    DroneOutput out;
+    for (uint32_t i = 0; i < producer.drones.size(); i++) {
+        producer.drones[i]->onTimer(DRONE_TIMER_REQUEST, out);
+        submitOrQueue(gs, id, producer, i, out);
+    }
+    std::vector<uint32_t> retry;
+    while (running.load(std::memory_order_relaxed)) {
+        size_t handled = gs.poll(id, [&](const ShardMessage& reply) {
+            DroneEngine& drone = *producer.drones[reply.peer];
+            drone.onDatagram(ByteSpan(reply.data, reply.length), out);
+            if (out.event == DRONE_EVENT_CHALLENGE) {
+                drone.onTimer(DRONE_TIMER_PROOF, out);
+                submitOrQueue(gs, id, producer, reply.peer, out);
+            } else if (out.event == DRONE_EVENT_SUCCESS || out.event == DRONE_EVENT_FAILURE) {
+                producer.handshakes.fetch_add(1, std::memory_order_relaxed);
+                drone.onTimer(DRONE_TIMER_REQUEST, out);
+                submitOrQueue(gs, id, producer, reply.peer, out);
+            }
+        });
+        if (handled == 0 && !producer.blocked.empty()) {
+            // Only once the replies have drained, or retries refill the rings at once.
+            // A blocked drone restarts its handshake; the ground station supersedes the old challenge
+            std::this_thread::yield();
+            retry.swap(producer.blocked);
+            for (uint32_t drone : retry) {
+                producer.drones[drone]->onTimer(DRONE_TIMER_REQUEST, out);
+                submitOrQueue(gs, id, producer, drone, out);
+            }
+            retry.clear();
+        }
+    }
+}
+
+static double measure(int numWorkers, int numProducers, int numDrones, double duration) {
+    GroundStationConfig config;
+    authorizeSyntheticFleet(config, numDrones);
+    // A drone has one datagram in flight, so rings this large never fill
+    size_t dronesPerProducer = (numDrones + numProducers - 1) / numProducers;
+    ShardedGroundStation gs(config, numWorkers, numProducers, std::max<size_t>(1024, dronesPerProducer));
+
+    std::vector<std::unique_ptr<Producer>> producers;
+    for (int p = 0; p < numProducers; p++) {
+        producers.emplace_back(new Producer());
+    }
+    for (int i = 0; i < numDrones; i++) {
+        DroneConfig droneConfig;
+        droneConfig.droneId = syntheticDroneId(i);
+        droneConfig.password = "secure";
+        producers[i % numProducers]->drones.emplace_back(new DroneEngine(droneConfig));
+    }
+
+    std::atomic<bool> running{true};
+    gs.start();
+    for (int p = 0; p < numProducers; p++) {
+        Producer *producer = producers[p].get();
+        producer->thread = std::thread([&gs, p, producer, &running] { runProducer(gs, p, *producer, running); });
+    }
+
+    auto total = [&] {
+        uint64_t sum = 0;
+        for (auto& producer : producers) {
+            sum += producer->handshakes.load(std::memory_order_relaxed);
+        }
+        return sum;
+    };
+    // Warm-up registers every drone at its shard
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    uint64_t before = total();
+    auto start = Clock::now();
+    std::this_thread::sleep_for(std::chrono::duration<double>(duration));
+    uint64_t after = total();
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    running = false;
+    for (auto& producer : producers) {
+        producer->thread.join();
+    }
+    gs.stop();
+    return (after - before) / seconds;
+}
+
+int main(int argc, char **argv) {
+    int maxWorkers = std::thread::hardware_concurrency() > 1 ? std::thread::hardware_concurrency() / 2 : 1;
+    int fixedProducers = 0;
+    int numDrones = 4096;
+    double duration = 2;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (std::strcmp(argv[i], "--max-workers") == 0) {
+            maxWorkers = std::atoi(argv[i + 1]);
+        } else if (std::strcmp(argv[i], "--producers") == 0) {
+            fixedProducers = std::atoi(argv[i + 1]);
+        } else if (std::strcmp(argv[i], "--drones") == 0) {
+            numDrones = std::atoi(argv[i + 1]);
+        } else if (std::strcmp(argv[i], "--duration") == 0) {
+            duration = std::atof(argv[i + 1]);
+        } else {
+            std::fprintf(stderr, "usage: %s [--max-workers N] [--producers P] [--drones D] [--duration S]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (maxWorkers < 1 || numDrones < 1 || fixedProducers < 0) {
+        std::fprintf(stderr, "invalid arguments\n");
+        return 1;
+    }
+
+    std::printf("Sharded ground station: %d drones, %u hardware threads\n",
+                numDrones, std::thread::hardware_concurrency());
+    std::printf("%8s %10s %14s %9s\n", "workers", "producers", "handshakes/s", "speedup");
+    double baseline = 0;
+    for (int workers = 1; workers <= maxWorkers; workers++) {
+        int producers = fixedProducers > 0 ? fixedProducers : workers;
+        double rate = measure(workers, producers, numDrones, duration);
+        if (workers == 1) {
+            baseline = rate;
+        }
+        std::printf("%8d %10d %14.0f %8.2fx\n", workers, producers, rate, baseline > 0 ? rate / baseline : 0.0);
+        std::fflush(stdout);
+    }
+    return 0;
+}
@@ -0,0 +1,490 @@
+/**
+ * swarm_loadgen.cc
+ * Swarm load generator: every logical drone runs the DroneAuthApp handshake
+ * (request, challenge, proof, verdict, timeout and retry) as a C++20
+ * coroutine on a single-threaded event loop, against an in-process
+ * GroundStationEngine over a simulated link. One coroutine frame plus one
+ * DroneEngine per drone, so 100k+ concurrent handshakes fit in one process.
+ *
+ *   ./swarm_loadgen [--drones 100000] [--duration 10]
+ *                   [--arrival burst|uniform|poisson] [--ramp 1] [--rate 50000]
+ *                   [--think 0] [--loss 0] [--unauthorized 0]
+ *                   [--delay 0] [--timeout 5] [--retry 1] [--seed 1]
+ *                   [--trace FILE]
+ *
+ *   --arrival  first start of each drone: all at once, uniform over --ramp
+ *              seconds, or a Poisson process of --rate starts/s
+ *   --think    mean (exponential) pause between a verdict and the next handshake
+ *   --loss     probability of dropping each datagram, either direction
+ *   --unauthorized  fraction of drones with IDs the ground station rejects
+ *   --delay    one-way link delay (s)
+ *   --trace    capture the ground station's datagrams for trace_replay
+ *
+ * Reports handshake throughput, outcome counts and latency percentiles
+ * (request sent to verdict) of successful handshakes.
+ */
+
+#include "AuthEngine.h"
+#include "AuthTrace.h"
+#include "SyntheticFleet.h"
+#include <chrono>
+#include <coroutine>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <queue>
+#include <thread>
+#include <vector>
+
+using namespace droneauth;
+
+typedef std::chrono::steady_clock Clock;
+
+static const int GS_SLICE = 1024;   // ground-station datagrams per event-loop turn
+
+static uint64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+}
+
+static uint64_t toNs(double seconds) {
+    return (uint64_t)(seconds * 1e9);
+}
+
+// xorshift64*: cheap, reproducible with --seed
+class Random {
+public:
+    explicit Random(uint64_t seed) : state(seed ? seed : 1) {}
+    double uniform() {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return ((state * 2685821657736338717ULL) >> 11) * (1.0 / 9007199254740992.0);
+    }
+    double exponential(double mean) { return mean > 0 ? -mean * std::log(1.0 - uniform()) : 0.0; }
+private:
+    uint64_t state;
+};
+
+struct SwarmOptions {
+    int numDrones = 100000;
+    double duration = 10;
+    enum Arrival { BURST, UNIFORM, POISSON } arrival = BURST;
+    double ramp = 1;
+    double rate = 50000;
+    double think = 0;
+    double loss = 0;
+    double unauthorized = 0;
+    double delay = 0;
+    double timeout = 5;
+    double retry = 1;
+    uint64_t seed = 1;
+    const char *traceFile = nullptr;
+};
+
+struct SwarmStats {
+    uint64_t started = 0;
+    uint64_t succeeded = 0;
+    uint64_t rejected = 0;
+    uint64_t timeouts = 0;
+    uint64_t dropped = 0;
+    uint64_t active = 0;
+    uint64_t maxActive = 0;
+    LatencyHistogram latency;
+};
+
+// Fire-and-forget coroutine; the frame frees itself when the body returns
+struct DroneTask {
+    struct promise_type {
+        DroneTask get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+struct Drone {
+    std::unique_ptr<DroneEngine> engine;
+    std::coroutine_handle<> handle;     // set while suspended
+    uint32_t index = 0;
+    uint32_t generation = 0;            // of the outstanding exchange
+    bool awaiting = false;
+    bool replied = false;
+    std::vector<uint8_t> reply;
+};
+
+class Swarm {
+public:
+    Swarm(const SwarmOptions& options);
+    ~Swarm();
+
+    void run();
+    const SwarmStats& getStats() const { return stats; }
+    bool openTrace(const char *fileName) { return trace.open(fileName); }
+
+    // Awaitables used by the drone coroutines
+    struct Sleep {
+        Swarm& swarm;
+        Drone& drone;
+        double seconds;
+        bool await_ready() const { return false; }
+        void await_suspend(std::coroutine_handle<> h) {
+            drone.handle = h;
+            swarm.schedule(nowNs() + toNs(seconds), drone, EVENT_WAKE);
+        }
+        void await_resume() const {}
+    };
+
+    // Sends a datagram and resumes with true on a reply, false on timeout
+    struct Exchange {
+        Swarm& swarm;
+        Drone& drone;
+        ByteSpan datagram;
+        bool await_ready() const { return false; }
+        void await_suspend(std::coroutine_handle<> h) {
+            drone.handle = h;
+            drone.generation++;
+            drone.awaiting = true;
+            drone.replied = false;
+            swarm.transmit(drone, datagram);
+            swarm.schedule(nowNs() + toNs(swarm.options.timeout), drone, EVENT_TIMEOUT);
+        }
+        bool await_resume() const { return drone.replied; }
+    };
+
+private:
+    enum EventKind : uint8_t { EVENT_WAKE, EVENT_TIMEOUT, EVENT_REPLY };
+
+    struct Event {
+        uint64_t when;
+        uint64_t seq;
+        uint32_t drone;
+        uint32_t generation;
+        EventKind kind;
+        bool operator>(const Event& other) const {
+            return when != other.when ? when > other.when : seq > other.seq;
+        }
+    };
+
+    // Datagram on its way to the ground station, copied: the drone may re-encode after a timeout
+    struct InFlight {
+        static const size_t MAX_DATAGRAM = 256;
+        uint64_t arrival;
+        uint32_t drone;
+        uint32_t generation;
+        uint32_t length;
+        uint8_t data[MAX_DATAGRAM];
+    };
+
+    DroneTask droneLoop(Drone& drone, double startDelay);
+    void schedule(uint64_t when, Drone& drone, EventKind kind);
+    void transmit(Drone& drone, ByteSpan datagram);
+    void serveGroundStation(uint64_t now);
+    void dispatch(const Event& event);
+    void resume(Drone& drone);
+
+    SwarmOptions options;
+    SwarmStats stats;
+    Random random;
+    GroundStationEngine *groundStation;
+    GroundStationOutput gsOutput;
+    std::vector<Drone> drones;
+    std::priority_queue<Event, std::vector<Event>, std::greater<Event>> wakeups;
+    std::deque<Event> timeouts;
+    std::deque<Event> replies;
+    std::deque<InFlight> uplink;
+    TraceWriter trace;
+    uint64_t traceStart = 0;
+    uint64_t nextSeq = 0;
+    bool running = false;
+};
+
+Swarm::Swarm(const SwarmOptions& options) : options(options), random(options.seed) {
+    GroundStationConfig config;
+    drones.resize(options.numDrones);
+    int numAuthorized = 0;
+    for (int i = 0; i < options.numDrones; i++) {
+        DroneConfig droneConfig;
+        if (random.uniform() < options.unauthorized) {
+            char id[32];
+            std::snprintf(id, sizeof(id), "ROGUE_%05d", i + 1);
+            droneConfig.droneId = id;
+        } else {
+            droneConfig.droneId = syntheticDroneId(i);
+            config.authorizedDrones.insert(droneConfig.droneId);
+            numAuthorized++;
+        }
+        droneConfig.password = "secure";
+        droneConfig.authTimeout = options.timeout;
+        droneConfig.retryInterval = options.retry;
+        drones[i].engine.reset(new DroneEngine(droneConfig));
+        drones[i].index = i;
+    }
+    groundStation = new GroundStationEngine(config);
+    std::printf("swarm: %d drones (%d authorized)\n", options.numDrones, numAuthorized);
+}
+
+Swarm::~Swarm() {
+    // Coroutines still suspended at the end of the run
+    for (Drone& drone : drones) {
+        if (drone.handle) {
+            drone.handle.destroy();
+        }
+    }
+    delete groundStation;
+}
+
+void Swarm::schedule(uint64_t when, Drone& drone, EventKind kind) {
+    Event event{ when, nextSeq++, drone.index, drone.generation, kind };
+    // Timeouts and replies have constant delays, so plain FIFOs keep them in deadline order
+    if (kind == EVENT_TIMEOUT) {
+        timeouts.push_back(event);
+    } else if (kind == EVENT_REPLY) {
+        replies.push_back(event);
+    } else {
+        wakeups.push(event);
+    }
+}
+
+void Swarm::transmit(Drone& drone, ByteSpan datagram) {
+    if (random.uniform() < options.loss || datagram.size > InFlight::MAX_DATAGRAM) {
+        stats.dropped++;
+        return;
+    }
+    uplink.emplace_back();
+    InFlight& in = uplink.back();
+    in.arrival = nowNs() + toNs(options.delay);
+    in.drone = drone.index;
+    in.generation = drone.generation;
+    in.length = datagram.size;
+    std::memcpy(in.data, datagram.data, datagram.size);
+}
+
+void Swarm::resume(Drone& drone) {
+    std::coroutine_handle<> h = drone.handle;
+    drone.handle = nullptr;
+    h.resume();
+}
+
+void Swarm::serveGroundStation(uint64_t now) {
+    // FIFO link with constant delay: everything up to the first future arrival is due.
+    // A bounded slice per loop turn lets replies and timers interleave with a backlog.
+    for (int n = 0; n < GS_SLICE && !uplink.empty() && uplink.front().arrival <= now; n++) {
+        const InFlight& in = uplink.front();
+        Drone& drone = drones[in.drone];
+        uint32_t generation = in.generation;
+        groundStation->onDatagram(ByteSpan(in.data, in.length), gsOutput);
+        if (trace.isOpen()) {
+            trace.append(in.arrival - traceStart, in.drone, TRACE_IN, ByteSpan(in.data, in.length));
+            if (!gsOutput.datagram.empty()) {
+                trace.append(now - traceStart, in.drone, TRACE_OUT, gsOutput.datagram);
+            }
+        }
+        uplink.pop_front();
+        if (gsOutput.datagram.empty()) {
+            continue;
+        }
+        if (random.uniform() < options.loss) {
+            stats.dropped++;
+            continue;
+        }
+        if (!drone.awaiting || drone.generation != generation) {
+            continue;  // the drone gave up on this exchange
+        }
+        drone.reply.assign(gsOutput.datagram.data, gsOutput.datagram.data + gsOutput.datagram.size);
+        schedule(now + toNs(options.delay), drone, EVENT_REPLY);
+    }
+}
+
+void Swarm::dispatch(const Event& event) {
+    Drone& drone = drones[event.drone];
+    switch (event.kind) {
+        case EVENT_WAKE:
+            resume(drone);
+            break;
+        case EVENT_TIMEOUT:
+        case EVENT_REPLY:
+            if (drone.awaiting && drone.generation == event.generation) {
+                drone.awaiting = false;
+                drone.replied = event.kind == EVENT_REPLY;
+                resume(drone);
+            }
+            break;
+    }
+}
+
+DroneTask Swarm::droneLoop(Drone& drone, double startDelay) {
+    DroneEngine& engine = *drone.engine;
+    DroneOutput out;
+    co_await Sleep{ *this, drone, startDelay };
+    while (running) {
+        stats.started++;
+        stats.active++;
+        if (stats.active > stats.maxActive) {
+            stats.maxActive = stats.active;
+        }
+        uint64_t startNs = nowNs();
+        engine.onTimer(DRONE_TIMER_REQUEST, out);
+        bool replied = co_await Exchange{ *this, drone, out.datagram };
+        if (replied) {
+            engine.onDatagram(ByteSpan(drone.reply), out);
+            if (out.event == DRONE_EVENT_CHALLENGE) {
+                engine.onTimer(DRONE_TIMER_PROOF, out);
+                replied = co_await Exchange{ *this, drone, out.datagram };
+                if (replied) {
+                    engine.onDatagram(ByteSpan(drone.reply), out);
+                }
+            }
+        }
+        stats.active--;
+
+        if (!replied) {
+            stats.timeouts++;
+            co_await Sleep{ *this, drone, options.retry };
+            continue;
+        }
+        if (out.event == DRONE_EVENT_SUCCESS) {
+            stats.succeeded++;
+            stats.latency.add(nowNs() - startNs);
+        } else {
+            stats.rejected++;
+        }
+        co_await Sleep{ *this, drone, random.exponential(options.think) };
+    }
+}
+
+void Swarm::run() {
+    running = true;
+    traceStart = nowNs();
+    double offset = 0;
+    for (Drone& drone : drones) {
+        double startDelay = 0;
+        if (options.arrival == SwarmOptions::UNIFORM) {
+            startDelay = random.uniform() * options.ramp;
+        } else if (options.arrival == SwarmOptions::POISSON) {
+            offset += random.exponential(1.0 / options.rate);
+            startDelay = offset;
+        }
+        droneLoop(drone, startDelay);
+    }
+
+    uint64_t start = nowNs();
+    uint64_t end = start + toNs(options.duration);
+    uint64_t nextReport = start + toNs(1);
+    SwarmStats last;
+    for (;;) {
+        uint64_t now = nowNs();
+        if (now >= end) {
+            break;
+        }
+        serveGroundStation(now);
+        while (!replies.empty() && replies.front().when <= now) {
+            Event event = replies.front();
+            replies.pop_front();
+            dispatch(event);
+        }
+        while (!timeouts.empty() && timeouts.front().when <= now) {
+            Event event = timeouts.front();
+            timeouts.pop_front();
+            dispatch(event);
+        }
+        while (!wakeups.empty() && wakeups.top().when <= now) {
+            Event event = wakeups.top();
+            wakeups.pop();
+            dispatch(event);
+        }
+        if (now >= nextReport) {
+            std::printf("  %6.1f s: %8llu handshakes/s, %7llu active, %llu timeouts\n",
+                        (now - start) / 1e9,
+                        (unsigned long long)(stats.succeeded + stats.rejected - last.succeeded - last.rejected),
+                        (unsigned long long)stats.active, (unsigned long long)stats.timeouts);
+            std::fflush(stdout);
+            last.succeeded = stats.succeeded;
+            last.rejected = stats.rejected;
+            nextReport = now + toNs(1);
+        }
+        bool idle = uplink.empty() && replies.empty()
+                && (timeouts.empty() || timeouts.front().when > now + 1000000)
+                && (wakeups.empty() || wakeups.top().when > now + 1000000);
+        if (idle) {
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+    }
+    running = false;
+}
+
+int main(int argc, char **argv) {
+    SwarmOptions options;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const char *name = argv[i];
+        const char *value = argv[i + 1];
+        if (std::strcmp(name, "--drones") == 0) {
+            options.numDrones = std::atoi(value);
+        } else if (std::strcmp(name, "--duration") == 0) {
+            options.duration = std::atof(value);
+        } else if (std::strcmp(name, "--arrival") == 0) {
+            if (std::strcmp(value, "burst") == 0) {
+                options.arrival = SwarmOptions::BURST;
+            } else if (std::strcmp(value, "uniform") == 0) {
+                options.arrival = SwarmOptions::UNIFORM;
+            } else if (std::strcmp(value, "poisson") == 0) {
+                options.arrival = SwarmOptions::POISSON;
+            } else {
+                std::fprintf(stderr, "unknown arrival process '%s'\n", value);
+                return 1;
+            }
+        } else if (std::strcmp(name, "--ramp") == 0) {
+            options.ramp = std::atof(value);
+        } else if (std::strcmp(name, "--rate") == 0) {
+            options.rate = std::atof(value);
+        } else if (std::strcmp(name, "--think") == 0) {
+            options.think = std::atof(value);
+        } else if (std::strcmp(name, "--loss") == 0) {
+            options.loss = std::atof(value);
+        } else if (std::strcmp(name, "--unauthorized") == 0) {
+            options.unauthorized = std::atof(value);
+        } else if (std::strcmp(name, "--delay") == 0) {
+            options.delay = std::atof(value);
+        } else if (std::strcmp(name, "--timeout") == 0) {
+            options.timeout = std::atof(value);
+        } else if (std::strcmp(name, "--retry") == 0) {
+            options.retry = std::atof(value);
+        } else if (std::strcmp(name, "--seed") == 0) {
+            options.seed = std::strtoull(value, nullptr, 10);
+        } else if (std::strcmp(name, "--trace") == 0) {
+            options.traceFile = value;
+        } else {
+            std::fprintf(stderr, "unknown option %s (see the header of swarm_loadgen.cc)\n", name);
+            return 1;
+        }
+    }
+    if (options.numDrones < 1 || options.duration <= 0 || options.rate <= 0) {
+        std::fprintf(stderr, "invalid arguments\n");
+        return 1;
+    }
+
+    Swarm swarm(options);
+    if (options.traceFile != nullptr && !swarm.openTrace(options.traceFile)) {
+        std::fprintf(stderr, "cannot create trace file %s\n", options.traceFile);
+        return 1;
+    }
+    swarm.run();
+
+    const SwarmStats& stats = swarm.getStats();
+    const LatencyHistogram& h = stats.latency;
+    std::printf("completed %llu handshakes in %.1f s: %.0f/s (%llu succeeded, %llu rejected, %llu timed out)\n",
+                (unsigned long long)(stats.succeeded + stats.rejected), options.duration,
+                (stats.succeeded + stats.rejected) / options.duration,
+                (unsigned long long)stats.succeeded, (unsigned long long)stats.rejected,
+                (unsigned long long)stats.timeouts);
+    std::printf("peak concurrent handshakes %llu, %llu datagrams dropped\n",
+                (unsigned long long)stats.maxActive, (unsigned long long)stats.dropped);
+    std::printf("latency of successful handshakes: p50 %.2f ms, p90 %.2f ms, p99 %.2f ms, p99.9 %.2f ms, max %.2f ms\n",
+                h.percentileNs(0.50) / 1e6, h.percentileNs(0.90) / 1e6, h.percentileNs(0.99) / 1e6,
+                h.percentileNs(0.999) / 1e6, h.getMaxNs() / 1e6);
+    return 0;
+}
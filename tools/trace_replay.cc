@@ -0,0 +1,291 @@
+/**
+ * trace_replay.cc
+ * Feeds a captured trace (AuthTrace.h; GroundStation traceFile or
+ * swarm_loadgen --trace) through ShardedGroundStation, at the recorded pace
+ * or as fast as the workers go, and checks every reply against the one
+ * recorded.
+ *
+ *   ./trace_replay TRACE [--pace recorded|max] [--speed 1] [--workers N] [--loops 1]
+ *
+ *   --pace     recorded: submit each datagram at its capture time (scaled by
+ *              --speed); max: submit back to back
+ *   --workers  verifier threads, default one per core but the replaying one
+ *   --loops    replay the trace this many times
+ *
+ * Drones whose AUTH_REQUEST was answered with a CHALLENGE in the trace are
+ * authorized, and each gets the challenges recorded for it in order, so the
+ * recorded proofs verify. Proof timestamps are refreshed at submit time to
+ * pass the verifier's freshness check.
+ */
+
+#include "AuthTrace.h"
+#include "ShardedGroundStation.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using namespace droneauth;
+
+typedef std::chrono::steady_clock Clock;
+
+static uint64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+}
+
+static uint64_t wallClockNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// One datagram the ground station received, with the reply it sent
+struct ReplayItem {
+    uint64_t timeNs;
+    ByteSpan datagram;      // points into the trace mapping
+    uint8_t expectedReply;  // message type, 0 = none recorded
+};
+
+// Challenges issued to one drone, in capture order; only the drone's shard reads them
+struct RecordedChallenges {
+    std::vector<std::string> challenges;
+    std::atomic<size_t> next{0};
+};
+
+struct ReplayStats {
+    uint64_t submitted = 0;
+    uint64_t replies = 0;
+    uint64_t matched = 0;
+    uint64_t mismatched = 0;
+    uint64_t succeeded = 0;
+    uint64_t failed = 0;
+    LatencyHistogram latency;   // submit to reply, including queueing
+    LatencyHistogram lateness;  // recorded pace: how far behind schedule a submit was
+};
+
+static bool loadTrace(TraceReader& reader, std::vector<ReplayItem>& items, GroundStationConfig& config,
+                      std::unordered_map<std::string, std::unique_ptr<RecordedChallenges>>& challenges) {
+    config.authorizedDrones.clear();
+    std::string droneId;
+    std::string challenge;
+    std::vector<uint8_t> commitment;
+    const TraceRecord *record;
+    ByteSpan datagram;
+    uint32_t lastPeer = 0;
+    while (reader.next(record, datagram)) {
+        if (record->direction == TRACE_IN) {
+            items.push_back(ReplayItem{ record->timeNs, datagram, 0 });
+            lastPeer = record->peer;
+            continue;
+        }
+        // A reply directly follows the datagram that caused it
+        if (items.empty() || items.back().expectedReply != 0 || record->peer != lastPeer || datagram.empty()) {
+            continue;
+        }
+        ReplayItem& item = items.back();
+        item.expectedReply = datagram.data[0];
+        if (item.expectedReply != MSG_CHALLENGE
+                || !AuthCodec::decodeAuthRequest(item.datagram.data, item.datagram.size, droneId, commitment)
+                || !AuthCodec::decodeChallenge(datagram.data, datagram.size, challenge)) {
+            continue;
+        }
+        config.authorizedDrones.insert(droneId);
+        std::unique_ptr<RecordedChallenges>& recorded = challenges[droneId];
+        if (!recorded) {
+            recorded.reset(new RecordedChallenges());
+        }
+        recorded->challenges.push_back(challenge);
+    }
+    return !items.empty();
+}
+
+class Replayer {
+public:
+    Replayer(const GroundStationConfig& config, int numWorkers, const std::vector<ReplayItem>& items)
+        : items(items), sentNs(items.size(), 0), gs(config, numWorkers, 1, 4096) {}
+
+    void run(bool recordedPace, double speed, int loops);
+    const ReplayStats& getStats() const { return stats; }
+    double getElapsed() const { return elapsed; }
+
+private:
+    void submit(size_t index);
+    size_t drainReplies();
+
+    const std::vector<ReplayItem>& items;
+    std::vector<uint64_t> sentNs;
+    ShardedGroundStation gs;
+    ReplayStats stats;
+    double elapsed = 0;
+    uint8_t buffer[ShardMessage::MAX_DATAGRAM];
+};
+
+void Replayer::submit(size_t index) {
+    const ReplayItem& item = items[index];
+    if (item.datagram.size > sizeof(buffer)) {
+        return;
+    }
+    std::memcpy(buffer, item.datagram.data, item.datagram.size);
+    if (buffer[0] == MSG_PROOF && item.datagram.size >= 9) {
+        // The timestamp is the last field of a PROOF
+        uint64_t timestamp = wallClockNs();
+        std::memcpy(buffer + item.datagram.size - 8, &timestamp, 8);
+    }
+    sentNs[index] = nowNs();
+    while (!gs.submit(0, buffer, item.datagram.size, index)) {
+        drainReplies();  // shard ring full: make room by taking replies
+    }
+    stats.submitted++;
+}
+
+size_t Replayer::drainReplies() {
+    return gs.poll(0, [this](const ShardMessage& reply) {
+        const ReplayItem& item = items[reply.peer];
+        stats.replies++;
+        stats.latency.add(nowNs() - sentNs[reply.peer]);
+        uint8_t type = reply.length > 0 ? reply.data[0] : 0;
+        if (type == item.expectedReply) {
+            stats.matched++;
+        } else {
+            stats.mismatched++;
+        }
+        if (type == MSG_AUTH_SUCCESS) {
+            stats.succeeded++;
+        } else if (type == MSG_AUTH_FAILURE) {
+            stats.failed++;
+        }
+    }, 256);
+}
+
+void Replayer::run(bool recordedPace, double speed, int loops) {
+    gs.start();
+    uint64_t firstNs = items.front().timeNs;
+    uint64_t spanNs = items.back().timeNs - firstNs + 1;
+    uint64_t start = nowNs();
+    for (int loop = 0; loop < loops; loop++) {
+        for (size_t i = 0; i < items.size(); i++) {
+            if (recordedPace) {
+                uint64_t offset = loop * spanNs + (items[i].timeNs - std::min(items[i].timeNs, firstNs));
+                uint64_t due = start + (uint64_t)(offset / speed);
+                uint64_t now = nowNs();
+                while (now < due) {
+                    if (drainReplies() == 0 && due - now > 200000) {
+                        std::this_thread::sleep_for(std::chrono::microseconds(100));
+                    }
+                    now = nowNs();
+                }
+                stats.lateness.add(now - due);
+            }
+            submit(i);
+            if ((i & 63) == 0) {
+                drainReplies();
+            }
+        }
+    }
+    // Wait for the workers to finish what is queued
+    while (gs.getProcessed() < stats.submitted) {
+        if (drainReplies() == 0) {
+            std::this_thread::yield();
+        }
+    }
+    double seconds = (nowNs() - start) / 1e9;
+    while (drainReplies() > 0) {
+    }
+    gs.stop();
+    elapsed = seconds;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2 || argv[1][0] == '-') {
+        std::fprintf(stderr, "usage: %s TRACE [--pace recorded|max] [--speed X] [--workers N] [--loops N]\n", argv[0]);
+        return 1;
+    }
+    const char *fileName = argv[1];
+    bool recordedPace = false;
+    double speed = 1;
+    int numWorkers = std::thread::hardware_concurrency() > 1 ? std::thread::hardware_concurrency() - 1 : 1;
+    int loops = 1;
+    for (int i = 2; i + 1 < argc; i += 2) {
+        const char *name = argv[i];
+        const char *value = argv[i + 1];
+        if (std::strcmp(name, "--pace") == 0) {
+            if (std::strcmp(value, "recorded") == 0) {
+                recordedPace = true;
+            } else if (std::strcmp(value, "max") == 0) {
+                recordedPace = false;
+            } else {
+                std::fprintf(stderr, "unknown pace '%s'\n", value);
+                return 1;
+            }
+        } else if (std::strcmp(name, "--speed") == 0) {
+            speed = std::atof(value);
+        } else if (std::strcmp(name, "--workers") == 0) {
+            numWorkers = std::atoi(value);
+        } else if (std::strcmp(name, "--loops") == 0) {
+            loops = std::atoi(value);
+        } else {
+            std::fprintf(stderr, "unknown option %s (see the header of trace_replay.cc)\n", name);
+            return 1;
+        }
+    }
+    if (speed <= 0 || numWorkers < 1 || loops < 1) {
+        std::fprintf(stderr, "invalid arguments\n");
+        return 1;
+    }
+
+    TraceReader reader;
+    std::string error;
+    if (!reader.open(fileName, error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    std::vector<ReplayItem> items;
+    GroundStationConfig config;
+    std::unordered_map<std::string, std::unique_ptr<RecordedChallenges>> challenges;
+    if (!loadTrace(reader, items, config, challenges)) {
+        std::fprintf(stderr, "%s holds no inbound datagrams\n", fileName);
+        return 1;
+    }
+    config.challengeSource = [&challenges](const std::string& droneId, std::string& challenge) {
+        auto it = challenges.find(droneId);
+        if (it == challenges.end()) {
+            return false;
+        }
+        RecordedChallenges& recorded = *it->second;
+        challenge = recorded.challenges[recorded.next.fetch_add(1, std::memory_order_relaxed)
+                                        % recorded.challenges.size()];
+        return true;
+    };
+
+    double spanSeconds = (items.back().timeNs - items.front().timeNs) / 1e9;
+    std::printf("trace %s: %zu datagrams over %.2f s, %zu authorized drones\n",
+                fileName, items.size(), spanSeconds, config.authorizedDrones.size());
+    std::printf("replaying %s with %d workers, %d loop(s)\n",
+                recordedPace ? "at recorded pace" : "as fast as possible", numWorkers, loops);
+
+    Replayer replayer(config, numWorkers, items);
+    replayer.run(recordedPace, speed, loops);
+
+    const ReplayStats& stats = replayer.getStats();
+    std::printf("%llu datagrams in %.2f s: %.0f/s\n", (unsigned long long)stats.submitted,
+                replayer.getElapsed(), stats.submitted / replayer.getElapsed());
+    std::printf("replies %llu: %llu as recorded, %llu differ; %llu successes, %llu failures\n",
+                (unsigned long long)stats.replies, (unsigned long long)stats.matched,
+                (unsigned long long)stats.mismatched, (unsigned long long)stats.succeeded,
+                (unsigned long long)stats.failed);
+    std::printf("reply latency: p50 %.1f us, p99 %.1f us, max %.1f us\n",
+                stats.latency.percentileNs(0.50) / 1e3, stats.latency.percentileNs(0.99) / 1e3,
+                stats.latency.getMaxNs() / 1e3);
+    if (recordedPace) {
+        std::printf("behind schedule: p50 %.1f us, p99 %.1f us, max %.1f us\n",
+                    stats.lateness.percentileNs(0.50) / 1e3, stats.lateness.percentileNs(0.99) / 1e3,
+                    stats.lateness.getMaxNs() / 1e3);
+    }
+    return 0;
+}
@@ -0,0 +1,108 @@
+/**
+ * zkp_calibrate.cc
+ * Measures ZKPModule costs on this host and scales them to the drone CPU profiles
+ *
+ * Usage: zkp_calibrate [iterations] [--ini]
+ */
+
+#include "ZKPModule.h"
+#include "DroneCpuProfile.h"
+#include "PerfTimer.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <openssl/sha.h>
+
+using namespace droneauth;
+
+// Mean cost of one SHA-256 compression on this host, in microseconds
+static double measureSha256BlockUs(int iterations) {
+    std::vector<uint8_t> buffer(64 * 1024, 0x5a);
+    uint8_t digest[SHA256_DIGEST_LENGTH];
+    size_t blocks = CpuProfiles::sha256Blocks(buffer.size());
+    int rounds = iterations / 100 + 1;
+    uint64_t start = CycleClock::now();
+    for (int i = 0; i < rounds; i++) {
+        SHA256(buffer.data(), buffer.size(), digest);
+        buffer[i % buffer.size()] ^= digest[0];
+    }
+    uint64_t ns = CycleClock::toNs(CycleClock::now() - start);
+    return ns / 1e3 / ((double)rounds * blocks);
+}
+
+int main(int argc, char **argv) {
+    int iterations = 100000;
+    bool ini = false;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--ini") == 0) {
+            ini = true;
+        } else {
+            iterations = std::atoi(argv[i]);
+        }
+    }
+    if (iterations <= 0) {
+        std::fprintf(stderr, "usage: %s [iterations] [--ini]\n", argv[0]);
+        return 1;
+    }
+
+    PerfRegistry perf;
+    ZKPModule prover("DRONE_001");
+    prover.setPerfRegistry(&perf);
+    prover.setup();
+    prover.initializeProver("DRONE_001", "secure");
+    prover.createCommitment();
+
+    ZKPModule verifier;
+    verifier.setPerfRegistry(&perf);
+    verifier.initializeVerifier(prover.getCommitment(), "DRONE_001");
+
+    std::string challenge = verifier.generateChallenge();
+    size_t inputBytes = prover.getProofInputSize(challenge);
+
+    // Proof generation plus serialization, as done by DroneAuthApp::sendZKProof
+    LatencyHistogram proofCost;
+    for (int i = 0; i < iterations; i++) {
+        challenge = verifier.generateChallenge();
+        uint64_t start = CycleClock::now();
+        ZKProof proof = prover.generateProof(challenge);
+        std::vector<uint8_t> bytes = proof.serialize();
+        proofCost.add(CycleClock::toNs(CycleClock::now() - start));
+        verifier.verifyProof(proof);
+    }
+
+    double blockUs = measureSha256BlockUs(iterations);
+    double proofUs = proofCost.percentileNs(0.5) / 1e3;
+    double overheadUs = proofUs - CpuProfiles::sha256Blocks(inputBytes) * blockUs;
+    if (overheadUs < 0) {
+        overheadUs = 0;
+    }
+
+    if (ini) {
+        std::printf("# zkp_calibrate: host proof cost %.3f us (input %zu bytes)\n", proofUs, inputBytes);
+        std::printf("# computeModel = \"measured\" with cpuTimeScale per profile:\n");
+    } else {
+        std::printf("host measurements (%d iterations)\n", iterations);
+        std::printf("  sha256 block        %8.3f us\n", blockUs);
+        std::printf("  proof overhead      %8.3f us\n", overheadUs);
+        std::printf("  proof (p50)         %8.3f us  input %zu bytes, %zu blocks\n",
+                    proofUs, inputBytes, CpuProfiles::sha256Blocks(inputBytes));
+        std::printf("  generateChallenge   %8.3f us\n", perf.phase(PERF_ZKP_GENERATE_CHALLENGE).getMeanNs() / 1e3);
+        std::printf("  verifyProof         %8.3f us\n\n", perf.phase(PERF_ZKP_VERIFY_PROOF).getMeanNs() / 1e3);
+        std::printf("  { \"host\", %.2f, %.1f, <activePowerW> },\n\n", blockUs, overheadUs);
+        std::printf("%-20s %12s %14s\n", "profile", "proof_us", "cpuTimeScale");
+    }
+
+    size_t count;
+    const CpuProfile *profiles = CpuProfiles::all(count);
+    for (size_t i = 0; i < count; i++) {
+        double modelledUs = CpuProfiles::proofGenerationTime(profiles[i], inputBytes) * 1e6;
+        double scale = proofUs > 0 ? modelledUs / proofUs : 1.0;
+        if (ini) {
+            std::printf("# %-20s **.cpuTimeScale = %.3f\n", profiles[i].name, scale);
+        } else {
+            std::printf("%-20s %12.3f %14.3f\n", profiles[i].name, modelledUs, scale);
+        }
+    }
+    return 0;
+}